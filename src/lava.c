@@ -1,10 +1,9 @@
 #include <stdio.h>		// stdout, stderr, ...
-#include <stdlib.h>		// malloc(), ...
+#include <stdlib.h>		// malloc(), strtol(), ...
 #include <string.h>		// strcmp(), ...
-#include <unistd.h>             // sleep()
 
 #include <vulkan/vulkan.h>
-#include "liblava.c"
+#include "liblava/liblava.h"
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
@@ -13,42 +12,93 @@
 #define WINDOW_HEIGHT 600
 #define WINDOW_TITLE  "LAVA LAVA"
 
-#define VALIDATION_LAYER "VK_LAYER_KHRONOS_validation"
-
 #define SHADER_VERT "./shaders/default.vert.spv"
 #define SHADER_FRAG "./shaders/default.frag.spv"
 
+#define SHADER_ARCHIVE   "./shaders/default.lvsa"
+#define SHADER_VERT_NAME "default.vert"
+#define SHADER_FRAG_NAME "default.frag"
+
+#define PIPELINE_CACHE "./bin/pipeline.cache"
+
+//
+// Everything that can be read from disk before there is a device; this
+// is done on a separate thread while the instance and device are set up.
+//
+
+struct prefetch
+{
+	lv_state_s          *lv;
+	lv_shader_archive_s  archive;	// mapped, if there is one
+	lv_shader_s          vert_shader;	// mapped, if there is no archive
+	lv_shader_s          frag_shader;
+	void                *cache_data;	// pipeline cache, if there is one
+	size_t               cache_size;
+};
+
+typedef struct prefetch prefetch_s;
+
 // TODO rename "lava", because someone else came out with a liblava (that actually works)
 //      at pretty much the same time (about a month later) as I started working on this :-)
 
-int init_pipeline(lv_state_s *lv)
+/*
+ * Runs one step of the set up and records how long it took.
+ */
+int phase(lv_state_s *lv, const char *name, int (*init)(lv_state_s *))
 {
-	if (lv_renderpass_create(lv) == 0)
-	{
-		return 0;
-	}
+	lv_mark_s start = lv_mark();
+	int result = init(lv);
+	lv_timings_add(lv, name, start);
+	return result;
+}
 
-	if (lv_pipeline_create(lv) == 0)
+int prefetch(void *arg)
+{
+	prefetch_s *pf = arg;
+	lv_mark_s start = lv_mark();
+
+	// maps the files and hashes the loose ones, which pulls them 
+	// into the page cache while the device is still being created
+	if (lv_shader_archive_open(SHADER_ARCHIVE, &pf->archive) == 0)
 	{
-		return 0;
+		if (lv_load_shader_spv(SHADER_VERT, &pf->vert_shader) == 0)
+		{
+			return 0;
+		}
+
+		if (lv_load_shader_spv(SHADER_FRAG, &pf->frag_shader) == 0)
+		{
+			return 0;
+		}
 	}
+	lv_timings_add(pf->lv, "prefetch shaders", start);
+
+	// optional, there is none on first start
+	start = lv_mark();
+	lv_pipeline_cache_read(PIPELINE_CACHE, &pf->cache_data, &pf->cache_size);
+	lv_timings_add(pf->lv, "prefetch cache", start);
 
 	return 1;
 }
 
-int load_shaders(lv_state_s *lv)
+int init_pipeline(lv_state_s *lv, prefetch_s *pf)
 {
-	if (lv_shader_from_file_spv(lv->device, SHADER_VERT, &lv->vert_shader, LV_SHADER_VERT) == 0)
+	if (lv_renderpass_create(lv) == 0)
 	{
 		return 0;
 	}
 
-	if (lv_shader_from_file_spv(lv->device, SHADER_FRAG, &lv->frag_shader, LV_SHADER_FRAG) == 0)
+	int cached = lv_pipeline_cache_create(lv, pf->cache_data, pf->cache_size);
+
+	free(pf->cache_data);
+	pf->cache_data = NULL;
+
+	if (cached == 0)
 	{
 		return 0;
 	}
 
-	if (lv_shader_stage_create(lv->gpu, lv->device, lv->surface, &lv->vert_shader, &lv->frag_shader) == 0)
+	if (lv_pipeline_create(lv) == 0)
 	{
 		return 0;
 	}
@@ -56,7 +106,26 @@ int load_shaders(lv_state_s *lv)
 	return 1;
 }
 
-int init_window(lv_state_s *lv)
+int load_shaders(lv_state_s *lv, prefetch_s *pf)
+{
+	// prefer the archive, fall back to the loose files (which is also
+	// what hot-reload watches) if there is none
+	int loaded = 0;
+
+	if (pf->archive.map != NULL)
+	{
+		loaded = lv_shaders_from_archive(lv, &pf->archive, SHADER_VERT_NAME, SHADER_FRAG_NAME);
+		lv_shader_archive_close(&pf->archive);
+	}
+	else
+	{
+		loaded = lv_shaders_from_spv(lv, &pf->vert_shader, &pf->frag_shader);
+	}
+
+	return loaded;
+}
+
+int init_glfw(lv_state_s *lv)
 {
 	if (glfwInit() == GLFW_FALSE)
 	{
@@ -66,18 +135,146 @@ int init_window(lv_state_s *lv)
 	//                                .-- no OpenGL, Vulkan
 	//                                |
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+	return 1;
+}
 
-	lv->window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_TITLE, NULL, NULL);
-	return lv->window != NULL;
+/*
+ * How the frame scheduler waits for GLFW events, see lv_frame_events().
+ */
+void wait_events(double timeout)
+{
+	if (timeout < 0.0)
+	{
+		glfwWaitEvents();
+	}
+	else if (timeout == 0.0)
+	{
+		glfwPollEvents();
+	}
+	else
+	{
+		glfwWaitEventsTimeout(timeout);
+	}
 }
 
-int init_validation(lv_state_s *lv)
+/*
+ * A window that was uncovered or resized has to be redrawn all over.
+ */
+void on_refresh(GLFWwindow *window)
 {
-	if (lv_instance_has_layer(VALIDATION_LAYER) == 0)
+	lv_state_s *lv = glfwGetWindowUserPointer(window);
+	for (uint32_t i = 0; i < lv_output_count(lv); ++i)
 	{
+		if (lv_output_window(lv, i) == window)
+		{
+			lv_output_damage(lv, i, NULL);
+		}
+	}
+}
+
+/*
+ * The swapchain of a resized window is rebuilt with the next frame.
+ */
+void on_size(GLFWwindow *window, int width, int height)
+{
+	lv_state_s *lv = glfwGetWindowUserPointer(window);
+	for (uint32_t i = 0; i < lv_output_count(lv); ++i)
+	{
+		if (lv_output_window(lv, i) == window)
+		{
+			lv_output_resize(lv, i);
+		}
+	}
+}
+
+/*
+ * Input asks for a new frame, which is all the on-demand mode needs to
+ * know; what it changes would be marked as damage.
+ */
+void on_key(GLFWwindow *window, int key, int scancode, int action, int mods)
+{
+	lv_invalidate(glfwGetWindowUserPointer(window));
+}
+
+void on_button(GLFWwindow *window, int button, int action, int mods)
+{
+	lv_invalidate(glfwGetWindowUserPointer(window));
+}
+
+void on_cursor(GLFWwindow *window, double x, double y)
+{
+	lv_invalidate(glfwGetWindowUserPointer(window));
+}
+
+/*
+ * Opens one window, or LAVA_OUTPUTS of them, each of which becomes an
+ * output of the same device. With LAVA_DAMAGE=1 the outputs only draw
+ * what has been marked as changed.
+ */
+int init_window(lv_state_s *lv)
+{
+	int count = 1;
+	int track_damage = 0;
+
+	const char *env = getenv("LAVA_DAMAGE");
+	if (env != NULL && strcmp(env, "0") != 0)
+	{
+		track_damage = 1;
+	}
+
+	env = getenv("LAVA_OUTPUTS");
+	if (env != NULL)
+	{
+		count = atoi(env);
+	}
+
+	if (count < 1 || count > LV_MAX_OUTPUTS)
+	{
+		fprintf(stderr, "LAVA_OUTPUTS must be between 1 and %d\n", LV_MAX_OUTPUTS);
 		return 0;
 	}
 
+	for (int i = 0; i < count; ++i)
+	{
+		GLFWwindow *window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_TITLE, NULL, NULL);
+		if (window == NULL)
+		{
+			return 0;
+		}
+
+		int index = lv_output_add(lv, window);
+		if (index == -1)
+		{
+			glfwDestroyWindow(window);
+			return 0;
+		}
+		lv_output_track_damage(lv, index, track_damage);
+
+		glfwSetWindowUserPointer(window, lv);
+		glfwSetWindowRefreshCallback(window, on_refresh);
+		glfwSetFramebufferSizeCallback(window, on_size);
+		glfwSetKeyCallback(window, on_key);
+		glfwSetMouseButtonCallback(window, on_button);
+		glfwSetCursorPosCallback(window, on_cursor);
+	}
+
+	lv_frame_events(lv, wait_events, glfwPostEmptyEvent);
+	return 1;
+}
+
+/*
+ * Validation is off unless LAVA_VALIDATION is set, and missing layers only
+ * cause a warning, so this never fails.
+ */
+int init_validation(lv_state_s *lv)
+{
+	const char *env = getenv("LAVA_VALIDATION");
+	if (env != NULL && strcmp(env, "0") != 0)
+	{
+		lv_log_level(LV_LOG_DEBUG);
+		lv_validation_enable(lv);
+	}
+
 	return 1;
 }
 
@@ -86,62 +283,73 @@ int init_instance(lv_state_s *lv)
 	lv_name_set_s extensions = { 0 };
 	extensions.names = glfwGetRequiredInstanceExtensions(&extensions.count);
 
-	fprintf(stderr, "GLFW required extensions:\n");
+	lv_log(LV_LOG_DEBUG, "GLFW required extensions:");
 	for (int i = 0; i < extensions.count; ++i)
 	{
-		fprintf(stderr, " - %s\n", extensions.names[i]);
+		lv_log(LV_LOG_DEBUG, " - %s", extensions.names[i]);
 	}
-	
-	lv_name_set_s layers = { 0 };
-	const char* names[] = { VALIDATION_LAYER };
-	layers.names = names;
-	layers.count = 1;
 
-	return lv_instance_create(lv, &extensions, &layers);
+	// validation layers are added by lv_instance_create() if enabled
+	return lv_instance_create(lv, &extensions, NULL);
 }
 
-int init_surface(lv_state_s *lv)
+/*
+ * Validation and instance creation, run on a thread of their own while 
+ * the main thread creates the window (which GLFW requires to be the main
+ * thread). Only needs GLFW to be initialized.
+ */
+int init_instance_task(void *arg)
 {
-    if (glfwCreateWindowSurface(lv->instance, lv->window, NULL, &(lv->surface)) != VK_SUCCESS)
-    {
-	return 0;
-    }
-    return 1;
-}
+	lv_state_s *lv = arg;
 
-int init_swapchain(lv_state_s *lv)
-{
-	if (lv_create_swapchain(lv->gpu, lv->surface, lv->device, &lv->gqueue, &lv->pqueue, &lv->swapchain) == 0)
+	// https://vulkan-tutorial.com/en/Drawing_a_triangle/Setup/Validation_layers
+	if (phase(lv, "validation", init_validation) == 0)
 	{
+		fprintf(stderr, "Could not initialize validation layer\n");
 		return 0;
 	}
 
-	if (lv_get_swapchain_images(lv->device, lv->swapchain, &lv->swapchain_images) == 0)
-	{
-		return 0;
-	}
+	// https://vulkan-tutorial.com/Drawing_a_triangle/Setup/Instance	
+	return phase(lv, "instance", init_instance);
+}
 
-	if (lv_create_swapchain_imageviews(lv) == 0)
+int init_surface(lv_state_s *lv)
+{
+	for (uint32_t i = 0; i < lv_output_count(lv); ++i)
 	{
-		return 0;
+		VkSurfaceKHR surface = VK_NULL_HANDLE;
+		if (glfwCreateWindowSurface(lv_get_instance(lv), lv_output_window(lv, i), lv_allocator(), &surface) != VK_SUCCESS)
+		{
+			return 0;
+		}
+		lv_output_set_surface(lv, i, surface);
 	}
-
 	return 1;
 }
 
+int init_swapchain(lv_state_s *lv)
+{
+	return lv_swapchain_create(lv);
+}
+
 int init_gpu(lv_state_s *lv)
 {
-	return lv_device_autoselect(lv);
+	// LAVA_DEVICE can be set to (a part of) a device name or its UUID
+	return lv_device_select(lv, getenv("LAVA_DEVICE"));
 }
 
+/*
+ * The device is selected for the first output; the others are checked
+ * for present support when their swapchains are created.
+ */
 int init_physical_device(lv_state_s *lv)
 {
-	if (lv_device_surface_has_format(lv->gpu, lv->surface, VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR, NULL) == 0)
+	if (lv_device_surface_has_format(lv_get_gpu(lv), lv_output_surface(lv, 0), VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR, NULL) == 0)
 	{
 		return 0;
 	}
 
-	if (lv_device_surface_has_present_mode(lv->gpu, lv->surface, VK_PRESENT_MODE_FIFO_KHR, NULL) == 0)
+	if (lv_device_surface_has_present_mode(lv_get_gpu(lv), lv_output_surface(lv, 0), VK_PRESENT_MODE_FIFO_KHR, NULL) == 0)
 	{
 		return 0;
 	}
@@ -150,6 +358,28 @@ int init_physical_device(lv_state_s *lv)
 
 int init_logical_device(lv_state_s *lv)
 {
+	// dynamic rendering is used if the device has it, unless told not to
+	const char *env = getenv("LAVA_DYNAMIC_RENDERING");
+	if (env != NULL && strcmp(env, "0") == 0)
+	{
+		lv_dynamic_rendering_disable(lv);
+	}
+
+	// LAVA_MSAA=4 asks for 4x multisampling, lowered to what the device can do
+	env = getenv("LAVA_MSAA");
+	if (env != NULL)
+	{
+		char *end = NULL;
+		long samples = strtol(env, &end, 10);
+		if (end == env || *end != '\0' || samples < 1)
+		{
+			fprintf(stderr, "LAVA_MSAA must be a sample count, like 4\n");
+			return 0;
+		}
+
+		lv_msaa_set(lv, samples < VK_SAMPLE_COUNT_64_BIT ? (VkSampleCountFlagBits) samples : VK_SAMPLE_COUNT_64_BIT);
+	}
+
 	lv_name_set_s extensions = { 0 };
 
 	const char* names[] = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
@@ -179,21 +409,130 @@ int init_semaphores(lv_state_s *lv)
 	return lv_create_semaphores(lv);
 }
 
+int init_hotreload(lv_state_s *lv)
+{
+	// opt-in, as it costs a thread and an inotify instance
+	if (getenv("LAVA_HOTRELOAD") == NULL)
+	{
+		return 1;
+	}
+
+	return lv_hotreload_start(lv, SHADER_VERT, SHADER_FRAG);
+}
+
+/*
+ * Closing any of the windows ends the program.
+ */
+int should_close(lv_state_s *lv)
+{
+	for (uint32_t i = 0; i < lv_output_count(lv); ++i)
+	{
+		if (glfwWindowShouldClose(lv_output_window(lv, i)))
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * LAVA_FRAMES picks the frame scheduling: "continuous" (the default) at
+ * LAVA_FPS frames per second, "on-demand" or "benchmark".
+ */
+void init_frames(lv_state_s *lv)
+{
+	lv_frame_mode_e mode = LV_FRAME_CONTINUOUS;
+	double fps = 60.0;
+
+	const char *env = getenv("LAVA_FRAMES");
+	if (env != NULL && strcmp(env, "on-demand") == 0)
+	{
+		mode = LV_FRAME_ON_DEMAND;
+	}
+	else if (env != NULL && strcmp(env, "benchmark") == 0)
+	{
+		mode = LV_FRAME_BENCHMARK;
+	}
+
+	env = getenv("LAVA_FPS");
+	if (env != NULL)
+	{
+		fps = atof(env);
+	}
+
+	lv_frame_mode(lv, mode, fps);
+}
+
+/*
+ * Draws one frame, on whichever thread is rendering.
+ */
+int frame(lv_state_s *lv, void *user)
+{
+	lv_hotreload_apply(lv);
+
+	int first = lv_timings_first_frame(lv) == 0.0;
+	int drawn = lv_draw_frame(lv);
+	if (first)
+	{
+		lv_print_timings(lv);
+		lv_print_allocations();
+	}
+
+	return drawn;
+}
+
+/*
+ * With LAVA_RENDER_THREAD=1, frames are drawn on a thread of their own
+ * and this one only waits for events, until the windows are closed or a
+ * frame fails.
+ */
 void loop(lv_state_s *lv)
 {
-	while (!glfwWindowShouldClose(lv->window))
+	init_frames(lv);
+
+	const char *env = getenv("LAVA_RENDER_THREAD");
+	if (env != NULL && strcmp(env, "0") != 0 && lv_render_thread_start(lv, frame, NULL))
 	{
-		glfwPollEvents();
-		lv_draw_frame(lv);	
-		sleep(1);
+		while (!should_close(lv) && lv_render_thread_running(lv))
+		{
+			glfwWaitEvents();
+		}
+
+		if (lv_render_thread_stop(lv) == 0)
+		{
+			fprintf(stderr, "Failed drawing a frame\n");
+		}
+		return;
+	}
+
+	while (!should_close(lv))
+	{
+		if (lv_frame_wait(lv) == 0)
+		{
+			continue;
+		}
+
+		frame(lv, NULL);
 	}
 }
 
 void kill(lv_state_s *lv)
 {
+	// the windows have to outlive their surfaces, which lv_free() destroys
+	GLFWwindow *windows[LV_MAX_OUTPUTS] = { 0 };
+	uint32_t count = lv_output_count(lv);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		windows[i] = lv_output_window(lv, i);
+	}
+
+	lv_pipeline_cache_write(lv, PIPELINE_CACHE);
 	lv_free(lv);
 
-	glfwDestroyWindow(lv->window);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		glfwDestroyWindow(windows[i]);
+	}
 	glfwTerminate();
 }
 
@@ -201,52 +540,74 @@ int main()
 {
 	// INIT
 	
-	lv_state_s lv = { 0 };
+	lv_state_s *lv = lv_create();
+	if (lv == NULL)
+	{
+		return EXIT_FAILURE;
+	}
+	lv_timings_start(lv);
+
+	// compare against the driver's own host allocator
+	const char *allocator = getenv("LAVA_HOST_ALLOCATOR");
+	if (allocator != NULL && strcmp(allocator, "0") == 0)
+	{
+		lv_allocator_disable();
+	}
+
+	// reading from disk doesn't depend on anything else
+	prefetch_s pf = { 0 };
+	pf.lv = lv;
+
+	lv_task_s prefetch_task = { 0 };
+	lv_task_start(&prefetch_task, prefetch, &pf);
 
 	// https://vulkan-tutorial.com/Drawing_a_triangle/Setup/Base_code
-	if (init_window(&lv) == 0)
+	if (phase(lv, "glfw", init_glfw) == 0)
 	{
-		fprintf(stderr, "Could not create GLFW window\n");
+		fprintf(stderr, "Could not initialize GLFW\n");
 		return EXIT_FAILURE;
 	}
 
-	// https://vulkan-tutorial.com/en/Drawing_a_triangle/Setup/Validation_layers
-	if (init_validation(&lv) == 0)
+	// the instance only needs GLFW for the list of extensions it 
+	// requires, so it can be created while the window is opened
+	lv_task_s instance_task = { 0 };
+	lv_task_start(&instance_task, init_instance_task, lv);
+
+	if (phase(lv, "window", init_window) == 0)
 	{
-		fprintf(stderr, "Could not initialize validation layer\n");
+		fprintf(stderr, "Could not create GLFW windows\n");
 		return EXIT_FAILURE;
 	}
-	
-	// https://vulkan-tutorial.com/Drawing_a_triangle/Setup/Instance	
-	if (init_instance(&lv) == 0)
+
+	if (lv_task_join(&instance_task) == 0)
 	{
 		fprintf(stderr, "Could not create Vulkan instance\n");
 		return EXIT_FAILURE;
 	}
 
 	// https://vulkan-tutorial.com/Drawing_a_triangle/Presentation/Window_surface
-	if (init_surface(&lv) == 0)
+	if (phase(lv, "surface", init_surface) == 0)
 	{
 		fprintf(stderr, "Could not create drawing surface\n");
 		return EXIT_FAILURE;
 	}
 
 	// https://vulkan-tutorial.com/Drawing_a_triangle/Setup/Physical_devices_and_queue_families
-	if (init_gpu(&lv) == 0)
+	if (phase(lv, "gpu", init_gpu) == 0)
 	{
 		fprintf(stderr, "Could not find a GPU with Vulkan support\n");
 		return EXIT_FAILURE;
 	}
 
 	// https://vulkan-tutorial.com/Drawing_a_triangle/Setup/Physical_devices_and_queue_families
-	if (init_physical_device(&lv) == 0)
+	if (phase(lv, "physical device", init_physical_device) == 0)
 	{
 		fprintf(stderr, "Could not initialize physical device\n");
 		return EXIT_FAILURE;
 	}
 	
 	// https://vulkan-tutorial.com/en/Drawing_a_triangle/Setup/Logical_device_and_queues
-	if (init_logical_device(&lv) == 0)
+	if (phase(lv, "logical device", init_logical_device) == 0)
 	{
 		fprintf(stderr, "Could not create logical device\n");
 		return EXIT_FAILURE;
@@ -254,59 +615,69 @@ int main()
 
 	// https://vulkan-tutorial.com/Drawing_a_triangle/Presentation/Swap_chain
 	// https://vulkan-tutorial.com/Drawing_a_triangle/Presentation/Image_views
-	if (init_swapchain(&lv) == 0)
+	if (phase(lv, "swapchain", init_swapchain) == 0)
 	{
 		fprintf(stderr, "Could not create swapchain\n");
 		return EXIT_FAILURE;
 	}
 
 	// https://vulkan-tutorial.com/Drawing_a_triangle/Graphics_pipeline_basics/Shader_modules
-	if (load_shaders(&lv) == 0)
+	lv_mark_s start = lv_mark();
+	if (lv_task_join(&prefetch_task) == 0 || load_shaders(lv, &pf) == 0)
 	{
 		fprintf(stderr, "Failed loading shaders\n");
 		return EXIT_FAILURE;
 	}
+	lv_timings_add(lv, "shaders", start);
 	
 	// https://vulkan-tutorial.com/Drawing_a_triangle/Graphics_pipeline_basics/Render_passes
 	// https://vulkan-tutorial.com/Drawing_a_triangle/Graphics_pipeline_basics/Fixed_functions
-	if (init_pipeline(&lv) == 0)
+	start = lv_mark();
+	if (init_pipeline(lv, &pf) == 0)
 	{
 		fprintf(stderr, "Failed pipelining the render sausage accumulator pass\n");
 		return EXIT_FAILURE;
 	}
+	lv_timings_add(lv, "pipeline", start);
 
 	// https://vulkan-tutorial.com/en/Drawing_a_triangle/Drawing/Framebuffers
-	if (init_framebuffers(&lv) == 0)
+	if (phase(lv, "framebuffers", init_framebuffers) == 0)
 	{
 		fprintf(stderr, "Failed creating framebuffers\n");
 		return EXIT_FAILURE;
 	}
 
 	// https://vulkan-tutorial.com/en/Drawing_a_triangle/Drawing/Command_buffers
-	if (init_commandpool(&lv) == 0)
+	if (phase(lv, "command pool", init_commandpool) == 0)
 	{
 		fprintf(stderr, "Failed creating command pool\n");
 		return EXIT_FAILURE;
 	}
 	
 	// https://vulkan-tutorial.com/en/Drawing_a_triangle/Drawing/Command_buffers
-	if (init_commandbuffers(&lv) == 0)
+	if (phase(lv, "command buffers", init_commandbuffers) == 0)
 	{
 		fprintf(stderr, "Failed creating command buffers\n");
 		return EXIT_FAILURE;
 	}
 
 	// https://vulkan-tutorial.com/en/Drawing_a_triangle/Drawing/Rendering_and_presentation
-	if (init_semaphores(&lv) == 0)
+	if (phase(lv, "semaphores", init_semaphores) == 0)
 	{
 		fprintf(stderr, "Failed creating semaphores\n");
 		return EXIT_FAILURE;
 	}
 	
+	if (phase(lv, "hot-reload", init_hotreload) == 0)
+	{
+		fprintf(stderr, "Failed starting shader hot-reload\n");
+		return EXIT_FAILURE;
+	}
+
 	// TODO continue the tutorial
 
 	fprintf(stdout, "Devices available:\n");
-	lv_print_devices(lv.instance);
+	lv_print_device_ratings(lv);
 
 	fprintf(stdout, "Extensions available:\n");
 	lv_print_extensions();
@@ -314,19 +685,21 @@ int main()
 	fprintf(stdout, "Layers available:\n");
 	lv_print_layers();
 
-	int dsfc = lv_device_surface_format_count(lv.gpu, lv.surface);
+	fprintf(stdout, "Outputs: %u\n", lv_output_count(lv));
+
+	int dsfc = lv_device_surface_format_count(lv_get_gpu(lv), lv_output_surface(lv, 0));
 	fprintf(stdout, "Number of surface formats available: %d\n", dsfc);
 
-	int dspmc = lv_device_surface_present_mode_count(lv.gpu, lv.surface);
+	int dspmc = lv_device_surface_present_mode_count(lv_get_gpu(lv), lv_output_surface(lv, 0));
 	fprintf(stdout, "Number of surface present modes available: %d\n", dspmc);
 
 	// LOOP
 
-	loop(&lv);
+	loop(lv);
 
 	// FREE 
 
-	kill(&lv);
+	kill(lv);
 
 	// CIAO
 	
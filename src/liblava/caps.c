@@ -0,0 +1,215 @@
+
+#include "internal.h"
+
+/*
+ * Enumerated capabilities are cached: instance level ones once per 
+ * process, device level ones once per physical device and surface level
+ * ones once per physical device and surface, in a short list with an
+ * entry for every output. Extension and layer lists
+ * are sorted by name, so lookups are binary searches. All of this sits
+ * behind one mutex, as the hot-reload thread queries the surface, too.
+ */
+pthread_mutex_t            lv_caps_lock = PTHREAD_MUTEX_INITIALIZER;
+static lv_instance_caps_s  lv_instance_caps;
+static lv_device_caps_s   *lv_device_caps;
+static uint32_t            lv_device_caps_count;
+static lv_surface_caps_s  *lv_surface_caps;
+static uint32_t            lv_surface_caps_count;
+
+static int
+lv_caps_cmp_extension(const void *a, const void *b)
+{
+	return strcmp(((const VkExtensionProperties *) a)->extensionName, ((const VkExtensionProperties *) b)->extensionName);
+}
+
+static int
+lv_caps_cmp_layer(const void *a, const void *b)
+{
+	return strcmp(((const VkLayerProperties *) a)->layerName, ((const VkLayerProperties *) b)->layerName);
+}
+
+int lv_caps_find_extension(const void *name, const void *ext)
+{
+	return strcmp(name, ((const VkExtensionProperties *) ext)->extensionName);
+}
+
+int lv_caps_find_layer(const void *name, const void *layer)
+{
+	return strcmp(name, ((const VkLayerProperties *) layer)->layerName);
+}
+
+/*
+ * Returns the instance capabilities, enumerating them on first use.
+ * Caller has to hold lv_caps_lock.
+ */
+lv_instance_caps_s *lv_instance_caps_get()
+{
+	lv_instance_caps_s *caps = &lv_instance_caps;
+	if (caps->valid)
+	{
+		return caps;
+	}
+
+	vkEnumerateInstanceExtensionProperties(NULL, &caps->extension_count, NULL);
+	caps->extensions = malloc(sizeof(VkExtensionProperties) * caps->extension_count);
+	vkEnumerateInstanceExtensionProperties(NULL, &caps->extension_count, caps->extensions);
+	qsort(caps->extensions, caps->extension_count, sizeof(VkExtensionProperties), lv_caps_cmp_extension);
+
+	vkEnumerateInstanceLayerProperties(&caps->layer_count, NULL);
+	caps->layers = malloc(sizeof(VkLayerProperties) * caps->layer_count);
+	vkEnumerateInstanceLayerProperties(&caps->layer_count, caps->layers);
+	qsort(caps->layers, caps->layer_count, sizeof(VkLayerProperties), lv_caps_cmp_layer);
+
+	caps->valid = 1;
+	return caps;
+}
+
+/*
+ * Returns the capabilities of the given device, enumerating them on first
+ * use. Caller has to hold lv_caps_lock.
+ */
+lv_device_caps_s *lv_device_caps_get(VkPhysicalDevice device)
+{
+	for (uint32_t i = 0; i < lv_device_caps_count; ++i)
+	{
+		if (lv_device_caps[i].gpu == device)
+		{
+			return &lv_device_caps[i];
+		}
+	}
+
+	lv_device_caps_s *grown = realloc(lv_device_caps, sizeof(lv_device_caps_s) * (lv_device_caps_count + 1));
+	if (grown == NULL)
+	{
+		return NULL;
+	}
+	lv_device_caps = grown;
+
+	lv_device_caps_s *caps = &lv_device_caps[lv_device_caps_count++];
+	memset(caps, 0, sizeof(lv_device_caps_s));
+	caps->gpu = device;
+
+	vkEnumerateDeviceExtensionProperties(device, NULL, &caps->extension_count, NULL);
+	caps->extensions = malloc(sizeof(VkExtensionProperties) * caps->extension_count);
+	vkEnumerateDeviceExtensionProperties(device, NULL, &caps->extension_count, caps->extensions);
+	qsort(caps->extensions, caps->extension_count, sizeof(VkExtensionProperties), lv_caps_cmp_extension);
+
+	vkGetPhysicalDeviceQueueFamilyProperties(device, &caps->queue_count, NULL);
+	caps->queues = malloc(sizeof(VkQueueFamilyProperties) * caps->queue_count);
+	vkGetPhysicalDeviceQueueFamilyProperties(device, &caps->queue_count, caps->queues);
+
+	return caps;
+}
+
+static void
+lv_surface_caps_drop(uint32_t index)
+{
+	lv_surface_caps_s *caps = &lv_surface_caps[index];
+	free(caps->queue_present);
+	free(caps->formats);
+	free(caps->present_modes);
+
+	// the order doesn't matter, the last one takes its place
+	*caps = lv_surface_caps[--lv_surface_caps_count];
+}
+
+/*
+ * Returns what the device can do with the surface, querying it on first
+ * use. Caller has to hold lv_caps_lock.
+ */
+lv_surface_caps_s *lv_surface_caps_get(VkPhysicalDevice device, VkSurfaceKHR surface)
+{
+	for (uint32_t i = 0; i < lv_surface_caps_count; ++i)
+	{
+		if (lv_surface_caps[i].gpu == device && lv_surface_caps[i].surface == surface)
+		{
+			return &lv_surface_caps[i];
+		}
+	}
+
+	lv_device_caps_s *device_caps = lv_device_caps_get(device);
+	if (device_caps == NULL)
+	{
+		return NULL;
+	}
+
+	lv_surface_caps_s *grown = realloc(lv_surface_caps, sizeof(lv_surface_caps_s) * (lv_surface_caps_count + 1));
+	if (grown == NULL)
+	{
+		return NULL;
+	}
+	lv_surface_caps = grown;
+
+	lv_surface_caps_s *caps = &lv_surface_caps[lv_surface_caps_count++];
+	memset(caps, 0, sizeof(lv_surface_caps_s));
+	caps->gpu     = device;
+	caps->surface = surface;
+
+	caps->queue_present = malloc(sizeof(VkBool32) * device_caps->queue_count);
+	caps->queue_count   = caps->queue_present ? device_caps->queue_count : 0;
+	for (uint32_t i = 0; i < caps->queue_count; ++i)
+	{
+		caps->queue_present[i] = VK_FALSE;
+		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &caps->queue_present[i]);
+	}
+
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &caps->surface_caps);
+
+	vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &caps->format_count, NULL);
+	caps->formats = malloc(sizeof(VkSurfaceFormatKHR) * caps->format_count);
+	vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &caps->format_count, caps->formats);
+
+	vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &caps->present_mode_count, NULL);
+	caps->present_modes = malloc(sizeof(VkPresentModeKHR) * caps->present_mode_count);
+	vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &caps->present_mode_count, caps->present_modes);
+
+	return caps;
+}
+
+/*
+ * Forgets what is known about a surface, on every device, so it is
+ * queried again on next use. Needs to be called when the surface
+ * changes, for example when the window has been resized, as its current
+ * extent is cached, and when it is destroyed, as the handle may be
+ * reused for a different one.
+ */
+void lv_caps_invalidate_surface(VkSurfaceKHR surface)
+{
+	pthread_mutex_lock(&lv_caps_lock);
+	for (uint32_t i = lv_surface_caps_count; i-- > 0;)
+	{
+		if (lv_surface_caps[i].surface == surface)
+		{
+			lv_surface_caps_drop(i);
+		}
+	}
+	pthread_mutex_unlock(&lv_caps_lock);
+}
+
+/*
+ * Frees all cached capabilities.
+ */
+void lv_caps_free()
+{
+	pthread_mutex_lock(&lv_caps_lock);
+	while (lv_surface_caps_count > 0)
+	{
+		lv_surface_caps_drop(lv_surface_caps_count - 1);
+	}
+	free(lv_surface_caps);
+	lv_surface_caps = NULL;
+
+	for (uint32_t i = 0; i < lv_device_caps_count; ++i)
+	{
+		free(lv_device_caps[i].extensions);
+		free(lv_device_caps[i].queues);
+	}
+	free(lv_device_caps);
+	lv_device_caps = NULL;
+	lv_device_caps_count = 0;
+
+	free(lv_instance_caps.extensions);
+	free(lv_instance_caps.layers);
+	memset(&lv_instance_caps, 0, sizeof(lv_instance_caps_s));
+	pthread_mutex_unlock(&lv_caps_lock);
+}
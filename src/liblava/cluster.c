@@ -0,0 +1,621 @@
+#include <math.h>              // sqrtf()
+#include <float.h>             // FLT_MAX
+#ifdef __SSE2__
+#include <emmintrin.h>         // _mm_cmpeq_epi32(), _mm_cvttps_epi32(), ...
+#endif
+
+#include "internal.h"
+
+//
+// Geometry preprocessing for large meshes, at load time or offline in
+// lvmesh: detail levels made by simplification, and the splitting of
+// every level into meshlets, small clusters of triangles with bounds to
+// cull them by. At run time, lv_lod_select() picks the level of an
+// object from its size on screen and lv_meshlet_visible() culls the
+// meshlets of that level before they are drawn.
+//
+// Simplification is by vertex clustering: the vertices are sorted into a
+// grid of cells, each cell collapses into the one vertex closest to their
+// average, and triangles left with less than three corners are dropped.
+// It never creates vertices, so all levels share the vertex streams. It
+// is not as good looking as edge collapsing, but linear and easily run
+// in parallel, which is what re-baking 10M triangle meshes needs.
+//
+// Both run on the job system, if given one, and use SSE2 where there is.
+//
+
+#define LV_CLUSTER_BATCH   16384	// vertices or triangles per job
+#define LV_MESHLET_CHUNK   8192	// triangles split into meshlets by one job
+
+// fewest triangles a meshlet can be closed with, for lack of vertices
+#define LV_MESHLET_MIN_TRIANGLES ((LV_MESHLET_MAX_VERTICES - 2) / 3)
+
+#define LV_CELL_BITS 21		// per axis of a cell key
+#define LV_CELL_MASK ((1u << LV_CELL_BITS) - 1)
+
+/*
+ * A cell of the simplification grid and the vertex it collapses into.
+ */
+struct lv_cell
+{
+	uint64_t  key;
+	float     sum[3];
+	uint32_t  count;
+	uint32_t  vertex;
+	float     distance;	// of the vertex to the average
+};
+
+typedef struct lv_cell lv_cell_s;
+
+struct lv_simplify
+{
+	const float     *positions;
+	uint32_t         first_vertex;
+	uint32_t         vertex_count;
+	float            origin[3];
+	float            scale;		// cells per unit
+	uint64_t        *keys;		// per vertex
+	uint32_t        *cells;		// per vertex, into table
+	lv_cell_s       *table;
+	const uint32_t  *indices;
+	uint32_t         index_count;
+	uint32_t        *out;
+	uint32_t        *kept;		// indices kept per batch
+	float           *errors;	// per batch
+};
+
+typedef struct lv_simplify lv_simplify_s;
+
+struct lv_meshlet_job
+{
+	const float     *positions;
+	const uint32_t  *indices;
+	uint32_t         first_index;
+	uint32_t         index_count;
+	lv_meshlet_s    *meshlets;	// LV_MESHLET_CHUNK / LV_MESHLET_MIN_TRIANGLES + 1 per chunk
+	uint32_t        *counts;	// per chunk
+};
+
+typedef struct lv_meshlet_job lv_meshlet_job_s;
+
+static inline float
+lv_distance(const float *a, const float *b)
+{
+	float x = a[0] - b[0], y = a[1] - b[1], z = a[2] - b[2];
+	return sqrtf(x * x + y * y + z * z);
+}
+
+static inline uint64_t
+lv_cell_key(uint32_t x, uint32_t y, uint32_t z)
+{
+	return (uint64_t) (x & LV_CELL_MASK) | (uint64_t) (y & LV_CELL_MASK) << LV_CELL_BITS
+		| (uint64_t) (z & LV_CELL_MASK) << (LV_CELL_BITS * 2);
+}
+
+/*
+ * The cell of every vertex of a batch. The positions are at least the
+ * origin, so truncating is flooring.
+ */
+static void
+lv_simplify_keys(void *arg, uint32_t begin, uint32_t end)
+{
+	lv_simplify_s *s = arg;
+	const float *p = s->positions + (size_t) s->first_vertex * 3;
+	uint32_t i = begin;
+
+#ifdef __SSE2__
+	__m128 origin = _mm_set_ps(0.0f, s->origin[2], s->origin[1], s->origin[0]);
+	__m128 scale  = _mm_set1_ps(s->scale);
+
+	// reads a float past every position, so not for the last one
+	for (uint32_t last = end < s->vertex_count ? end : s->vertex_count - 1; i < last; ++i)
+	{
+		__m128 cell = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(p + (size_t) i * 3), origin), scale);
+		uint32_t c[4];
+		_mm_storeu_si128((__m128i *) c, _mm_cvttps_epi32(cell));
+		s->keys[i] = lv_cell_key(c[0], c[1], c[2]);
+	}
+#endif
+
+	for (; i < end; ++i)
+	{
+		const float *v = p + (size_t) i * 3;
+		s->keys[i] = lv_cell_key((uint32_t) ((v[0] - s->origin[0]) * s->scale),
+				(uint32_t) ((v[1] - s->origin[1]) * s->scale), (uint32_t) ((v[2] - s->origin[2]) * s->scale));
+	}
+}
+
+/*
+ * How far the vertices of the given batches move, at most.
+ */
+static void
+lv_simplify_error(void *arg, uint32_t begin, uint32_t end)
+{
+	lv_simplify_s *s = arg;
+	const float *p = s->positions + (size_t) s->first_vertex * 3;
+
+	for (uint32_t b = begin; b < end; ++b)
+	{
+		uint32_t last = (b + 1) * LV_CLUSTER_BATCH < s->vertex_count ? (b + 1) * LV_CLUSTER_BATCH : s->vertex_count;
+		float error = 0.0f;
+
+		for (uint32_t i = b * LV_CLUSTER_BATCH; i < last; ++i)
+		{
+			uint32_t target = s->table[s->cells[i]].vertex;
+			float d = lv_distance(p + (size_t) i * 3, p + (size_t) target * 3);
+			error = d > error ? d : error;
+		}
+
+		s->errors[b] = error;
+	}
+}
+
+/*
+ * Moves the corners of the triangles of the given batches to the
+ * vertices of their cells, keeping those that still have three. Written
+ * to where each batch starts in the output, packed afterwards.
+ */
+static void
+lv_simplify_triangles(void *arg, uint32_t begin, uint32_t end)
+{
+	lv_simplify_s *s = arg;
+	uint32_t triangle_count = s->index_count / 3;
+
+	for (uint32_t b = begin; b < end; ++b)
+	{
+		uint32_t last = (b + 1) * LV_CLUSTER_BATCH < triangle_count ? (b + 1) * LV_CLUSTER_BATCH : triangle_count;
+		uint32_t *out = s->out + (size_t) b * LV_CLUSTER_BATCH * 3;
+		uint32_t kept = 0;
+
+		for (uint32_t t = b * LV_CLUSTER_BATCH; t < last; ++t)
+		{
+			uint32_t v[3];
+			for (int k = 0; k < 3; ++k)
+			{
+				uint32_t local = s->indices[t * 3 + k] - s->first_vertex;
+				v[k] = s->first_vertex + s->table[s->cells[local]].vertex;
+			}
+
+			if (v[0] != v[1] && v[1] != v[2] && v[2] != v[0])
+			{
+				out[kept++] = v[0];
+				out[kept++] = v[1];
+				out[kept++] = v[2];
+			}
+		}
+
+		s->kept[b] = kept;
+	}
+}
+
+/*
+ * Simplifies the triangles of a submesh, whose indices all lie within
+ * [first_vertex, first_vertex + vertex_count), by collapsing everything
+ * within cells of the given size. Writes the triangles left to `out`,
+ * which has room for index_count indices and is not `indices`, and
+ * returns their index count.
+ * Sets `error` to how far any vertex moved. Returns 0 if out of memory.
+ */
+uint32_t lv_simplify(lv_jobs_s *jobs, const float *positions, uint32_t first_vertex, uint32_t vertex_count,
+		const uint32_t *indices, uint32_t index_count, float cell, uint32_t *out, float *error)
+{
+	if (vertex_count == 0 || index_count < 3 || cell <= 0.0f)
+	{
+		return 0;
+	}
+
+	lv_simplify_s s = { 0 };
+	s.positions    = positions;
+	s.first_vertex = first_vertex;
+	s.vertex_count = vertex_count;
+	s.scale        = 1.0f / cell;
+	s.indices      = indices;
+	s.index_count  = index_count;
+	s.out          = out;
+
+	const float *p = positions + (size_t) first_vertex * 3;
+	float max[3];
+	memcpy(s.origin, p, sizeof(float) * 3);
+	memcpy(max, p, sizeof(float) * 3);
+	for (uint32_t i = 1; i < vertex_count; ++i)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			s.origin[k] = p[i * 3 + k] < s.origin[k] ? p[i * 3 + k] : s.origin[k];
+			max[k] = p[i * 3 + k] > max[k] ? p[i * 3 + k] : max[k];
+		}
+	}
+
+	// cells too small for the keys to tell apart are made bigger
+	for (int k = 0; k < 3; ++k)
+	{
+		if ((max[k] - s.origin[k]) * s.scale >= (float) LV_CELL_MASK)
+		{
+			s.scale = (float) LV_CELL_MASK / (max[k] - s.origin[k]) * 0.99f;
+		}
+	}
+
+	uint32_t table_size = 1;
+	while (table_size < vertex_count * 2)
+	{
+		table_size *= 2;
+	}
+
+	uint32_t triangle_count = index_count / 3;
+	uint32_t vertex_batches = (vertex_count + LV_CLUSTER_BATCH - 1) / LV_CLUSTER_BATCH;
+	uint32_t triangle_batches = (triangle_count + LV_CLUSTER_BATCH - 1) / LV_CLUSTER_BATCH;
+	uint32_t batch_count = vertex_batches > triangle_batches ? vertex_batches : triangle_batches;
+
+	s.keys   = lv_scratch_alloc(sizeof(uint64_t) * vertex_count);
+	s.cells  = lv_scratch_alloc(sizeof(uint32_t) * vertex_count);
+	s.table  = lv_scratch_alloc(sizeof(lv_cell_s) * table_size);
+	s.kept   = lv_scratch_alloc(sizeof(uint32_t) * batch_count);
+	s.errors = lv_scratch_alloc(sizeof(float) * batch_count);
+
+	uint32_t count = 0;
+	if (s.keys == NULL || s.cells == NULL || s.table == NULL || s.kept == NULL || s.errors == NULL)
+	{
+		goto done;
+	}
+
+	lv_jobs_parallel_for(jobs, vertex_count, LV_CLUSTER_BATCH, lv_simplify_keys, &s);
+
+	// the cells, with the sum of their vertices
+	memset(s.table, 0, sizeof(lv_cell_s) * table_size);
+	for (uint32_t i = 0; i < vertex_count; ++i)
+	{
+		uint64_t key = s.keys[i] + 1;
+		uint32_t slot = (uint32_t) ((key * 0x9e3779b97f4a7c15ULL) >> 32) & (table_size - 1);
+
+		while (s.table[slot].key != 0 && s.table[slot].key != key)
+		{
+			slot = (slot + 1) & (table_size - 1);
+		}
+
+		lv_cell_s *c = &s.table[slot];
+		if (c->key == 0)
+		{
+			c->key = key;
+			c->distance = FLT_MAX;
+		}
+
+		c->sum[0] += p[i * 3 + 0];
+		c->sum[1] += p[i * 3 + 1];
+		c->sum[2] += p[i * 3 + 2];
+		++c->count;
+		s.cells[i] = slot;
+	}
+
+	// every cell collapses into its vertex closest to the average
+	for (uint32_t i = 0; i < vertex_count; ++i)
+	{
+		lv_cell_s *c = &s.table[s.cells[i]];
+		float average[3] = { c->sum[0] / c->count, c->sum[1] / c->count, c->sum[2] / c->count };
+		float d = lv_distance(p + (size_t) i * 3, average);
+
+		if (d < c->distance)
+		{
+			c->distance = d;
+			c->vertex = i;
+		}
+	}
+
+	lv_jobs_parallel_for(jobs, vertex_batches, 1, lv_simplify_error, &s);
+	lv_jobs_parallel_for(jobs, triangle_batches, 1, lv_simplify_triangles, &s);
+
+	*error = 0.0f;
+	for (uint32_t b = 0; b < vertex_batches; ++b)
+	{
+		*error = s.errors[b] > *error ? s.errors[b] : *error;
+	}
+
+	for (uint32_t b = 0; b < triangle_batches; ++b)
+	{
+		memmove(out + count, out + (size_t) b * LV_CLUSTER_BATCH * 3, sizeof(uint32_t) * s.kept[b]);
+		count += s.kept[b];
+	}
+
+done:
+	lv_scratch_free(s.errors);
+	lv_scratch_free(s.kept);
+	lv_scratch_free(s.table);
+	lv_scratch_free(s.cells);
+	lv_scratch_free(s.keys);
+	return count;
+}
+
+/*
+ * Returns 1 if the vertex is among the first `count` of the meshlet's.
+ * Unused entries hold UINT32_MAX, which is no vertex.
+ */
+static inline int
+lv_meshlet_has(const uint32_t *vertices, uint32_t count, uint32_t vertex)
+{
+#ifdef __SSE2__
+	__m128i v = _mm_set1_epi32((int) vertex);
+	for (uint32_t i = 0; i < count; i += 4)
+	{
+		__m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) (vertices + i)), v);
+		if (_mm_movemask_epi8(eq) != 0)
+		{
+			return 1;
+		}
+	}
+	return 0;
+#else
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (vertices[i] == vertex)
+		{
+			return 1;
+		}
+	}
+	return 0;
+#endif
+}
+
+/*
+ * The bounding sphere and normal cone of a meshlet, from its triangles.
+ * The normals point to where the triangles wind counter-clockwise.
+ */
+static void
+lv_meshlet_bounds(lv_meshlet_s *m, const float *positions, const uint32_t *indices)
+{
+	float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	float axis[3] = { 0.0f, 0.0f, 0.0f };
+
+	for (uint32_t i = 0; i < m->index_count; ++i)
+	{
+		const float *v = positions + (size_t) indices[m->first_index + i] * 3;
+		for (int k = 0; k < 3; ++k)
+		{
+			min[k] = v[k] < min[k] ? v[k] : min[k];
+			max[k] = v[k] > max[k] ? v[k] : max[k];
+		}
+	}
+
+	for (int k = 0; k < 3; ++k)
+	{
+		m->center[k] = (min[k] + max[k]) * 0.5f;
+	}
+
+	m->radius = 0.0f;
+	for (uint32_t i = 0; i < m->index_count; ++i)
+	{
+		float d = lv_distance(positions + (size_t) indices[m->first_index + i] * 3, m->center);
+		m->radius = d > m->radius ? d : m->radius;
+	}
+
+	// unit normals, summed for the axis, then the widest one off it
+	float normals[LV_MESHLET_MAX_TRIANGLES][3];
+	uint32_t normal_count = 0;
+
+	for (uint32_t t = 0; t < m->index_count; t += 3)
+	{
+		const uint32_t *tri = indices + m->first_index + t;
+		const float *a = positions + (size_t) tri[0] * 3;
+		const float *b = positions + (size_t) tri[1] * 3;
+		const float *c = positions + (size_t) tri[2] * 3;
+
+		float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		float *n = normals[normal_count];
+		n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+
+		float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (length > 0.0f)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				n[k] /= length;
+				axis[k] += n[k];
+			}
+			++normal_count;
+		}
+	}
+
+	float length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+	float min_dot = length > 0.0f ? 1.0f : -1.0f;
+
+	for (uint32_t i = 0; i < normal_count && length > 0.0f; ++i)
+	{
+		float d = (normals[i][0] * axis[0] + normals[i][1] * axis[1] + normals[i][2] * axis[2]) / length;
+		min_dot = d < min_dot ? d : min_dot;
+	}
+
+	for (int k = 0; k < 3; ++k)
+	{
+		m->cone_axis[k] = length > 0.0f ? axis[k] / length : 0.0f;
+	}
+
+	// a cone of 90 degrees or more faces the camera from anywhere
+	m->cone_cutoff = min_dot > 0.0f ? sqrtf(1.0f - min_dot * min_dot) : 1.0f;
+}
+
+/*
+ * Collects the corners of a triangle the meshlet doesn't have yet, each
+ * once. Returns how many.
+ */
+static uint32_t
+lv_meshlet_fresh(const uint32_t *vertices, uint32_t count, const uint32_t *tri, uint32_t *fresh)
+{
+	uint32_t added = 0;
+
+	for (int k = 0; k < 3; ++k)
+	{
+		if (lv_meshlet_has(vertices, count, tri[k]) == 0 &&
+				(added < 1 || fresh[0] != tri[k]) && (added < 2 || fresh[1] != tri[k]))
+		{
+			fresh[added++] = tri[k];
+		}
+	}
+
+	return added;
+}
+
+/*
+ * Splits chunks of triangles into meshlets, in the order they come in,
+ * closing a meshlet when the next triangle doesn't fit anymore.
+ */
+static void
+lv_meshlets_chunk(void *arg, uint32_t begin, uint32_t end)
+{
+	lv_meshlet_job_s *job = arg;
+	const uint32_t *indices = job->indices + job->first_index;
+
+	for (uint32_t chunk = begin; chunk < end; ++chunk)
+	{
+		lv_meshlet_s *out = job->meshlets + (size_t) chunk * (LV_MESHLET_CHUNK / LV_MESHLET_MIN_TRIANGLES + 1);
+		uint32_t first = chunk * LV_MESHLET_CHUNK * 3;
+		uint32_t last  = first + LV_MESHLET_CHUNK * 3 < job->index_count ? first + LV_MESHLET_CHUNK * 3 : job->index_count;
+
+		// room for lv_meshlet_has() reading four at a time
+		uint32_t vertices[LV_MESHLET_MAX_VERTICES + 4];
+		uint32_t vertex_count = 0;
+		uint32_t count = 0;
+		uint32_t start = first;
+		memset(vertices, 0xff, sizeof(vertices));
+
+		for (uint32_t i = first; i < last; i += 3)
+		{
+			uint32_t fresh[3];
+			uint32_t added = lv_meshlet_fresh(vertices, vertex_count, indices + i, fresh);
+
+			if (vertex_count + added > LV_MESHLET_MAX_VERTICES || (i - start) / 3 == LV_MESHLET_MAX_TRIANGLES)
+			{
+				out[count].first_index = job->first_index + start;
+				out[count].index_count = i - start;
+				lv_meshlet_bounds(&out[count++], job->positions, job->indices);
+
+				start = i;
+				vertex_count = 0;
+				memset(vertices, 0xff, sizeof(vertices));
+				added = lv_meshlet_fresh(vertices, vertex_count, indices + i, fresh);
+			}
+
+			for (uint32_t k = 0; k < added; ++k)
+			{
+				vertices[vertex_count++] = fresh[k];
+			}
+		}
+
+		if (last > start)
+		{
+			out[count].first_index = job->first_index + start;
+			out[count].index_count = last - start;
+			lv_meshlet_bounds(&out[count++], job->positions, job->indices);
+		}
+
+		job->counts[chunk] = count;
+	}
+}
+
+/*
+ * Returns how many meshlets lv_meshlets_build() makes of `index_count`
+ * indices at most.
+ */
+uint32_t lv_meshlets_max(uint32_t index_count)
+{
+	uint32_t triangles = index_count / 3;
+	return triangles / LV_MESHLET_MIN_TRIANGLES + triangles / LV_MESHLET_CHUNK + 1;
+}
+
+/*
+ * Splits the triangles in [first_index, first_index + index_count) into
+ * meshlets, in the order the triangles are in, so every meshlet is a
+ * range of the indices. The better the triangles are ordered for the
+ * vertex cache, the tighter the meshlets. `meshlets` has room for
+ * lv_meshlets_max(index_count). Returns how many there are, 0 if out of
+ * memory.
+ */
+uint32_t lv_meshlets_build(lv_jobs_s *jobs, const float *positions, const uint32_t *indices,
+		uint32_t first_index, uint32_t index_count, lv_meshlet_s *meshlets)
+{
+	uint32_t chunk_count = (index_count / 3 + LV_MESHLET_CHUNK - 1) / LV_MESHLET_CHUNK;
+	uint32_t per_chunk = LV_MESHLET_CHUNK / LV_MESHLET_MIN_TRIANGLES + 1;
+
+	lv_meshlet_job_s job = { positions, indices, first_index, index_count / 3 * 3, NULL, NULL };
+	job.meshlets = lv_scratch_alloc(sizeof(lv_meshlet_s) * per_chunk * chunk_count);
+	job.counts   = lv_scratch_alloc(sizeof(uint32_t) * chunk_count);
+
+	uint32_t count = 0;
+	if (job.meshlets != NULL && job.counts != NULL)
+	{
+		lv_jobs_parallel_for(jobs, chunk_count, 1, lv_meshlets_chunk, &job);
+
+		for (uint32_t c = 0; c < chunk_count; ++c)
+		{
+			memcpy(meshlets + count, job.meshlets + (size_t) c * per_chunk, sizeof(lv_meshlet_s) * job.counts[c]);
+			count += job.counts[c];
+		}
+	}
+
+	lv_scratch_free(job.counts);
+	lv_scratch_free(job.meshlets);
+	return count;
+}
+
+/*
+ * Returns the average length of the edges of the triangles, to size the
+ * cells of the first simplification by.
+ */
+float lv_edge_length(const float *positions, const uint32_t *indices, uint32_t index_count)
+{
+	double sum = 0.0;
+	for (uint32_t t = 0; t + 2 < index_count; t += 3)
+	{
+		const float *a = positions + (size_t) indices[t + 0] * 3;
+		const float *b = positions + (size_t) indices[t + 1] * 3;
+		const float *c = positions + (size_t) indices[t + 2] * 3;
+		sum += lv_distance(a, b) + lv_distance(b, c) + lv_distance(c, a);
+	}
+
+	return index_count >= 3 ? (float) (sum / (index_count / 3 * 3)) : 0.0f;
+}
+
+/*
+ * Picks the coarsest detail level whose error, projected at `distance`,
+ * stays within `threshold` pixels. `scale` is the viewport height over
+ * 2 * tan(fovy / 2), the size of one unit at a distance of one.
+ */
+uint32_t lv_lod_select(const lv_mesh_lod_s *lods, uint32_t count, float distance, float scale, float threshold)
+{
+	uint32_t lod = 0;
+
+	for (uint32_t i = 1; i < count && distance > 0.0f; ++i)
+	{
+		if (lods[i].error * scale / distance > threshold)
+		{
+			break;
+		}
+		lod = i;
+	}
+
+	return lod;
+}
+
+/*
+ * Returns 0 if the meshlet is outside the frustum, whose planes point
+ * inwards (a, b, c, d with ax + by + cz + d >= 0 inside), or all of its
+ * triangles face away from the eye.
+ */
+int lv_meshlet_visible(const lv_meshlet_s *meshlet, const float eye[3], const float planes[6][4])
+{
+	const float *c = meshlet->center;
+
+	for (int i = 0; planes != NULL && i < 6; ++i)
+	{
+		if (planes[i][0] * c[0] + planes[i][1] * c[1] + planes[i][2] * c[2] + planes[i][3] < -meshlet->radius)
+		{
+			return 0;
+		}
+	}
+
+	float d[3] = { c[0] - eye[0], c[1] - eye[1], c[2] - eye[2] };
+	float along = d[0] * meshlet->cone_axis[0] + d[1] * meshlet->cone_axis[1] + d[2] * meshlet->cone_axis[2];
+
+	return along < meshlet->cone_cutoff * sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) + meshlet->radius;
+}
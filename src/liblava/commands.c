@@ -0,0 +1,686 @@
+
+#include "internal.h"
+
+// https://vulkan-tutorial.com/en/Drawing_a_triangle/Drawing/Command_buffers
+int lv_create_commandpool(lv_state_s *lv)
+{
+	VkCommandPoolCreateInfo poolInfo = { 0 };
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = lv->gqueue.index;
+	// outputs that track damage record a command buffer per frame
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+	if (vkCreateCommandPool(lv->device, &poolInfo, lv_allocator(), &lv->commandpool) != VK_SUCCESS)
+	{
+		return 0;
+	}
+
+	return 1;
+}
+
+// https://vulkan-tutorial.com/en/Drawing_a_triangle/Drawing/Command_buffers
+int lv_create_commandbuffers(lv_state_s *lv)
+{
+	// allocated and recorded per output
+	return lv_outputs_build(lv);
+}
+
+/*
+ * Everything recording the scene into one command buffer needs.
+ */
+struct lv_recording
+{
+	lv_state_s            *lv;
+	lv_output_s           *out;
+	uint32_t               image;	// swapchain image index
+	VkRect2D               area;	// drawn, the rest of the image is left alone
+	int                    preserve;	// the image holds the previous frame
+	VkClearValue           clear_values[2];	// color and depth
+	VkRenderPassBeginInfo  rp_info;
+	VkViewport             viewport;
+	lv_graph_s            *graph;	// kept while the command buffer may run
+};
+
+typedef struct lv_recording lv_recording_s;
+
+/*
+ * Begins rendering into the output without a render pass: the same 
+ * clear, store and resolve the render pass would use, see 
+ * lv_renderpass_create(). The layouts are the render graph's business.
+ */
+static void
+lv_cmd_begin_rendering(lv_recording_s *rec, VkCommandBuffer cb)
+{
+	lv_state_s  *lv  = rec->lv;
+	lv_output_s *out = rec->out;
+
+	VkRenderingAttachmentInfo color = { 0 };
+	color.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+	color.imageView   = out->images.views[rec->image];
+	color.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	color.loadOp      = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	color.storeOp     = VK_ATTACHMENT_STORE_OP_STORE;
+	color.clearValue  = rec->clear_values[0];
+
+	// renders into the multisampled image, resolved into the swapchain
+	// image when rendering ends
+	if (out->msaa.image != VK_NULL_HANDLE)
+	{
+		color.imageView          = out->msaa.view;
+		color.storeOp            = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		color.resolveMode        = VK_RESOLVE_MODE_AVERAGE_BIT;
+		color.resolveImageView   = out->images.views[rec->image];
+		color.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	}
+
+	VkRenderingAttachmentInfo depth = { 0 };
+	depth.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+	depth.imageView   = out->depth.view;
+	depth.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depth.loadOp      = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depth.storeOp     = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depth.clearValue  = rec->clear_values[1];
+
+	VkRenderingInfo info = { 0 };
+	info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+	info.renderArea           = rec->area;
+	info.layerCount           = 1;
+	info.colorAttachmentCount = 1;
+	info.pColorAttachments    = &color;
+
+	if (out->depth.image != VK_NULL_HANDLE)
+	{
+		info.pDepthAttachment   = &depth;
+		info.pStencilAttachment = lv_format_has_stencil(lv->depth_format) ? &depth : NULL;
+	}
+
+	lv->cmd_begin_rendering(cb, &info);
+}
+
+/*
+ * Records the scene, the only pass there is so far.
+ */
+static void
+lv_record_scene(VkCommandBuffer cb, void *user)
+{
+	lv_recording_s *rec = user;
+	lv_state_s *lv = rec->lv;
+
+	if (lv->dynamic_rendering)
+	{
+		lv_cmd_begin_rendering(rec, cb);
+	}
+	else
+	{
+		rec->rp_info.renderPass  = rec->preserve ? lv->render_pass_preserve : lv->render_pass;
+		rec->rp_info.renderArea  = rec->area;
+		rec->rp_info.framebuffer = rec->out->framebuffers.fbs[rec->image];
+		vkCmdBeginRenderPass(cb, &rec->rp_info, VK_SUBPASS_CONTENTS_INLINE);
+	}
+
+	vkCmdSetViewport(cb, 0, 1, &rec->viewport);
+	vkCmdSetScissor(cb, 0, 1, &rec->area);
+
+	// the draws bind their own pipelines, see lv_draws_set()
+	if (lv->draws != NULL)
+	{
+		lv_draws_record(lv, cb, lv->draws);
+	}
+	else
+	{
+		vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, lv->pipeline);
+		//                  .----------- vertexCount
+		//                  |  .-------- instanceCount
+		//                  |  |  .----- firstVertex
+		//                  |  |  |  .-- firstInstance
+		//                  |  |  |  |
+		vkCmdDraw(cb, 3, 1, 0, 0);
+	}
+
+	if (lv->dynamic_rendering)
+	{
+		lv->cmd_end_rendering(cb);
+	}
+	else
+	{
+		vkCmdEndRenderPass(cb);
+	}
+}
+
+/*
+ * Records the scene through a render graph, which takes care of the 
+ * layout transitions and barriers a render pass would do otherwise: the
+ * swapchain image comes from the acquire and goes to present, depth and
+ * multisampled color are discarded between frames. The compiled graph
+ * stays with the command buffer, which may be submitted again, until it
+ * is recorded again or retired along with it.
+ */
+static int
+lv_record_scene_graph(lv_recording_s *rec, VkCommandBuffer cb)
+{
+	lv_state_s  *lv  = rec->lv;
+	lv_output_s *out = rec->out;
+
+	// the command buffer is recorded again, so the previous graph goes
+	lv_graph_s *graph = rec->graph;
+	lv_graph_free(lv, graph);
+
+	int pass = lv_graph_pass(graph, "scene", lv_record_scene, rec);
+
+	lv_graph_image_s image = { 0 };
+	image.image  = out->images.images[rec->image];
+	image.view   = out->images.views[rec->image];
+	image.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+	image.before = LV_USE_PRESENT;
+	image.after  = LV_USE_PRESENT;
+	image.preserve = rec->preserve;
+	lv_graph_use(graph, pass, lv_graph_image(graph, "swapchain", &image), LV_USE_COLOR_ATTACHMENT);
+
+	if (out->msaa.image != VK_NULL_HANDLE)
+	{
+		lv_graph_image_s msaa = { 0 };
+		msaa.image  = out->msaa.image;
+		msaa.view   = out->msaa.view;
+		msaa.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+		msaa.before = LV_USE_COLOR_ATTACHMENT;
+		lv_graph_use(graph, pass, lv_graph_image(graph, "msaa", &msaa), LV_USE_COLOR_ATTACHMENT);
+	}
+
+	if (out->depth.image != VK_NULL_HANDLE)
+	{
+		lv_graph_image_s depth = { 0 };
+		depth.image  = out->depth.image;
+		depth.view   = out->depth.view;
+		depth.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+		depth.before = LV_USE_DEPTH_ATTACHMENT;
+
+		if (lv_format_has_stencil(lv->depth_format))
+		{
+			depth.aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+		}
+		lv_graph_use(graph, pass, lv_graph_image(graph, "depth", &depth), LV_USE_DEPTH_ATTACHMENT);
+	}
+
+	int compiled = lv_graph_compile(lv, graph);
+	if (compiled)
+	{
+		lv_graph_execute(graph, cb);
+	}
+
+	return compiled;
+}
+
+/*
+ * Sets up recording the scene into the output, all of it.
+ */
+static void
+lv_recording_init(lv_state_s *lv, lv_output_s *out, lv_recording_s *rec)
+{
+	VkOffset2D offset = { 0, 0 };
+
+	memset(rec, 0, sizeof(lv_recording_s));
+	rec->lv  = lv;
+	rec->out = out;
+	rec->area.offset = offset;
+	rec->area.extent = out->extent;
+
+	// color and depth, the resolve target is not cleared
+	rec->clear_values[0].color.float32[3]     = 1.0f;
+	rec->clear_values[1].depthStencil.depth   = 1.0f;
+	rec->clear_values[1].depthStencil.stencil = 0;
+
+	rec->rp_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	rec->rp_info.clearValueCount = lv->depth_format != VK_FORMAT_UNDEFINED ? 2 : 1;
+	rec->rp_info.pClearValues    = rec->clear_values;
+
+	VkViewport viewport = { 0.0f, 0.0f, (float) out->extent.width, (float) out->extent.height, 0.0f, 1.0f };
+	rec->viewport = viewport;
+}
+
+/*
+ * Records the scene into the command buffer, for its image.
+ */
+static int
+lv_record_image(lv_recording_s *rec, VkCommandBuffer cb, VkCommandBufferUsageFlags usage)
+{
+	lv_state_s *lv = rec->lv;
+
+	VkCommandBufferBeginInfo cbb_info = { 0 };
+	cbb_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	cbb_info.flags = usage;
+
+	if (vkBeginCommandBuffer(cb, &cbb_info) != VK_SUCCESS)
+	{
+		return 0;
+	}
+
+	// the render pass does its own transitions
+	if (lv->dynamic_rendering)
+	{
+		if (lv_record_scene_graph(rec, cb) == 0)
+		{
+			return 0;
+		}
+	}
+	else
+	{
+		lv_record_scene(cb, rec);
+	}
+
+	return vkEndCommandBuffer(cb) == VK_SUCCESS;
+}
+
+/*
+ * Records the draw commands into the command buffers of one output. The
+ * pipeline is shared by all outputs, viewport and scissor are dynamic.
+ * Uses dynamic rendering if the device was created with it, otherwise
+ * the render pass and the framebuffers of the output.
+ */
+int lv_output_record(lv_state_s *lv, lv_output_s *out)
+{
+	lv_recording_s rec;
+	lv_recording_init(lv, out, &rec);
+
+	for (uint32_t i = 0; i < out->commandbuffers.count; ++i)
+	{
+		// an image may be acquired again while the frame that drew it
+		// last is still in flight
+		rec.image = i;
+		rec.graph = &out->graphs[LV_FRAMES_IN_FLIGHT + i];
+		if (lv_record_image(&rec, out->commandbuffers.cbs[i], VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT) == 0)
+		{
+			return 0;
+		}
+	}
+	
+	return 1;
+}
+
+/*
+ * Records the frame's command buffer for drawing only the given area of
+ * the acquired image; the image keeps what it has outside of it, unless
+ * the area covers all of it anyway.
+ */
+static int
+lv_output_record_frame(lv_state_s *lv, lv_output_s *out, VkRect2D area, uint32_t slot)
+{
+	lv_recording_s rec;
+	lv_recording_init(lv, out, &rec);
+
+	rec.image    = out->image_index;
+	rec.preserve = area.offset.x != 0 || area.offset.y != 0 
+		|| area.extent.width != out->extent.width || area.extent.height != out->extent.height;
+	rec.area     = area;
+	rec.graph    = &out->graphs[slot];
+
+	return lv_record_image(&rec, out->frame_cbs[slot], VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+}
+
+/*
+ * Has the next frame record the output's command buffers again, on the
+ * thread that draws and once the frames in flight are done with them.
+ */
+void lv_output_rerecord(lv_state_s *lv, lv_output_s *out)
+{
+	out->rerecord = 1;
+	atomic_store(&lv->rerecord, 1);
+}
+
+/*
+ * Records the command buffers of all outputs again with the next frame,
+ * e.g. after the pipeline has changed. Safe to call from any thread, it
+ * doesn't wait for anything.
+ */
+int lv_record_commandbuffers(lv_state_s *lv)
+{
+	pthread_mutex_lock(&lv->outputs_lock);
+	for (uint32_t i = 0; i < lv->output_count; ++i)
+	{
+		lv_output_s *out = &lv->outputs[i];
+		if (out->used && out->commandbuffers.cbs != NULL)
+		{
+			lv_output_rerecord(lv, out);
+		}
+
+		// whatever changed, it changed everywhere
+		out->damage.full = 1;
+	}
+	pthread_mutex_unlock(&lv->outputs_lock);
+
+	lv_invalidate(lv);
+	return 1;
+}
+
+// https://vulkan-tutorial.com/en/Drawing_a_triangle/Drawing/Rendering_and_presentation 
+int lv_create_semaphores(lv_state_s *lv)
+{
+	VkSemaphoreCreateInfo info = { 0 };
+	info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	for (uint32_t i = 0; i < LV_FRAMES_IN_FLIGHT; ++i)
+	{
+		if (vkCreateSemaphore(lv->device, &info, lv_allocator(), &lv->frames[i].render_finished) != VK_SUCCESS)
+		{
+			return 0;
+		}
+	}
+
+	// only the graphics queue submits, presents are ordered by render_finished
+	if (lv_timeline_create(lv, &lv->gqueue) == 0)
+	{
+		return 0;
+	}
+
+	// image_available per output and frame slot
+	return lv_outputs_build(lv);
+}
+
+/*
+ * An output the frame draws to, with what it needs of the output while
+ * outputs_lock isn't held. The output can't go away in the meantime, see
+ * lv_output_remove().
+ */
+struct lv_frame_target
+{
+	uint32_t          output;	// index
+	VkSwapchainKHR    swapchain;
+	VkSemaphore       image_available;
+	uint32_t          image;
+	int               acquired;
+};
+
+typedef struct lv_frame_target lv_frame_target_s;
+
+/*
+ * Gives up on the image acquired for the output by a frame that couldn't
+ * be submitted. Nothing waited for image_available, so the slot gets a
+ * new one, and a new swapchain takes the place of the one the image is
+ * still acquired from. The damage is drawn in full next time.
+ */
+static void
+lv_output_unacquire(lv_state_s *lv, lv_output_s *out, uint32_t slot)
+{
+	VkSemaphoreCreateInfo info = { 0 };
+	info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	lv_retire(lv, VK_OBJECT_TYPE_SEMAPHORE, (uint64_t) out->image_available[slot]);
+	if (vkCreateSemaphore(lv->device, &info, lv_allocator(), &out->image_available[slot]) != VK_SUCCESS)
+	{
+		lv_log(LV_LOG_ERROR, "Can not replace the semaphore of an output, it is no longer drawn");
+		out->image_available[slot] = VK_NULL_HANDLE;
+	}
+
+	out->damage.full = 1;
+	atomic_store(&out->stale, 1);
+}
+
+/*
+ * Draws one frame to every output: acquires an image from each swapchain,
+ * submits all their command buffers at once and presents all of them 
+ * with a single vkQueuePresentKHR. Outputs that can't acquire an image 
+ * (e.g. a minimized window) are skipped for this frame. If an output 
+ * fails to record, the others are still drawn and 0 is returned.
+ *
+ * Doesn't wait for the frame, only for the one that used its slot
+ * LV_FRAMES_IN_FLIGHT frames before, so recording overlaps the GPU.
+ * outputs_lock is only held to pick the outputs and to record them,
+ * never while acquiring, submitting, presenting or waiting, so other
+ * threads adding or removing outputs aren't held up by the frame.
+ */
+int lv_draw_frame(lv_state_s *lv)
+{
+	lv_frame_target_s    targets[LV_MAX_OUTPUTS];
+	VkSemaphore          sem_wait[LV_MAX_OUTPUTS];
+	VkPipelineStageFlags wait_stages[LV_MAX_OUTPUTS];
+	VkCommandBuffer      cbs[LV_MAX_OUTPUTS];
+	VkSwapchainKHR       swapchains[LV_MAX_OUTPUTS];
+	uint32_t             image_indices[LV_MAX_OUTPUTS];
+	VkResult             results[LV_MAX_OUTPUTS];
+	VkPresentRegionKHR   regions[LV_MAX_OUTPUTS];
+	uint32_t             presented[LV_MAX_OUTPUTS];	// output of each swapchain
+	int                  incremental = 0;
+	int                  failed = 0;
+	uint32_t             target_count = 0;
+	uint32_t             count = 0;	// outputs drawn
+	uint32_t             waits = 0;	// acquired, count and the ones that failed
+	double               start = lv_time_ms();
+
+	// the slot's semaphores and command buffers are free again once the
+	// frame that used them last is done
+	uint32_t         slot_index = (uint32_t) (lv->frame_count % LV_FRAMES_IN_FLIGHT);
+	lv_frame_slot_s *slot       = &lv->frames[slot_index];
+	lv_timeline_wait(lv, &lv->gqueue, slot->value, UINT64_MAX);
+
+	// the outputs' command buffers may be used by any frame in flight, 
+	// they are recorded again once none is; outputs asked for after this 
+	// are left to the next frame, which waits again
+	int rerecord = atomic_exchange(&lv->rerecord, 0);
+	if (rerecord)
+	{
+		lv_timeline_wait(lv, &lv->gqueue, lv->gqueue.submitted, UINT64_MAX);
+	}
+
+	pthread_mutex_lock(&lv->outputs_lock);
+
+	// retired command buffers go back to the pool, which the lock guards
+	lv_retire_collect(lv);
+
+	for (uint32_t i = 0; i < lv->output_count; ++i)
+	{
+		lv_output_s *out = &lv->outputs[i];
+		if (out->used && out->rerecord && rerecord && out->commandbuffers.cbs != NULL)
+		{
+			out->rerecord = 0;
+			if (lv_output_record(lv, out) == 0)
+			{
+				lv_log(LV_LOG_ERROR, "Output %u: recording the command buffers failed", i);
+				failed = 1;
+			}
+		}
+
+		if (out->used == 0 || out->image_available[slot_index] == VK_NULL_HANDLE)
+		{
+			continue;
+		}
+
+		lv_damage_receive(out);
+		if (lv_damage_pending(out) == 0)
+		{
+			continue;
+		}
+
+		// stays stale until it has a swapchain again
+		if (atomic_exchange(&out->stale, 0) && lv_output_rebuild(lv, out) == 0)
+		{
+			atomic_store(&out->stale, 1);
+			continue;
+		}
+
+		lv_frame_target_s *target = &targets[target_count++];
+		target->output          = i;
+		target->swapchain       = out->swapchain;
+		target->image_available = out->image_available[slot_index];
+		target->acquired        = 0;
+		out->drawing = 1;
+	}
+
+	pthread_mutex_unlock(&lv->outputs_lock);
+
+	for (uint32_t i = 0; i < target_count; ++i)
+	{
+		lv_frame_target_s *target = &targets[i];
+
+		VkResult acquired = vkAcquireNextImageKHR(lv->device, target->swapchain, UINT64_MAX, 
+				target->image_available, VK_NULL_HANDLE, &target->image);
+
+		// a suboptimal swapchain still presents, it is rebuilt next frame
+		if (acquired == VK_ERROR_OUT_OF_DATE_KHR || acquired == VK_SUBOPTIMAL_KHR)
+		{
+			atomic_store(&lv->outputs[target->output].stale, 1);
+			lv_invalidate(lv);
+		}
+
+		target->acquired = acquired == VK_SUCCESS || acquired == VK_SUBOPTIMAL_KHR;
+	}
+
+	pthread_mutex_lock(&lv->outputs_lock);
+
+	for (uint32_t i = 0; i < target_count; ++i)
+	{
+		lv_frame_target_s *target = &targets[i];
+		lv_output_s *out = &lv->outputs[target->output];
+		if (target->acquired == 0)
+		{
+			continue;
+		}
+
+		// no rectangles present all of it
+		out->image_index = target->image;
+		VkCommandBuffer cb = out->commandbuffers.cbs[out->image_index];
+		memset(&regions[count], 0, sizeof(VkPresentRegionKHR));
+		// a draw list may change every frame, so it is recorded every
+		// frame, like the damage
+		if (out->damage.enabled || lv->draws != NULL)
+		{
+			VkRect2D area = { { 0, 0 }, out->extent };
+			if (out->damage.enabled)
+			{
+				area = lv_damage_take(out, out->image_index, &regions[count]);
+			}
+
+			cb = out->frame_cbs[slot_index];
+			if (lv_output_record_frame(lv, out, area, slot_index) == 0)
+			{
+				// the acquire signals image_available all the same, the
+				// submit has to wait for it before it is used again; the
+				// image isn't presented, a new swapchain takes its place 
+				// and the damage is drawn next time
+				lv_log(LV_LOG_ERROR, "Output %u: recording the frame failed", target->output);
+				out->damage.full = 1;
+				atomic_store(&out->stale, 1);
+				failed = 1;
+
+				sem_wait[waits]    = target->image_available;
+				wait_stages[waits] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+				++waits;
+				continue;
+			}
+			incremental |= regions[count].rectangleCount > 0;
+		}
+
+		sem_wait[waits]      = target->image_available;
+		wait_stages[waits]   = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		++waits;
+		cbs[count]           = cb;
+		swapchains[count]    = target->swapchain;
+		image_indices[count] = target->image;
+		presented[count]     = target->output;
+		++count;
+	}
+
+	pthread_mutex_unlock(&lv->outputs_lock);
+
+	uint64_t frame = 0;
+	if (waits > 0)
+	{
+		VkSemaphore sem_signal[] = { slot->render_finished };
+
+		// nothing presents, and waits for render_finished, if all failed
+		VkSubmitInfo submit_info = { 0 };
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.waitSemaphoreCount   = waits;
+		submit_info.pWaitSemaphores      = sem_wait;
+		submit_info.pWaitDstStageMask    = wait_stages;
+		submit_info.commandBufferCount   = count;
+		submit_info.pCommandBuffers      = cbs;
+		submit_info.signalSemaphoreCount = count > 0 ? 1 : 0;
+		submit_info.pSignalSemaphores    = sem_signal;
+
+		frame = lv_queue_submit(lv, &lv->gqueue, &submit_info, NULL, 0);
+		if (frame == 0)
+		{
+			failed = 1;
+			count  = 0;
+		}
+		else
+		{
+			slot->value = frame;
+			++lv->frame_count;
+		}
+
+		VkPresentInfoKHR presentInfo = { 0 };
+		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+		presentInfo.waitSemaphoreCount = 1;
+		presentInfo.pWaitSemaphores    = sem_signal;
+		presentInfo.swapchainCount     = count;
+		presentInfo.pSwapchains        = swapchains;
+		presentInfo.pImageIndices      = image_indices;
+		presentInfo.pResults           = results;
+
+		VkPresentRegionsKHR present_regions = { 0 };
+		present_regions.sType = VK_STRUCTURE_TYPE_PRESENT_REGIONS_KHR;
+		present_regions.swapchainCount = count;
+		present_regions.pRegions       = regions;
+
+		if (lv->incremental_present && incremental)
+		{
+			presentInfo.pNext = &present_regions;
+		}
+
+		if (count > 0)
+		{
+			lv_queue_present(lv, &presentInfo);
+		}
+	}
+
+	// hands the outputs back, and removes the ones that were removed
+	// while they were drawn, now that the frame is done with them
+	pthread_mutex_lock(&lv->outputs_lock);
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (results[i] == VK_ERROR_OUT_OF_DATE_KHR || results[i] == VK_SUBOPTIMAL_KHR)
+		{
+			atomic_store(&lv->outputs[presented[i]].stale, 1);
+			lv_invalidate(lv);
+		}
+	}
+
+	for (uint32_t i = 0; i < target_count; ++i)
+	{
+		lv_output_s *out = &lv->outputs[targets[i].output];
+		if (frame == 0 && targets[i].acquired)
+		{
+			lv_output_unacquire(lv, out, slot_index);
+			lv_invalidate(lv);
+		}
+
+		out->drawing = 0;
+		if (out->removed)
+		{
+			lv_output_release(lv, out);
+		}
+	}
+
+	pthread_mutex_unlock(&lv->outputs_lock);
+
+	if (frame == 0)
+	{
+		return failed == 0;
+	}
+
+	// once per frame, however many outputs recorded the list
+	if (lv->draws != NULL && count > 0)
+	{
+		lv_timings_draws(lv, &lv->draws->stats);
+	}
+
+	lv_frame_finished(lv, lv_time_ms() - start);
+
+	if (lv->timings.first_frame == 0.0)
+	{
+		lv->timings.first_frame = lv_time_ms() - lv->timings.start;
+	}
+
+	return failed == 0;
+}
@@ -0,0 +1,729 @@
+#include <time.h>              // clock_gettime()
+#include <stdarg.h>            // va_list, va_start(), va_end()
+
+#include "internal.h"
+
+static lv_log_level_e lv_log_max = LV_LOG_INFO;
+
+/*
+ * Sets the most verbose level that lv_log() still prints.
+ */
+void lv_log_level(lv_log_level_e level)
+{
+	lv_log_max = level;
+}
+
+/*
+ * Writes a message to stderr, prefixed with its level, unless the level 
+ * is more verbose than what was set with lv_log_level().
+ */
+void lv_log(lv_log_level_e level, const char *format, ...)
+{
+	static const char *prefixes[] = { "error", "warning", "info", "debug" };
+
+	if (level > lv_log_max)
+	{
+		return;
+	}
+
+	va_list args;
+	va_start(args, format);
+	fprintf(stderr, "[%s] ", prefixes[level]);
+	vfprintf(stderr, format, args);
+	fputc('\n', stderr);
+	va_end(args);
+}
+
+/*
+ * Returns a monotonic timestamp in milliseconds.
+ */
+double lv_time_ms()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/*
+ * Host allocation callbacks handed to every vkCreate*() / vkDestroy*().
+ * Allocations are served by scope: command scope from a bump arena per 
+ * thread, object scope from size class pools, the rest from the heap.
+ * Live bytes and counts are tracked per scope.
+ */
+static lv_allocations_s      lv_allocations;
+static lv_pool_s             lv_pools[LV_POOL_CLASSES];
+static pthread_key_t         lv_arena_key;
+static pthread_once_t        lv_allocator_once = PTHREAD_ONCE_INIT;
+static int                   lv_allocator_off;
+static _Thread_local size_t  lv_thread_allocations;
+
+static size_t
+lv_align_up(size_t value, size_t align)
+{
+	return (value + align - 1) & ~(align - 1);
+}
+
+/*
+ * Drops a block, or the thread's own reference; the last one frees the
+ * arena.
+ */
+static void
+lv_arena_release(lv_arena_s *arena)
+{
+	if (atomic_fetch_sub(&arena->live, 1) == 1)
+	{
+		free(arena->base);
+		free(arena);
+	}
+}
+
+/*
+ * Called when a thread exits. Its blocks may still be freed by others
+ * later, the thread only lets go of its own reference.
+ */
+static void
+lv_arena_destroy(void *arg)
+{
+	lv_arena_release(arg);
+}
+
+static lv_arena_s*
+lv_arena_get()
+{
+	lv_arena_s *arena = pthread_getspecific(lv_arena_key);
+	if (arena != NULL)
+	{
+		return arena;
+	}
+
+	arena = calloc(1, sizeof(lv_arena_s));
+	if (arena == NULL)
+	{
+		return NULL;
+	}
+
+	arena->base = malloc(LV_ARENA_SIZE);
+	if (arena->base == NULL || pthread_setspecific(lv_arena_key, arena) != 0)
+	{
+		free(arena->base);
+		free(arena);
+		return NULL;
+	}
+
+	// the thread's own reference, see lv_arena_destroy()
+	atomic_init(&arena->live, 1);
+	return arena;
+}
+
+static void*
+lv_arena_alloc(lv_arena_s *arena, size_t size)
+{
+	// everything handed out has been returned, start over
+	if (atomic_load(&arena->live) == 1)
+	{
+		arena->top = 0;
+	}
+
+	size = lv_align_up(size, LV_ALLOC_ALIGN);
+	if (arena->top + size > LV_ARENA_SIZE)
+	{
+		return NULL;
+	}
+
+	void *block = arena->base + arena->top;
+	arena->top += size;
+	atomic_fetch_add(&arena->live, 1);
+	return block;
+}
+
+static int
+lv_pool_class(size_t size)
+{
+	for (int i = 0; i < LV_POOL_CLASSES; ++i)
+	{
+		if (size <= ((size_t) 1 << (LV_POOL_MIN_SHIFT + i)))
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static void*
+lv_pool_alloc(lv_pool_s *pool)
+{
+	pthread_mutex_lock(&pool->lock);
+
+	if (pool->free == NULL)
+	{
+		char *slab = malloc(LV_POOL_SLAB_SIZE);
+		if (slab == NULL)
+		{
+			pthread_mutex_unlock(&pool->lock);
+			return NULL;
+		}
+
+		*(void **) slab = pool->slabs;
+		pool->slabs = slab;
+
+		// the first block holds the slab link
+		for (size_t at = pool->block_size; at + pool->block_size <= LV_POOL_SLAB_SIZE; at += pool->block_size)
+		{
+			*(void **) (slab + at) = pool->free;
+			pool->free = slab + at;
+		}
+	}
+
+	void *block = pool->free;
+	pool->free = *(void **) block;
+
+	pthread_mutex_unlock(&pool->lock);
+	return block;
+}
+
+static void
+lv_pool_release(lv_pool_s *pool, void *block)
+{
+	pthread_mutex_lock(&pool->lock);
+	*(void **) block = pool->free;
+	pool->free = block;
+	pthread_mutex_unlock(&pool->lock);
+}
+
+static void
+lv_allocator_init()
+{
+	pthread_key_create(&lv_arena_key, lv_arena_destroy);
+
+	for (int i = 0; i < LV_POOL_CLASSES; ++i)
+	{
+		pthread_mutex_init(&lv_pools[i].lock, NULL);
+		lv_pools[i].block_size = (size_t) 1 << (LV_POOL_MIN_SHIFT + i);
+	}
+}
+
+/*
+ * Returns `size` bytes aligned to `align`, served according to `scope`.
+ */
+static void*
+lv_host_alloc(size_t size, size_t align, VkSystemAllocationScope scope)
+{
+	pthread_once(&lv_allocator_once, lv_allocator_init);
+
+	align = align < LV_ALLOC_ALIGN ? LV_ALLOC_ALIGN : align;
+	size_t need = sizeof(lv_alloc_header_s) + align - 1 + size;
+
+	lv_alloc_source_e source = LV_ALLOC_HEAP;
+	void *owner = NULL;
+	int size_class = -1;
+	char *block = NULL;
+
+	if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND)
+	{
+		lv_arena_s *arena = lv_arena_get();
+		if (arena != NULL && (block = lv_arena_alloc(arena, need)) != NULL)
+		{
+			source = LV_ALLOC_ARENA;
+			owner = arena;
+		}
+	}
+	else if (scope == VK_SYSTEM_ALLOCATION_SCOPE_OBJECT && (size_class = lv_pool_class(need)) >= 0)
+	{
+		if ((block = lv_pool_alloc(&lv_pools[size_class])) != NULL)
+		{
+			source = LV_ALLOC_POOL;
+			owner = &lv_pools[size_class];
+		}
+	}
+
+	if (block == NULL && (block = malloc(need)) == NULL)
+	{
+		return NULL;
+	}
+
+	char *ptr = (char *) lv_align_up((uintptr_t) block + sizeof(lv_alloc_header_s), align);
+
+	lv_alloc_header_s *header = (lv_alloc_header_s *) ptr - 1;
+	header->size       = size;
+	header->owner      = owner;
+	header->offset     = ptr - block;
+	header->scope      = scope;
+	header->source     = source;
+	header->size_class = size_class;
+
+	atomic_fetch_add(&lv_allocations.live_bytes[scope], size);
+	atomic_fetch_add(&lv_allocations.live_count[scope], 1);
+	atomic_fetch_add(&lv_allocations.total_count[scope], 1);
+	atomic_fetch_add(&lv_allocations.source_count[source], 1);
+	++lv_thread_allocations;
+
+	return ptr;
+}
+
+static void
+lv_host_free(void *ptr)
+{
+	if (ptr == NULL)
+	{
+		return;
+	}
+
+	lv_alloc_header_s *header = (lv_alloc_header_s *) ptr - 1;
+	char *block = (char *) ptr - header->offset;
+
+	atomic_fetch_sub(&lv_allocations.live_bytes[header->scope], header->size);
+	atomic_fetch_sub(&lv_allocations.live_count[header->scope], 1);
+
+	switch (header->source)
+	{
+		case LV_ALLOC_ARENA:
+			lv_arena_release(header->owner);
+			break;
+		case LV_ALLOC_POOL:
+			lv_pool_release(header->owner, block);
+			break;
+		default:
+			free(block);
+	}
+}
+
+static VKAPI_ATTR void* VKAPI_CALL
+lv_vk_alloc(void *user, size_t size, size_t align, VkSystemAllocationScope scope)
+{
+	return lv_host_alloc(size, align, scope);
+}
+
+static VKAPI_ATTR void* VKAPI_CALL
+lv_vk_realloc(void *user, void *original, size_t size, size_t align, VkSystemAllocationScope scope)
+{
+	if (original == NULL)
+	{
+		return lv_host_alloc(size, align, scope);
+	}
+
+	if (size == 0)
+	{
+		lv_host_free(original);
+		return NULL;
+	}
+
+	void *ptr = lv_host_alloc(size, align, scope);
+	if (ptr == NULL)
+	{
+		// the original stays valid
+		return NULL;
+	}
+
+	size_t old_size = ((lv_alloc_header_s *) original - 1)->size;
+	memcpy(ptr, original, old_size < size ? old_size : size);
+	lv_host_free(original);
+	return ptr;
+}
+
+static VKAPI_ATTR void VKAPI_CALL
+lv_vk_free(void *user, void *ptr)
+{
+	lv_host_free(ptr);
+}
+
+static VKAPI_ATTR void VKAPI_CALL
+lv_vk_internal_alloc(void *user, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope)
+{
+	atomic_fetch_add(&lv_allocations.internal_bytes[scope], size);
+}
+
+static VKAPI_ATTR void VKAPI_CALL
+lv_vk_internal_free(void *user, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope)
+{
+	atomic_fetch_sub(&lv_allocations.internal_bytes[scope], size);
+}
+
+static VkAllocationCallbacks lv_callbacks = 
+{
+	.pfnAllocation         = lv_vk_alloc,
+	.pfnReallocation       = lv_vk_realloc,
+	.pfnFree               = lv_vk_free,
+	.pfnInternalAllocation = lv_vk_internal_alloc,
+	.pfnInternalFree       = lv_vk_internal_free
+};
+
+/*
+ * Returns the allocation callbacks to pass to Vulkan, or NULL to use the
+ * driver's own allocator if lv_allocator_disable() has been called.
+ */
+const VkAllocationCallbacks *lv_allocator()
+{
+	return lv_allocator_off ? NULL : &lv_callbacks;
+}
+
+/*
+ * Makes lv_allocator() return NULL, for comparing against the driver's 
+ * allocator. Objects must be destroyed with the callbacks they were 
+ * created with, so this has to be called before creating the instance.
+ */
+void lv_allocator_disable()
+{
+	lv_allocator_off = 1;
+}
+
+/*
+ * Returns the slabs of the size class pools. Only valid once every 
+ * Vulkan object has been destroyed.
+ */
+void lv_allocator_free()
+{
+	for (int i = 0; i < LV_POOL_CLASSES; ++i)
+	{
+		lv_pool_s *pool = &lv_pools[i];
+		pthread_mutex_lock(&pool->lock);
+
+		while (pool->slabs != NULL)
+		{
+			void *next = *(void **) pool->slabs;
+			free(pool->slabs);
+			pool->slabs = next;
+		}
+
+		pool->free = NULL;
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+/*
+ * Scratch memory for temporary arrays, bumped off the calling thread's 
+ * arena like command scope allocations, but not counted as the driver's.
+ * Release with lv_scratch_free(), on any thread.
+ */
+void *lv_scratch_alloc(size_t size)
+{
+	pthread_once(&lv_allocator_once, lv_allocator_init);
+
+	size_t need = sizeof(lv_alloc_header_s) + LV_ALLOC_ALIGN - 1 + size;
+	lv_arena_s *arena = lv_arena_get();
+	char *block = arena ? lv_arena_alloc(arena, need) : NULL;
+
+	lv_alloc_source_e source = LV_ALLOC_ARENA;
+	if (block == NULL)
+	{
+		if ((block = malloc(need)) == NULL)
+		{
+			return NULL;
+		}
+		source = LV_ALLOC_HEAP;
+		arena  = NULL;
+	}
+
+	// aligned the same as what lv_host_alloc() hands out
+	char *ptr = (char *) lv_align_up((uintptr_t) block + sizeof(lv_alloc_header_s), LV_ALLOC_ALIGN);
+
+	lv_alloc_header_s *header = (lv_alloc_header_s *) ptr - 1;
+	memset(header, 0, sizeof(lv_alloc_header_s));
+	header->size   = size;
+	header->owner  = arena;
+	header->offset = ptr - block;
+	header->source = source;
+
+	return ptr;
+}
+
+void lv_scratch_free(void *ptr)
+{
+	if (ptr == NULL)
+	{
+		return;
+	}
+
+	lv_alloc_header_s *header = (lv_alloc_header_s *) ptr - 1;
+	if (header->source == LV_ALLOC_ARENA)
+	{
+		lv_arena_release(header->owner);
+	}
+	else
+	{
+		free((char *) ptr - header->offset);
+	}
+}
+
+/*
+ * Prints what the driver currently holds, by allocation scope, and how
+ * the allocations made so far were served.
+ */
+void lv_print_allocations()
+{
+	static const char *scopes[] = { "command", "object", "cache", "device", "instance" };
+
+	fprintf(stdout, "%-10s %12s %8s %8s %12s\n", "Scope", "live bytes", "live", "total", "internal");
+	for (int i = 0; i < LV_SCOPE_COUNT; ++i)
+	{
+		fprintf(stdout, "%-10s %12zu %8zu %8zu %12zu\n", scopes[i],
+				atomic_load(&lv_allocations.live_bytes[i]),
+				atomic_load(&lv_allocations.live_count[i]),
+				atomic_load(&lv_allocations.total_count[i]),
+				atomic_load(&lv_allocations.internal_bytes[i]));
+	}
+
+	fprintf(stdout, "served: %zu arena, %zu pool, %zu heap\n",
+			atomic_load(&lv_allocations.source_count[LV_ALLOC_ARENA]),
+			atomic_load(&lv_allocations.source_count[LV_ALLOC_POOL]),
+			atomic_load(&lv_allocations.source_count[LV_ALLOC_HEAP]));
+}
+
+/*
+ * Returns the current time and the number of host allocations the driver
+ * made on this thread, to be passed to lv_timings_add() later.
+ */
+lv_mark_s lv_mark()
+{
+	lv_mark_s mark = { lv_time_ms(), lv_thread_allocations };
+	return mark;
+}
+
+/*
+ * Marks the start of the initialization, all phases are relative to it.
+ */
+void lv_timings_start(lv_state_s *lv)
+{
+	lv->timings.start = lv_time_ms();
+	lv->timings.first_frame = 0.0;
+	atomic_store(&lv->timings.count, 0);
+	memset(&lv->timings.draws, 0, sizeof(lv_draw_totals_s));
+}
+
+/*
+ * Records a phase that ran from `start` until now, where `start` is a 
+ * value previously returned by lv_mark() on the same thread. Allocations
+ * the driver makes on threads of its own are not included. Safe to call
+ * from any thread.
+ */
+void lv_timings_add(lv_state_s *lv, const char *name, lv_mark_s start)
+{
+	lv_mark_s now = lv_mark();
+	unsigned index = atomic_fetch_add(&lv->timings.count, 1);
+
+	if (index >= LV_MAX_PHASES)
+	{
+		return;
+	}
+
+	lv_phase_s *phase = &lv->timings.phases[index];
+	phase->name        = name;
+	phase->start       = start.ms - lv->timings.start;
+	phase->duration    = now.ms - start.ms;
+	phase->allocations = now.allocations - start.allocations;
+}
+
+/*
+ * Adds what sorting and recording a draw list cost and saved in a frame
+ * to the totals.
+ */
+void lv_timings_draws(lv_state_s *lv, const lv_draw_stats_s *stats)
+{
+	lv_draw_totals_s *draws = &lv->timings.draws;
+	draws->draws          += stats->draws;
+	draws->binds          += stats->binds;
+	draws->binds_unsorted += stats->binds_unsorted;
+	draws->sort_ms        += stats->sort_ms;
+	draws->record_ms      += stats->record_ms;
+	++draws->frames;
+}
+
+/*
+ * Returns the ms from lv_timings_start() until the first frame has been
+ * presented, or 0 if that hasn't happened yet.
+ */
+double lv_timings_first_frame(lv_state_s *lv)
+{
+	return lv->timings.first_frame;
+}
+
+/*
+ * Prints all recorded phases in the order they started, along with the
+ * time until the first frame has been presented. Phases that overlap
+ * make the sum of all durations exceed the wall time. If draw lists were
+ * recorded, follows with what an average recording took and how many
+ * binds sorting saved. Comparing the times needs runs with the lists
+ * `unsorted` and without.
+ */
+void lv_print_timings(lv_state_s *lv)
+{
+	unsigned count = atomic_load(&lv->timings.count);
+	count = count < LV_MAX_PHASES ? count : LV_MAX_PHASES;
+
+	int order[LV_MAX_PHASES];
+	for (unsigned i = 0; i < count; ++i)
+	{
+		// insertion sort by start time, there are only a few phases
+		unsigned j = i;
+		for (; j > 0 && lv->timings.phases[order[j - 1]].start > lv->timings.phases[i].start; --j)
+		{
+			order[j] = order[j - 1];
+		}
+		order[j] = i;
+	}
+
+	double sum = 0.0;
+	fprintf(stdout, "%-20s %10s %10s %10s\n", "Phase", "start ms", "took ms", "host allocs");
+	for (unsigned i = 0; i < count; ++i)
+	{
+		lv_phase_s *phase = &lv->timings.phases[order[i]];
+		fprintf(stdout, "%-20s %10.2f %10.2f %10zu\n", phase->name, phase->start, phase->duration, phase->allocations);
+		sum += phase->duration;
+	}
+
+	fprintf(stdout, "%-20s %10s %10.2f\n", "(sum of phases)", "", sum);
+	fprintf(stdout, "%-20s %10s %10.2f\n", "time to first frame", "", lv->timings.first_frame);
+
+	const lv_draw_totals_s *draws = &lv->timings.draws;
+	if (draws->frames > 0)
+	{
+		double n = (double) draws->frames;
+		fprintf(stdout, "%-20s %10s %10s %10s %10s %10s\n", "Draws", "count", "binds", "unsorted", "sort ms", "record ms");
+		fprintf(stdout, "%-20s %10.0f %10.0f %10.0f %10.3f %10.3f\n", "per frame", draws->draws / n,
+				draws->binds / n, draws->binds_unsorted / n, draws->sort_ms / n, draws->record_ms / n);
+	}
+}
+
+static void*
+lv_task_run(void *arg)
+{
+	lv_task_s *task = arg;
+	task->result = task->fn(task->arg);
+	return NULL;
+}
+
+/*
+ * Runs fn(arg) on a new thread. If no thread can be created, fn is run
+ * right away instead, so the caller doesn't have to handle that case.
+ */
+void lv_task_start(lv_task_s *task, int (*fn)(void *), void *arg)
+{
+	task->fn     = fn;
+	task->arg    = arg;
+	task->result = 0;
+
+	if (pthread_create(&task->thread, NULL, lv_task_run, task) != 0)
+	{
+		task->fn = NULL;
+		task->result = fn(arg);
+	}
+}
+
+/*
+ * Waits for the task to finish and returns what its function returned.
+ */
+int lv_task_join(lv_task_s *task)
+{
+	if (task->fn != NULL)
+	{
+		pthread_join(task->thread, NULL);
+		task->fn = NULL;
+	}
+
+	return task->result;
+}
+
+// states alive, the last one freed tears down the caps cache and pools
+static pthread_mutex_t lv_states_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned        lv_states;
+
+/*
+ * Returns a new, empty state, or NULL if out of memory. Everything in it
+ * is released again by lv_free().
+ */
+lv_state_s *lv_create()
+{
+	lv_state_s *lv = calloc(1, sizeof(lv_state_s));
+	if (lv == NULL)
+	{
+		return NULL;
+	}
+
+	pthread_mutex_lock(&lv_states_lock);
+	++lv_states;
+	pthread_mutex_unlock(&lv_states_lock);
+
+	pthread_mutex_init(&lv->outputs_lock, NULL);
+	pthread_mutex_init(&lv->retired_lock, NULL);
+	pthread_mutex_init(&lv->submit_lock, NULL);
+	lv_frame_init(&lv->scheduler);
+
+	// the thread creating the state is the one that gets the window events
+	lv->jobs = lv_jobs_create(0);
+	return lv;
+}
+
+VkInstance lv_get_instance(lv_state_s *lv)
+{
+	return lv->instance;
+}
+
+VkPhysicalDevice lv_get_gpu(lv_state_s *lv)
+{
+	return lv->gpu;
+}
+
+VkDevice lv_get_device(lv_state_s *lv)
+{
+	return lv->device;
+}
+
+/*
+ * Returns the job system of the state, NULL if it couldn't be created.
+ * Its main thread is the one that called lv_create().
+ */
+lv_jobs_s *lv_get_jobs(lv_state_s *lv)
+{
+	return lv->jobs;
+}
+
+/*
+ * Releases everything in the state. What all states share goes with the
+ * last one, other states may still be in use.
+ */
+int lv_free(lv_state_s *lv)
+{
+	lv_render_thread_stop(lv);
+	lv_hotreload_stop(lv);
+	lv_jobs_free(lv->jobs);
+	for (uint32_t i = 0; i < lv->output_count; ++i)
+	{
+		lv_output_destroy(lv, &lv->outputs[i]);
+	}
+
+	// the outputs go first, framebuffers and views before their swapchain
+	// and the swapchain before its surface, then what they were made from
+	lv_retire_flush(lv);
+	vkDestroyCommandPool(lv->device, lv->commandpool, lv_allocator());
+	for (uint32_t i = 0; i < LV_FRAMES_IN_FLIGHT; ++i)
+	{
+		vkDestroySemaphore(lv->device, lv->frames[i].render_finished, lv_allocator());
+	}
+	lv_timeline_destroy(lv, &lv->gqueue);
+	lv_pipeline_registry_free(lv->device, &lv->pipelines);
+	vkDestroyPipelineLayout(lv->device, lv->pipeline_layout, lv_allocator());
+	vkDestroyRenderPass(lv->device, lv->render_pass, lv_allocator());
+	vkDestroyRenderPass(lv->device, lv->render_pass_preserve, lv_allocator());
+	vkDestroyPipelineCache(lv->device, lv->pipeline_cache, lv_allocator());
+	lv_shader_module_release(lv->device, &lv->shader_cache, &lv->frag_shader);
+	lv_shader_module_release(lv->device, &lv->shader_cache, &lv->vert_shader);
+	lv_shader_cache_free(lv->device, &lv->shader_cache);
+	vkDestroyDevice(lv->device, lv_allocator());
+	lv_instance_destroy(lv);
+
+	pthread_mutex_lock(&lv_states_lock);
+	if (--lv_states == 0)
+	{
+		lv_caps_free();
+		lv_allocator_free();
+	}
+	pthread_mutex_unlock(&lv_states_lock);
+
+	lv_frame_free(&lv->scheduler);
+	pthread_mutex_destroy(&lv->submit_lock);
+	pthread_mutex_destroy(&lv->retired_lock);
+	pthread_mutex_destroy(&lv->outputs_lock);
+	free(lv);
+
+	return 1;
+}
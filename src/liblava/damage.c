@@ -0,0 +1,312 @@
+#include "internal.h"
+
+//
+// Damage tracking: the application marks what changed on an output, the
+// frame only draws that much and tells the compositor about it through
+// VK_KHR_incremental_present, if the device has it. An output without
+// damage doesn't draw or present at all.
+//
+// A swapchain image still holds what was drawn into it the last time it
+// was used, so it has to catch up on everything that changed since then,
+// not only in the latest frame. Every image keeps the bounds of what it
+// missed; render area and scissor are a single rectangle anyway.
+//
+// Damage is marked from any thread, usually the one handling the window
+// events, while frames are drawn on another. It goes through an inbox per
+// output that takes no lock: every rectangle is packed into a word, which
+// is put into a free slot with a compare and swap and taken out by the
+// frame with an exchange. What doesn't fit damages all of it.
+//
+
+// bounds of a rectangle in the inbox, 16 bits each
+#define LV_DAMAGE_COORD_MAX 0xffff
+
+static int
+lv_rect_empty(VkRect2D r)
+{
+	return r.extent.width == 0 || r.extent.height == 0;
+}
+
+static VkRect2D
+lv_rect_union(VkRect2D a, VkRect2D b)
+{
+	if (lv_rect_empty(a))
+	{
+		return b;
+	}
+	if (lv_rect_empty(b))
+	{
+		return a;
+	}
+
+	int32_t x0 = a.offset.x < b.offset.x ? a.offset.x : b.offset.x;
+	int32_t y0 = a.offset.y < b.offset.y ? a.offset.y : b.offset.y;
+	int32_t ax = a.offset.x + (int32_t) a.extent.width;
+	int32_t bx = b.offset.x + (int32_t) b.extent.width;
+	int32_t ay = a.offset.y + (int32_t) a.extent.height;
+	int32_t by = b.offset.y + (int32_t) b.extent.height;
+
+	VkRect2D u = { { x0, y0 }, { (ax > bx ? ax : bx) - x0, (ay > by ? ay : by) - y0 } };
+	return u;
+}
+
+/*
+ * Cuts the rectangle down to what lies within the extent.
+ */
+static VkRect2D
+lv_rect_clamp(VkRect2D r, VkExtent2D extent)
+{
+	int64_t x0 = r.offset.x > 0 ? r.offset.x : 0;
+	int64_t y0 = r.offset.y > 0 ? r.offset.y : 0;
+	int64_t x1 = (int64_t) r.offset.x + r.extent.width;
+	int64_t y1 = (int64_t) r.offset.y + r.extent.height;
+
+	x1 = x1 < extent.width  ? x1 : extent.width;
+	y1 = y1 < extent.height ? y1 : extent.height;
+
+	VkRect2D c = { { (int32_t) x0, (int32_t) y0 }, { 0, 0 } };
+	if (x1 > x0 && y1 > y0)
+	{
+		c.extent.width  = (uint32_t) (x1 - x0);
+		c.extent.height = (uint32_t) (y1 - y0);
+	}
+	return c;
+}
+
+/*
+ * Packs the rectangle into a word of the inbox, cut down to what fits.
+ * Returns 0 if nothing is left of it.
+ */
+static uint64_t
+lv_rect_pack(VkRect2D r)
+{
+	VkExtent2D bounds = { LV_DAMAGE_COORD_MAX, LV_DAMAGE_COORD_MAX };
+	VkRect2D c = lv_rect_clamp(r, bounds);
+	if (lv_rect_empty(c))
+	{
+		return 0;
+	}
+
+	return (uint64_t) c.offset.x | (uint64_t) c.offset.y << 16
+		| (uint64_t) c.extent.width << 32 | (uint64_t) c.extent.height << 48;
+}
+
+static VkRect2D
+lv_rect_unpack(uint64_t packed)
+{
+	VkRect2D r = { { (int32_t) (packed & 0xffff), (int32_t) (packed >> 16 & 0xffff) },
+		{ (uint32_t) (packed >> 32 & 0xffff), (uint32_t) (packed >> 48) } };
+	return r;
+}
+
+/*
+ * Sets up the damage of a new swapchain: none of its images have been
+ * drawn yet.
+ */
+int lv_damage_create(lv_output_s *out)
+{
+	lv_damage_s *damage = &out->damage;
+	damage->stale = malloc(sizeof(VkRect2D) * out->images.count);
+	if (damage->stale == NULL)
+	{
+		return 0;
+	}
+
+	VkRect2D all = { { 0, 0 }, out->extent };
+	for (uint32_t i = 0; i < out->images.count; ++i)
+	{
+		damage->stale[i] = all;
+	}
+
+	damage->image_count = out->images.count;
+	damage->full = 1;
+	return 1;
+}
+
+void lv_damage_free(lv_output_s *out)
+{
+	free(out->damage.stale);
+	memset(&out->damage, 0, sizeof(lv_damage_s));
+}
+
+/*
+ * Turns damage tracking of an output on or off. With it, frames only
+ * draw what has been marked with lv_output_damage() since the previous
+ * one, and the output is skipped if nothing has. Without it, which is
+ * the default, every frame draws all of it.
+ */
+int lv_output_track_damage(lv_state_s *lv, int index, int enable)
+{
+	if (index < 0 || index >= LV_MAX_OUTPUTS)
+	{
+		return 0;
+	}
+
+	pthread_mutex_lock(&lv->outputs_lock);
+	lv_output_s *out = &lv->outputs[index];
+	int ok = out->used;
+
+	if (ok && out->damage.enabled != enable)
+	{
+		out->damage.enabled = enable;
+		out->damage.full = 1;
+
+		// the images may have been drawn without the damage being tracked
+		VkRect2D all = { { 0, 0 }, out->extent };
+		for (uint32_t i = 0; i < out->damage.image_count; ++i)
+		{
+			out->damage.stale[i] = all;
+		}
+
+		// leaves no command buffer recorded for a part of the output,
+		// the next frame records them all over
+		if (enable == 0 && out->commandbuffers.cbs != NULL)
+		{
+			lv_output_rerecord(lv, out);
+		}
+	}
+	pthread_mutex_unlock(&lv->outputs_lock);
+
+	lv_invalidate(lv);
+
+	return ok;
+}
+
+/*
+ * Puts a packed rectangle into a free slot of the inbox, returns 0 if
+ * there is none.
+ */
+static int
+lv_damage_post(lv_damage_inbox_s *inbox, uint64_t packed)
+{
+	for (uint32_t i = 0; i < LV_MAX_DAMAGE; ++i)
+	{
+		uint64_t free_slot = 0;
+		if (atomic_compare_exchange_strong(&inbox->rects[i], &free_slot, packed))
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Marks a rectangle of an output as changed, all of it if `rect` is NULL,
+ * and asks for a frame. Rectangles past LV_MAX_DAMAGE per frame damage
+ * the whole output. Takes no lock, it can be called from any thread while
+ * frames are drawn, just not for an output that is being removed.
+ */
+int lv_output_damage(lv_state_s *lv, int index, const VkRect2D *rect)
+{
+	if (index < 0 || index >= LV_MAX_OUTPUTS)
+	{
+		return 0;
+	}
+
+	lv_output_s *out = &lv->outputs[index];
+	uint64_t packed = rect != NULL ? lv_rect_pack(*rect) : 0;
+
+	if (rect == NULL || (packed != 0 && lv_damage_post(&out->inbox, packed) == 0))
+	{
+		atomic_store(&out->inbox.full, 1);
+	}
+
+	lv_invalidate(lv);
+	return out->used;
+}
+
+/*
+ * Takes what lv_output_damage() posted since the last frame, on the
+ * thread that draws. Rectangles that are off the output are dropped, so
+ * an output is only pending if there is something to draw.
+ */
+void lv_damage_receive(lv_output_s *out)
+{
+	lv_damage_s       *damage = &out->damage;
+	lv_damage_inbox_s *inbox  = &out->inbox;
+
+	if (atomic_exchange(&inbox->full, 0))
+	{
+		damage->full = 1;
+	}
+
+	for (uint32_t i = 0; i < LV_MAX_DAMAGE; ++i)
+	{
+		// most slots are free, only those are exchanged that aren't
+		if (atomic_load_explicit(&inbox->rects[i], memory_order_relaxed) == 0)
+		{
+			continue;
+		}
+
+		VkRect2D r = lv_rect_clamp(lv_rect_unpack(atomic_exchange(&inbox->rects[i], 0)), out->extent);
+		if (lv_rect_empty(r))
+		{
+			continue;
+		}
+
+		if (damage->count == LV_MAX_DAMAGE)
+		{
+			damage->full = 1;
+		}
+		else
+		{
+			damage->rects[damage->count++] = r;
+		}
+	}
+}
+
+/*
+ * Returns 1 if the output has to be drawn in this frame.
+ */
+int lv_damage_pending(lv_output_s *out)
+{
+	return out->damage.enabled == 0 || out->damage.full || out->damage.count > 0;
+}
+
+/*
+ * Hands the damage of this frame to every image and returns what the
+ * given image, the one about to be drawn, has to catch up on. Fills in
+ * the present region of the frame: no rectangles if all of it changed.
+ */
+VkRect2D lv_damage_take(lv_output_s *out, uint32_t image, VkPresentRegionKHR *region)
+{
+	lv_damage_s *damage = &out->damage;
+	VkRect2D all = { { 0, 0 }, out->extent };
+	VkRect2D changed = { { 0, 0 }, { 0, 0 } };
+
+	damage->present_count = 0;
+	for (uint32_t i = 0; i < damage->count && damage->full == 0; ++i)
+	{
+		VkRect2D r = lv_rect_clamp(damage->rects[i], out->extent);
+		if (lv_rect_empty(r) == 0)
+		{
+			VkRectLayerKHR *layer = &damage->present[damage->present_count++];
+			layer->offset = r.offset;
+			layer->extent = r.extent;
+			layer->layer  = 0;
+			changed = lv_rect_union(changed, r);
+		}
+	}
+
+	if (damage->full)
+	{
+		changed = all;
+		damage->present_count = 0;
+	}
+
+	for (uint32_t i = 0; i < damage->image_count; ++i)
+	{
+		damage->stale[i] = lv_rect_union(damage->stale[i], changed);
+	}
+
+	VkRect2D area = damage->stale[image];
+	memset(&damage->stale[image], 0, sizeof(VkRect2D));
+
+	damage->count = 0;
+	damage->full  = 0;
+
+	region->rectangleCount = damage->present_count;
+	region->pRectangles    = damage->present;
+	return area;
+}
@@ -0,0 +1,873 @@
+
+#include "internal.h"
+
+int lv_device_has_extension(VkPhysicalDevice device, const char *name)
+{
+	pthread_mutex_lock(&lv_caps_lock);
+	lv_device_caps_s *caps = lv_device_caps_get(device);
+
+	int found = caps && bsearch(name, caps->extensions, caps->extension_count, 
+			sizeof(VkExtensionProperties), lv_caps_find_extension) != NULL;
+
+	pthread_mutex_unlock(&lv_caps_lock);
+	return found;
+}
+
+int lv_device_has_graphics_queue(VkPhysicalDevice device, int *idx)
+{
+	pthread_mutex_lock(&lv_caps_lock);
+	lv_device_caps_s *caps = lv_device_caps_get(device);
+
+	int found = 0;
+	for (int i = 0; caps && i < caps->queue_count; ++i)
+	{
+		if (caps->queues[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+		{
+			if (idx != NULL)
+			{
+				*idx = i;
+			}
+
+			found = 1;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&lv_caps_lock);
+	return found;
+}
+
+int lv_device_has_present_queue(VkPhysicalDevice device, VkSurfaceKHR surface, int *idx)
+{
+	pthread_mutex_lock(&lv_caps_lock);
+	lv_surface_caps_s *caps = lv_surface_caps_get(device, surface);
+
+	int found = 0;
+	for (int i = 0; caps && i < caps->queue_count; ++i)
+	{
+		if (caps->queue_present[i])
+		{
+			if (idx != NULL)
+			{
+				*idx = i;
+			}
+
+			found = 1;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&lv_caps_lock);
+	return found;
+}
+
+VkSurfaceCapabilitiesKHR lv_device_surface_get_capabilities(VkPhysicalDevice device, VkSurfaceKHR surface)
+{
+	VkSurfaceCapabilitiesKHR capabilities = { 0 };
+
+	pthread_mutex_lock(&lv_caps_lock);
+	lv_surface_caps_s *caps = lv_surface_caps_get(device, surface);
+	if (caps != NULL)
+	{
+		capabilities = caps->surface_caps;
+	}
+	pthread_mutex_unlock(&lv_caps_lock);
+
+	return capabilities;
+}
+
+int lv_device_surface_format_count(VkPhysicalDevice device, VkSurfaceKHR surface)
+{
+	pthread_mutex_lock(&lv_caps_lock);
+	lv_surface_caps_s *caps = lv_surface_caps_get(device, surface);
+	int format_count = caps ? caps->format_count : 0;
+	pthread_mutex_unlock(&lv_caps_lock);
+
+	return format_count;
+}
+
+int lv_device_surface_has_format(VkPhysicalDevice device, VkSurfaceKHR surface, VkFormat format, VkColorSpaceKHR cspace, int *idx)
+{
+	pthread_mutex_lock(&lv_caps_lock);
+	lv_surface_caps_s *caps = lv_surface_caps_get(device, surface);
+
+	int found = 0;
+	for (int i = 0; caps && i < caps->format_count; ++i)
+	{
+		if (caps->formats[i].format == format && caps->formats[i].colorSpace == cspace)
+		{
+			if (idx != NULL)
+			{
+				*idx = i;
+			}
+
+			found = 1;
+			break;
+		}
+	}
+	
+	pthread_mutex_unlock(&lv_caps_lock);
+	return found;
+}
+
+VkSurfaceFormatKHR lv_device_surface_get_format_by_index(VkPhysicalDevice device, VkSurfaceKHR surface, int index)
+{
+	VkSurfaceFormatKHR format = { 0 };
+	
+	pthread_mutex_lock(&lv_caps_lock);
+	lv_surface_caps_s *caps = lv_surface_caps_get(device, surface);
+
+	if (caps && index < caps->format_count)
+	{
+		format = caps->formats[index];
+	}
+
+	pthread_mutex_unlock(&lv_caps_lock);
+	return format;
+}
+
+int lv_device_surface_present_mode_count(VkPhysicalDevice device, VkSurfaceKHR surface)
+{
+	pthread_mutex_lock(&lv_caps_lock);
+	lv_surface_caps_s *caps = lv_surface_caps_get(device, surface);
+	int present_mode_count = caps ? caps->present_mode_count : 0;
+	pthread_mutex_unlock(&lv_caps_lock);
+
+	return present_mode_count;
+}
+
+VkPresentModeKHR lv_device_surface_get_present_mode_by_index(VkPhysicalDevice device, VkSurfaceKHR surface, int index)
+{
+	VkPresentModeKHR mode = VK_PRESENT_MODE_FIFO_KHR;
+
+	pthread_mutex_lock(&lv_caps_lock);
+	lv_surface_caps_s *caps = lv_surface_caps_get(device, surface);
+
+	if (caps && index < caps->present_mode_count)
+	{
+		mode = caps->present_modes[index];
+	}
+
+	pthread_mutex_unlock(&lv_caps_lock);
+	return mode;
+}
+
+int lv_device_surface_has_present_mode(VkPhysicalDevice device, VkSurfaceKHR surface, VkPresentModeKHR mode, int *idx)
+{
+	pthread_mutex_lock(&lv_caps_lock);
+	lv_surface_caps_s *caps = lv_surface_caps_get(device, surface);
+
+	int found = 0;
+	for (int i = 0; caps && i < caps->present_mode_count; ++i)
+	{
+		if (caps->present_modes[i] == mode)
+		{
+			if (idx != NULL)
+			{
+				*idx = i;
+			}
+
+			found = 1;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&lv_caps_lock);
+	return found;
+}
+
+/*
+ * name needs to have a size of at least
+ * VK_MAX_PHYSICAL_DEVICE_NAME_SIZE
+ */
+void lv_device_name(VkPhysicalDevice device, char *name)
+{
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(device, &props);
+	
+	strncpy(name, props.deviceName, VK_MAX_PHYSICAL_DEVICE_NAME_SIZE);
+}
+
+int lv_print_devices(VkInstance instance)
+{
+	uint32_t device_count = 0;
+	vkEnumeratePhysicalDevices(instance, &device_count, NULL);
+
+	if (device_count == 0)
+	{
+		return 0;
+	}
+
+	VkPhysicalDevice *devices = lv_scratch_alloc(sizeof(VkPhysicalDevice) * device_count);
+	vkEnumeratePhysicalDevices(instance, &device_count, devices);
+
+	char device_name[VK_MAX_PHYSICAL_DEVICE_NAME_SIZE];
+
+	for (int i = 0; i < device_count; ++i)
+	{
+		lv_device_name(devices[i], device_name);
+		fprintf(stdout, "%*d: %s\n", 2, i+1, device_name);
+	}
+
+	lv_scratch_free(devices);
+	return device_count;
+}
+
+/*
+ * Returns the score for the device type alone: discrete beats integrated
+ * beats everything else, with unknown (other) devices at the bottom. 
+ * The gaps are large enough for memory and limits not to bridge them.
+ */
+int lv_device_score(VkPhysicalDevice device)
+{
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(device, &props);
+
+	if (props.deviceType == VK_PHYSICAL_DEVICE_TYPE_OTHER)
+	{
+		return 0;
+	}
+	if (props.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
+	{
+		return 3000;
+	}
+	if (props.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU)
+	{
+		return 2000;
+	}
+	// Any other type
+	return 1000;
+}
+
+int lv_swapchain_adequate(VkPhysicalDevice device, VkSurfaceKHR surface)
+{
+	return lv_device_surface_format_count(device, surface) &&
+		lv_device_surface_present_mode_count(device, surface);
+}
+
+/*
+ * Returns 1 if the device supports every feature enabled in `required`.
+ */
+int lv_device_has_features(VkPhysicalDevice device, const VkPhysicalDeviceFeatures *required)
+{
+	VkPhysicalDeviceFeatures supported;
+	vkGetPhysicalDeviceFeatures(device, &supported);
+
+	// VkPhysicalDeviceFeatures is nothing but VkBool32 members
+	const VkBool32 *req = (const VkBool32 *) required;
+	const VkBool32 *sup = (const VkBool32 *) &supported;
+
+	for (size_t i = 0; i < sizeof(VkPhysicalDeviceFeatures) / sizeof(VkBool32); ++i)
+	{
+		if (req[i] && !sup[i])
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * Picks the queue families to use: a family that can do graphics as well
+ * as present if there is one, otherwise the first one of each kind.
+ * Returns 1 if families for both have been found.
+ */
+static int
+lv_device_pick_queues(VkPhysicalDevice device, VkSurfaceKHR surface, int *gqueue_index, int *pqueue_index)
+{
+	*gqueue_index = -1;
+	*pqueue_index = -1;
+
+	pthread_mutex_lock(&lv_caps_lock);
+	lv_surface_caps_s *caps = lv_surface_caps_get(device, surface);
+	lv_device_caps_s *device_caps = lv_device_caps_get(device);
+
+	for (int i = 0; caps && device_caps && i < caps->queue_count; ++i)
+	{
+		VkBool32 present = caps->queue_present[i];
+		int graphics = (device_caps->queues[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+
+		if (graphics && present)
+		{
+			*gqueue_index = i;
+			*pqueue_index = i;
+			break;
+		}
+		if (graphics && *gqueue_index == -1)
+		{
+			*gqueue_index = i;
+		}
+		if (present && *pqueue_index == -1)
+		{
+			*pqueue_index = i;
+		}
+	}
+
+	pthread_mutex_unlock(&lv_caps_lock);
+	return *gqueue_index != -1 && *pqueue_index != -1;
+}
+
+/*
+ * Rates how well the given device suits us. A device is suitable if it
+ * has graphics and present queues, supports swapchains for the surface
+ * and all `required` features (may be NULL). Suitable devices are scored
+ * by type, largest device local heap (+1 per 256 MiB, at most +1000), 
+ * limits, and whether one queue family does both graphics and present.
+ */
+void lv_device_rate(VkPhysicalDevice device, VkSurfaceKHR surface, uint32_t api_version,
+		const VkPhysicalDeviceFeatures *required, lv_device_rating_s *rating)
+{
+	memset(rating, 0, sizeof(lv_device_rating_s));
+	rating->gpu = device;
+
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(device, &props);
+	snprintf(rating->name, sizeof(rating->name), "%s", props.deviceName);
+
+	// the device UUID is only available from Vulkan 1.1 onwards
+	if (api_version >= VK_API_VERSION_1_1 && props.apiVersion >= VK_API_VERSION_1_1)
+	{
+		VkPhysicalDeviceIDProperties id = { 0 };
+		id.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+		VkPhysicalDeviceProperties2 props2 = { 0 };
+		props2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		props2.pNext = &id;
+
+		vkGetPhysicalDeviceProperties2(device, &props2);
+		memcpy(rating->uuid, id.deviceUUID, VK_UUID_SIZE);
+		rating->has_uuid = 1;
+	}
+
+	VkPhysicalDeviceMemoryProperties mem;
+	vkGetPhysicalDeviceMemoryProperties(device, &mem);
+
+	for (uint32_t i = 0; i < mem.memoryHeapCount; ++i)
+	{
+		if ((mem.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) &&
+				mem.memoryHeaps[i].size > rating->local_memory)
+		{
+			rating->local_memory = mem.memoryHeaps[i].size;
+		}
+	}
+
+	if (lv_device_pick_queues(device, surface, &rating->gqueue_index, &rating->pqueue_index) == 0)
+	{
+		rating->reason = "no graphics or no present queue";
+		return;
+	}
+	if (lv_device_has_extension(device, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0)
+	{
+		rating->reason = "no swapchain extension";
+		return;
+	}
+	if (lv_swapchain_adequate(device, surface) == 0)
+	{
+		rating->reason = "no surface formats or present modes";
+		return;
+	}
+	if (required && lv_device_has_features(device, required) == 0)
+	{
+		rating->reason = "missing required features";
+		return;
+	}
+
+	VkDeviceSize mib = rating->local_memory / (1024 * 1024);
+
+	rating->suitable     = 1;
+	rating->score_type   = lv_device_score(device);
+	rating->score_memory = mib / 256 < 1000 ? (int) (mib / 256) : 1000;
+	rating->score_limits = props.limits.maxImageDimension2D / 1024 + props.limits.maxColorAttachments;
+	rating->score_queues = rating->gqueue_index == rating->pqueue_index ? 500 : 0;
+	rating->score = rating->score_type + rating->score_memory + rating->score_limits + rating->score_queues;
+}
+
+/*
+ * Returns 1 if `match` equals the device UUID, in hex with or without 
+ * dashes (as printed by lv_print_device_ratings()), or is a part of the
+ * device name, otherwise 0.
+ */
+int lv_device_matches(const lv_device_rating_s *rating, const char *match)
+{
+	if (strstr(rating->name, match) != NULL)
+	{
+		return 1;
+	}
+
+	if (rating->has_uuid == 0)
+	{
+		return 0;
+	}
+
+	char hex[VK_UUID_SIZE * 2 + 1] = { 0 };
+	size_t len = 0;
+
+	for (const char *c = match; *c != '\0'; ++c)
+	{
+		if (*c == '-')
+		{
+			continue;
+		}
+		if (len == VK_UUID_SIZE * 2)
+		{
+			return 0;
+		}
+		hex[len++] = (*c >= 'A' && *c <= 'F') ? *c - 'A' + 'a' : *c;
+	}
+
+	char uuid[VK_UUID_SIZE * 2 + 1];
+	for (int i = 0; i < VK_UUID_SIZE; ++i)
+	{
+		sprintf(uuid + i * 2, "%02x", rating->uuid[i]);
+	}
+
+	return len == VK_UUID_SIZE * 2 && strcmp(hex, uuid) == 0;
+}
+
+/*
+ * Rates all devices and returns the ratings in an array the caller has
+ * to release with lv_scratch_free(), with the number of devices in `count`.
+ */
+lv_device_rating_s *lv_device_rate_all(lv_state_s *lv, uint32_t *count)
+{
+	*count = 0;
+	vkEnumeratePhysicalDevices(lv->instance, count, NULL);
+
+	if (*count == 0)
+	{
+		return NULL;
+	}
+
+	VkPhysicalDevice *devices = lv_scratch_alloc(sizeof(VkPhysicalDevice) * *count);
+	vkEnumeratePhysicalDevices(lv->instance, count, devices);
+
+	lv_device_rating_s *ratings = lv_scratch_alloc(sizeof(lv_device_rating_s) * *count);
+	for (uint32_t i = 0; i < *count; ++i)
+	{
+		lv_device_rate(devices[i], lv_primary_surface(lv), lv->api_version, &lv->features, &ratings[i]);
+	}
+
+	lv_scratch_free(devices);
+	return ratings;
+}
+
+/*
+ * Selects the suitable device with the highest score. If `match` is given
+ * (see lv_device_matches()), only devices matching it are considered. 
+ * The queue family indices are only set for the device that is chosen.
+ */
+int lv_device_select(lv_state_s *lv, const char *match)
+{
+	uint32_t device_count = 0;
+	lv_device_rating_s *ratings = lv_device_rate_all(lv, &device_count);
+
+	// fail early if no device available at all
+	if (ratings == NULL)
+	{
+		return 0;
+	}
+
+	lv_device_rating_s *best = NULL;
+
+	// look at all devices, the best one could be anywhere in the list
+	for (uint32_t i = 0; i < device_count; ++i)
+	{
+		lv_device_rating_s *r = &ratings[i];
+
+		if (r->suitable == 0 || (match && lv_device_matches(r, match) == 0))
+		{
+			continue;
+		}
+		if (best == NULL || r->score > best->score)
+		{
+			best = r;
+		}
+	}
+
+	if (best != NULL)
+	{
+		lv->gpu = best->gpu;
+		lv->gqueue.index = best->gqueue_index;
+		lv->pqueue.index = best->pqueue_index;
+	}
+
+	lv_scratch_free(ratings);
+	return lv->gpu != VK_NULL_HANDLE;
+}
+
+int lv_device_autoselect(lv_state_s *lv)
+{
+	return lv_device_select(lv, NULL);
+}
+
+/*
+ * Prints every device along with its score and what it is made of,
+ * or why the device isn't suitable at all.
+ */
+int lv_print_device_ratings(lv_state_s *lv)
+{
+	uint32_t device_count = 0;
+	lv_device_rating_s *ratings = lv_device_rate_all(lv, &device_count);
+
+	for (uint32_t i = 0; i < device_count; ++i)
+	{
+		lv_device_rating_s *r = &ratings[i];
+
+		fprintf(stdout, "%*d: %s%s\n", 2, i+1, r->name, r->gpu == lv->gpu ? " (selected)" : "");
+		if (r->has_uuid)
+		{
+			fprintf(stdout, "    uuid:   ");
+			for (int j = 0; j < VK_UUID_SIZE; ++j)
+			{
+				fprintf(stdout, "%02x%s", r->uuid[j], (j == 3 || j == 5 || j == 7 || j == 9) ? "-" : "");
+			}
+			fprintf(stdout, "\n");
+		}
+		if (r->suitable == 0)
+		{
+			fprintf(stdout, "    unsuitable: %s\n", r->reason);
+			continue;
+		}
+		fprintf(stdout, "    score:  %d = %d (type) + %d (%llu MiB local) + %d (limits) + %d (queues %d/%d)\n",
+				r->score, r->score_type, r->score_memory, 
+				(unsigned long long) (r->local_memory / (1024 * 1024)),
+				r->score_limits, r->score_queues, r->gqueue_index, r->pqueue_index);
+	}
+
+	lv_scratch_free(ratings);
+	return device_count;
+}
+
+/*
+ * Finds a memory type among `type_bits` (from VkMemoryRequirements) that
+ * has all of `props`. Returns 1 and sets `index` if there is one.
+ */
+int lv_device_memory_type(VkPhysicalDevice device, uint32_t type_bits, VkMemoryPropertyFlags props, uint32_t *index)
+{
+	VkPhysicalDeviceMemoryProperties mem;
+	vkGetPhysicalDeviceMemoryProperties(device, &mem);
+
+	for (uint32_t i = 0; i < mem.memoryTypeCount; ++i)
+	{
+		if ((type_bits & (1u << i)) && (mem.memoryTypes[i].propertyFlags & props) == props)
+		{
+			*index = i;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Returns the first depth format, in order of preference, the device can
+ * use as an attachment, or VK_FORMAT_UNDEFINED if there is none.
+ */
+VkFormat lv_device_depth_format(VkPhysicalDevice device)
+{
+	VkFormat formats[] = {
+		VK_FORMAT_D32_SFLOAT,
+		VK_FORMAT_D24_UNORM_S8_UINT,
+		VK_FORMAT_D32_SFLOAT_S8_UINT,
+		VK_FORMAT_D16_UNORM
+	};
+
+	for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); ++i)
+	{
+		VkFormatProperties props;
+		vkGetPhysicalDeviceFormatProperties(device, formats[i], &props);
+
+		if (props.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+		{
+			return formats[i];
+		}
+	}
+
+	return VK_FORMAT_UNDEFINED;
+}
+
+int lv_format_has_stencil(VkFormat format)
+{
+	return format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+/*
+ * Returns the highest sample count, up to `requested`, that color and 
+ * depth attachments both support on the device. Counts that aren't a
+ * power of two are rounded down to one.
+ */
+VkSampleCountFlagBits lv_device_sample_count(VkPhysicalDevice device, VkSampleCountFlagBits requested)
+{
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(device, &props);
+
+	VkSampleCountFlags supported = props.limits.framebufferColorSampleCounts 
+		& props.limits.framebufferDepthSampleCounts;
+
+	// only the highest bit, 6 would pass for 2 or 4 otherwise
+	VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+	while (samples < VK_SAMPLE_COUNT_64_BIT && (uint32_t) samples * 2 <= (uint32_t) requested)
+	{
+		samples <<= 1;
+	}
+
+	while (samples > VK_SAMPLE_COUNT_1_BIT && (supported & samples) == 0)
+	{
+		samples >>= 1;
+	}
+
+	return samples > VK_SAMPLE_COUNT_1_BIT ? samples : VK_SAMPLE_COUNT_1_BIT;
+}
+
+/*
+ * Asks for multisampling with the given sample count, which is lowered
+ * to what the device supports when lv_logical_device_create() runs.
+ */
+void lv_msaa_set(lv_state_s *lv, VkSampleCountFlagBits samples)
+{
+	lv->samples = samples;
+}
+
+/*
+ * Checks whether the device can render without render pass and 
+ * framebuffer objects: as part of Vulkan 1.3, or with 
+ * VK_KHR_dynamic_rendering on 1.2, which has everything the extension 
+ * depends on in core. Sets `extension` if it has to be enabled.
+ */
+static int
+lv_device_has_dynamic_rendering(lv_state_s *lv, int *extension)
+{
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(lv->gpu, &props);
+
+	uint32_t version = props.apiVersion < lv->api_version ? props.apiVersion : lv->api_version;
+	if (version < VK_API_VERSION_1_2)
+	{
+		return 0;
+	}
+
+	*extension = version < VK_API_VERSION_1_3;
+	if (*extension && lv_device_has_extension(lv->gpu, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) == 0)
+	{
+		return 0;
+	}
+
+	VkPhysicalDeviceDynamicRenderingFeatures dynamic = { 0 };
+	dynamic.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+
+	VkPhysicalDeviceFeatures2 features = { 0 };
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &dynamic;
+
+	vkGetPhysicalDeviceFeatures2(lv->gpu, &features);
+	return dynamic.dynamicRendering == VK_TRUE;
+}
+
+/*
+ * Returns 1 if the device can do timeline semaphores, either through 
+ * Vulkan 1.2 or VK_KHR_timeline_semaphore on 1.1. Sets extension to 1 if 
+ * the latter needs to be enabled.
+ */
+static int
+lv_device_has_timeline_semaphores(lv_state_s *lv, int *extension)
+{
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(lv->gpu, &props);
+
+	uint32_t version = props.apiVersion < lv->api_version ? props.apiVersion : lv->api_version;
+	if (version < VK_API_VERSION_1_1)
+	{
+		return 0;
+	}
+
+	*extension = version < VK_API_VERSION_1_2;
+	if (*extension && lv_device_has_extension(lv->gpu, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) == 0)
+	{
+		return 0;
+	}
+
+	VkPhysicalDeviceTimelineSemaphoreFeatures timeline = { 0 };
+	timeline.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+
+	VkPhysicalDeviceFeatures2 features = { 0 };
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &timeline;
+
+	vkGetPhysicalDeviceFeatures2(lv->gpu, &features);
+	return timeline.timelineSemaphore == VK_TRUE;
+}
+
+/*
+ * Makes lv_logical_device_create() stick to render pass and framebuffer 
+ * objects, even if the device supports dynamic rendering.
+ */
+void lv_dynamic_rendering_disable(lv_state_s *lv)
+{
+	lv->classic_rendering = 1;
+}
+
+/*
+ * Returns 1 if the device has been created with dynamic rendering.
+ */
+int lv_dynamic_rendering_enabled(lv_state_s *lv)
+{
+	return lv->dynamic_rendering;
+}
+
+/*
+ * Creates the logical device with the given extensions. Dynamic rendering
+ * is enabled on top if the device has it, in which case no render pass 
+ * or framebuffers are created and the command buffers render straight
+ * into the swapchain image views. Timeline semaphores are enabled the
+ * same way, see sync.c, and so are VK_KHR_incremental_present, see 
+ * damage.c, and VK_EXT_external_memory_host, see mesh.c.
+ */
+int lv_logical_device_create(lv_state_s *lv, lv_name_set_s *extensions)
+{
+	int extension = 0;
+	int timeline_extension = 0;
+	lv->dynamic_rendering = lv->classic_rendering == 0 && lv_device_has_dynamic_rendering(lv, &extension);
+	lv->timeline_semaphores = lv_device_has_timeline_semaphores(lv, &timeline_extension);
+
+	lv->gqueue.priority = 1.0f;
+	lv->pqueue.priority = 1.0f;
+
+	VkDeviceQueueCreateInfo queue_info[2] = { 0 };
+	VkDeviceCreateInfo device_info = { 0 };
+	
+	queue_info[0].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+	queue_info[0].queueFamilyIndex = lv->gqueue.index;
+	queue_info[0].queueCount = 1;
+	queue_info[0].pQueuePriorities = &lv->gqueue.priority;
+
+	// a separate present queue is only needed if the families differ
+	queue_info[1].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+	queue_info[1].queueFamilyIndex = lv->pqueue.index;
+	queue_info[1].queueCount = 1;
+	queue_info[1].pQueuePriorities = &lv->pqueue.priority;
+
+	device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	device_info.pQueueCreateInfos = queue_info;
+	device_info.queueCreateInfoCount = lv->gqueue.index == lv->pqueue.index ? 1 : 2;
+	device_info.pEnabledFeatures = &lv->features;
+	device_info.enabledExtensionCount = extensions->count;
+	device_info.ppEnabledExtensionNames = extensions->names;
+
+	VkPhysicalDeviceDynamicRenderingFeatures dynamic = { 0 };
+	dynamic.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+	dynamic.dynamicRendering = VK_TRUE;
+
+	VkPhysicalDeviceTimelineSemaphoreFeatures timeline = { 0 };
+	timeline.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+	timeline.timelineSemaphore = VK_TRUE;
+
+	const char **names = lv_scratch_alloc(sizeof(const char *) * (extensions->count + 4));
+	memcpy(names, extensions->names, sizeof(const char *) * extensions->count);
+
+	int incremental_requested = 0;
+	int host_memory_requested = 0;
+	for (uint32_t i = 0; i < extensions->count; ++i)
+	{
+		incremental_requested |= strcmp(extensions->names[i], VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME) == 0;
+		host_memory_requested |= strcmp(extensions->names[i], VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME) == 0;
+	}
+	lv->incremental_present = lv_device_has_extension(lv->gpu, VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME);
+	lv->external_memory_host = lv_device_has_extension(lv->gpu, VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+
+	if (lv->dynamic_rendering)
+	{
+		dynamic.pNext = (void *) device_info.pNext;
+		device_info.pNext = &dynamic;
+	}
+
+	if (lv->timeline_semaphores)
+	{
+		timeline.pNext = (void *) device_info.pNext;
+		device_info.pNext = &timeline;
+	}
+
+	if (lv->dynamic_rendering && extension)
+	{
+		names[device_info.enabledExtensionCount++] = VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME;
+		device_info.ppEnabledExtensionNames = names;
+	}
+
+	if (lv->timeline_semaphores && timeline_extension)
+	{
+		names[device_info.enabledExtensionCount++] = VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME;
+		device_info.ppEnabledExtensionNames = names;
+	}
+
+	if (lv->incremental_present && incremental_requested == 0)
+	{
+		names[device_info.enabledExtensionCount++] = VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME;
+		device_info.ppEnabledExtensionNames = names;
+	}
+
+	if (lv->external_memory_host && host_memory_requested == 0)
+	{
+		names[device_info.enabledExtensionCount++] = VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME;
+		device_info.ppEnabledExtensionNames = names;
+	}
+
+	VkResult created = vkCreateDevice(lv->gpu, &device_info, lv_allocator(), &lv->device);
+	lv_scratch_free(names);
+
+	if (created != VK_SUCCESS)
+	{
+		return 0;
+	}
+
+	if (lv->dynamic_rendering)
+	{
+		// the entry points only go by their KHR names if the extension is enabled
+		lv->cmd_begin_rendering = (PFN_vkCmdBeginRenderingKHR) 
+			vkGetDeviceProcAddr(lv->device, extension ? "vkCmdBeginRenderingKHR" : "vkCmdBeginRendering");
+		lv->cmd_end_rendering = (PFN_vkCmdEndRenderingKHR) 
+			vkGetDeviceProcAddr(lv->device, extension ? "vkCmdEndRenderingKHR" : "vkCmdEndRendering");
+
+		lv->dynamic_rendering = lv->cmd_begin_rendering != NULL && lv->cmd_end_rendering != NULL;
+	}
+
+	lv_log(LV_LOG_INFO, "Rendering with %s", lv->dynamic_rendering ? "dynamic rendering" : "render pass objects");
+
+	if (lv->timeline_semaphores)
+	{
+		lv->wait_semaphores = (PFN_vkWaitSemaphoresKHR) 
+			vkGetDeviceProcAddr(lv->device, timeline_extension ? "vkWaitSemaphoresKHR" : "vkWaitSemaphores");
+		lv->get_semaphore_counter = (PFN_vkGetSemaphoreCounterValueKHR) 
+			vkGetDeviceProcAddr(lv->device, timeline_extension ? "vkGetSemaphoreCounterValueKHR" : "vkGetSemaphoreCounterValue");
+
+		lv->timeline_semaphores = lv->wait_semaphores != NULL && lv->get_semaphore_counter != NULL;
+	}
+
+	lv_log(LV_LOG_INFO, "Synchronizing with %s", lv->timeline_semaphores ? "timeline semaphores" : "idle waits");
+
+	if (lv->external_memory_host)
+	{
+		VkPhysicalDeviceExternalMemoryHostPropertiesEXT host = { 0 };
+		host.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT;
+
+		VkPhysicalDeviceProperties2 props = { 0 };
+		props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		props.pNext = &host;
+		vkGetPhysicalDeviceProperties2(lv->gpu, &props);
+
+		lv->host_pointer_alignment = host.minImportedHostPointerAlignment;
+		lv->get_host_pointer_properties = (PFN_vkGetMemoryHostPointerPropertiesEXT)
+			vkGetDeviceProcAddr(lv->device, "vkGetMemoryHostPointerPropertiesEXT");
+
+		lv->external_memory_host = lv->get_host_pointer_properties != NULL;
+	}
+
+	// fixed for the device, the attachments of all outputs use them
+	lv->depth_format = lv_device_depth_format(lv->gpu);
+	lv->samples = lv_device_sample_count(lv->gpu, lv->samples ? lv->samples : VK_SAMPLE_COUNT_1_BIT);
+	lv_log(LV_LOG_INFO, "Depth format %d, %d samples", lv->depth_format, lv->samples);
+
+	vkGetDeviceQueue(lv->device, lv->gqueue.index, 0, &lv->gqueue.queue);
+	vkGetDeviceQueue(lv->device, lv->pqueue.index, 0, &lv->pqueue.queue);
+
+	return lv->gqueue.queue != VK_NULL_HANDLE && lv->pqueue.queue != VK_NULL_HANDLE;
+}
@@ -0,0 +1,311 @@
+#include "internal.h"
+
+//
+// Draw lists: every draw carries a 64-bit key that packs, from the top,
+// the pass, pipeline, material and depth it is drawn with. Sorting the
+// keys puts draws with the same pipeline next to each other, and within
+// those the ones with the same material, so the recorder only binds what
+// differs from the draw before. Depth comes last and goes front to back
+// within a material, which leaves the rest of the ordering to early depth
+// tests.
+//
+// The keys are sorted with an LSD radix sort, a byte at a time from the
+// lowest, which is linear in the number of draws and stable, so draws with
+// the same key stay in the order they were added. Bytes that are the same
+// in all keys, like the pass of a frame with only one, are skipped.
+//
+// lv_draws_sort() counts the binds for both orders, so the profiler can
+// tell what sorting saved, see lv_print_timings(). lv_draw_frame() adds
+// the list's stats to it once per frame, however many outputs record it.
+//
+
+#define LV_DRAW_RADIX_BITS 8
+#define LV_DRAW_RADIX      (1 << LV_DRAW_RADIX_BITS)
+#define LV_DRAW_DIGITS     (64 / LV_DRAW_RADIX_BITS)
+
+/*
+ * Packs a sort key. The ids are the caller's, taken modulo the size of
+ * their field; depth is from 0 at the near plane to 1 at the far plane,
+ * pass 1 - depth for back to front.
+ */
+uint64_t lv_draw_key(uint32_t pass, uint32_t pipeline, uint32_t material, float depth)
+{
+	const uint64_t depth_max = (1ull << LV_DRAW_DEPTH_BITS) - 1;
+
+	// the negated comparisons catch NaN too
+	depth = !(depth > 0.0f) ? 0.0f : (!(depth < 1.0f) ? 1.0f : depth);
+
+	uint64_t key = pass & ((1u << LV_DRAW_PASS_BITS) - 1);
+	key = key << LV_DRAW_PIPELINE_BITS | (pipeline & ((1u << LV_DRAW_PIPELINE_BITS) - 1));
+	key = key << LV_DRAW_MATERIAL_BITS | (material & ((1u << LV_DRAW_MATERIAL_BITS) - 1));
+	key = key << LV_DRAW_DEPTH_BITS | (uint64_t) (depth * (float) depth_max);
+	return key;
+}
+
+void lv_draws_init(lv_draw_list_s *list)
+{
+	memset(list, 0, sizeof(lv_draw_list_s));
+}
+
+void lv_draws_free(lv_draw_list_s *list)
+{
+	free(list->draws);
+	free(list->keys);
+	free(list->order);
+	lv_draws_init(list);
+}
+
+/*
+ * Drops all draws, keeping the memory for the next frame.
+ */
+void lv_draws_clear(lv_draw_list_s *list)
+{
+	list->count = 0;
+}
+
+static int
+lv_draws_grow(lv_draw_list_s *list)
+{
+	uint32_t capacity = list->capacity > 0 ? list->capacity * 2 : 256;
+
+	lv_draw_s *draws = realloc(list->draws, sizeof(lv_draw_s) * capacity);
+	if (draws == NULL)
+	{
+		return 0;
+	}
+	list->draws = draws;
+
+	// the sort goes back and forth between both halves
+	uint64_t *keys = realloc(list->keys, sizeof(uint64_t) * capacity * 2);
+	if (keys == NULL)
+	{
+		return 0;
+	}
+	list->keys = keys;
+
+	uint32_t *order = realloc(list->order, sizeof(uint32_t) * capacity * 2);
+	if (order == NULL)
+	{
+		return 0;
+	}
+	list->order = order;
+
+	list->capacity = capacity;
+	return 1;
+}
+
+/*
+ * Adds a copy of the draw, returns 0 if out of memory.
+ */
+int lv_draws_add(lv_draw_list_s *list, const lv_draw_s *draw)
+{
+	if (list->count == list->capacity && lv_draws_grow(list) == 0)
+	{
+		return 0;
+	}
+
+	list->draws[list->count++] = *draw;
+	return 1;
+}
+
+/*
+ * Goes through the draws in the given order, binding only what changes.
+ * Without a command buffer it only counts the binds. Returns their number.
+ */
+static uint32_t
+lv_draws_walk(lv_state_s *lv, VkCommandBuffer cb, const lv_draw_list_s *list, const uint32_t *order)
+{
+	VkPipelineLayout layout = list->layout;
+	if (lv != NULL && layout == VK_NULL_HANDLE)
+	{
+		layout = lv->pipeline_layout;
+	}
+
+	VkPipeline       pipeline = VK_NULL_HANDLE;
+	VkDescriptorSet  material = VK_NULL_HANDLE;
+	const lv_mesh_s *mesh     = NULL;
+	uint32_t         binds    = 0;
+
+	for (uint32_t i = 0; i < list->count; ++i)
+	{
+		const lv_draw_s *draw = &list->draws[order[i]];
+
+		if (draw->pipeline != pipeline)
+		{
+			pipeline = draw->pipeline;
+			++binds;
+			if (cb != VK_NULL_HANDLE)
+			{
+				vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+			}
+		}
+
+		// a draw without a material leaves the last one bound
+		if (draw->material != material && draw->material != VK_NULL_HANDLE)
+		{
+			material = draw->material;
+			++binds;
+			if (cb != VK_NULL_HANDLE)
+			{
+				vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &material, 0, NULL);
+			}
+		}
+
+		// as does one without a mesh, it draws without buffers
+		if (draw->mesh != mesh && draw->mesh != NULL)
+		{
+			mesh = draw->mesh;
+			++binds;
+			if (cb != VK_NULL_HANDLE)
+			{
+				lv_mesh_bind(lv, cb, mesh);
+			}
+		}
+
+		if (cb == VK_NULL_HANDLE)
+		{
+			continue;
+		}
+
+		if (draw->mesh == NULL)
+		{
+			vkCmdDraw(cb, draw->vertex_count, 1, 0, draw->instance);
+		}
+		else if (draw->submesh < mesh->submesh_count)
+		{
+			const lv_mesh_submesh_s *sub = &mesh->submeshes[draw->submesh];
+			vkCmdDrawIndexed(cb, sub->index_count, 1, sub->first_index, 0, draw->instance);
+		}
+	}
+
+	return binds;
+}
+
+/*
+ * Sorts `count` keys along with their indices, `keys` and `order` have
+ * room for twice as many, the second half is scratch.
+ */
+static void
+lv_draws_radix_sort(uint64_t *keys, uint32_t *order, uint32_t count)
+{
+	// the histograms of all digits in a single pass over the keys
+	uint32_t counts[LV_DRAW_DIGITS][LV_DRAW_RADIX];
+	memset(counts, 0, sizeof(counts));
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		uint64_t key = keys[i];
+		for (int d = 0; d < LV_DRAW_DIGITS; ++d)
+		{
+			++counts[d][(key >> (d * LV_DRAW_RADIX_BITS)) & (LV_DRAW_RADIX - 1)];
+		}
+	}
+
+	uint64_t *src_keys  = keys,  *dst_keys  = keys + count;
+	uint32_t *src_order = order, *dst_order = order + count;
+
+	for (int d = 0; d < LV_DRAW_DIGITS; ++d)
+	{
+		int shift = d * LV_DRAW_RADIX_BITS;
+
+		// all keys in one bucket would be copied as they are
+		if (counts[d][(src_keys[0] >> shift) & (LV_DRAW_RADIX - 1)] == count)
+		{
+			continue;
+		}
+
+		uint32_t offsets[LV_DRAW_RADIX];
+		uint32_t sum = 0;
+		for (int b = 0; b < LV_DRAW_RADIX; ++b)
+		{
+			offsets[b] = sum;
+			sum += counts[d][b];
+		}
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			uint32_t at = offsets[(src_keys[i] >> shift) & (LV_DRAW_RADIX - 1)]++;
+			dst_keys[at]  = src_keys[i];
+			dst_order[at] = src_order[i];
+		}
+
+		uint64_t *k = src_keys;  src_keys  = dst_keys;  dst_keys  = k;
+		uint32_t *o = src_order; src_order = dst_order; dst_order = o;
+	}
+
+	if (src_keys != keys)
+	{
+		memcpy(keys, src_keys, sizeof(uint64_t) * count);
+		memcpy(order, src_order, sizeof(uint32_t) * count);
+	}
+}
+
+/*
+ * Decides the order the draws are recorded in, by key unless the list is
+ * `unsorted`, and counts the binds of both orders. Once per frame, after
+ * the last draw has been added.
+ */
+void lv_draws_sort(lv_draw_list_s *list)
+{
+	list->stats.draws = list->count;
+	list->stats.record_ms = 0.0;
+	if (list->count == 0)
+	{
+		list->stats.binds = list->stats.binds_unsorted = 0;
+		list->stats.sort_ms = 0.0;
+		return;
+	}
+
+	for (uint32_t i = 0; i < list->count; ++i)
+	{
+		list->order[i] = i;
+	}
+	list->stats.binds_unsorted = lv_draws_walk(NULL, VK_NULL_HANDLE, list, list->order);
+
+	double start = lv_time_ms();
+	if (list->unsorted == 0)
+	{
+		for (uint32_t i = 0; i < list->count; ++i)
+		{
+			list->keys[i] = list->draws[i].key;
+		}
+		lv_draws_radix_sort(list->keys, list->order, list->count);
+	}
+	list->stats.sort_ms = lv_time_ms() - start;
+
+	list->stats.binds = list->unsorted ? list->stats.binds_unsorted : lv_draws_walk(NULL, VK_NULL_HANDLE, list, list->order);
+}
+
+/*
+ * Records the draws in the order lv_draws_sort() decided, inside a render
+ * pass or dynamic rendering, with viewport and scissor set. Every draw
+ * binds its pipeline, material and mesh, unless the draw before it had
+ * the same. The time it took adds up until the next sort. Returns the
+ * binds.
+ */
+uint32_t lv_draws_record(lv_state_s *lv, VkCommandBuffer cb, lv_draw_list_s *list)
+{
+	if (list->stats.draws != list->count)
+	{
+		lv_log(LV_LOG_WARN, "Recording %u draws sorted as %u, sort them first", list->count, list->stats.draws);
+		lv_draws_sort(list);
+	}
+
+	double start = lv_time_ms();
+	list->stats.binds = lv_draws_walk(lv, cb, list, list->order);
+	list->stats.record_ms += lv_time_ms() - start;
+
+	return list->stats.binds;
+}
+
+/*
+ * Has the scene pass record the list instead of its triangle, NULL to go
+ * back to that. While a list is set, lv_draw_frame() records it into a
+ * command buffer of the frame for every output, so changes to the list
+ * show with the next frame; it is filled and sorted on the thread that
+ * draws, before lv_draw_frame().
+ */
+void lv_draws_set(lv_state_s *lv, lv_draw_list_s *list)
+{
+	lv->draws = list;
+}
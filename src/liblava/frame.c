@@ -0,0 +1,272 @@
+#include <time.h>              // clock_nanosleep()
+#include <errno.h>             // EINTR
+
+#include "internal.h"
+
+//
+// Frame scheduling: lv_frame_wait() decides when the next frame is drawn
+// and spends the time until then waiting for window events, instead of
+// the render loop drawing and sleeping on its own.
+//
+// - continuous: a frame every interval, started as late as the predicted
+//   frame time allows so that it is done by its deadline
+// - on-demand: no frames until lv_invalidate() is called, from an input
+//   handler or any other thread; the loop sleeps in the event wait
+// - benchmark: frames as fast as they can be drawn
+//
+// liblava knows nothing about windows, the application hands in how to
+// wait for its events with lv_frame_events().
+//
+
+// the last bit of a wait is slept with the monotonic clock, event waits
+// are not that precise
+#define LV_FRAME_SLACK_MS 1.0
+
+// weight of the latest frame in the predicted frame time
+#define LV_FRAME_SMOOTHING 0.1
+
+// how often benchmark mode logs the frame rate
+#define LV_FRAME_REPORT_MS 5000.0
+
+// how long to sleep for lack of an event wait, before looking again
+#define LV_FRAME_IDLE_MS 100.0
+
+static void
+lv_frame_sleep_until(double ms)
+{
+	struct timespec ts;
+	ts.tv_sec  = (time_t) (ms / 1000.0);
+	ts.tv_nsec = (long) ((ms - ts.tv_sec * 1000.0) * 1000000.0);
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+	{
+		// interrupted by a signal, the deadline stays the same
+	}
+}
+
+/*
+ * What the render thread does instead of waiting for events: wait for
+ * lv_invalidate() for up to `timeout` seconds, for ever if negative.
+ */
+static void
+lv_frame_invalid_wait(lv_scheduler_s *sched, double timeout)
+{
+	struct timespec until;
+	clock_gettime(CLOCK_MONOTONIC, &until);
+
+	double ns = until.tv_nsec + timeout * 1000000000.0;
+	until.tv_sec  += (time_t) (ns / 1000000000.0);
+	until.tv_nsec  = (long) (ns - (time_t) (ns / 1000000000.0) * 1000000000.0);
+
+	pthread_mutex_lock(&sched->lock);
+	while (atomic_load(&sched->invalid) == 0 && atomic_load(&sched->threaded))
+	{
+		if (timeout < 0.0)
+		{
+			pthread_cond_wait(&sched->cond, &sched->lock);
+		}
+		else if (pthread_cond_timedwait(&sched->cond, &sched->lock, &until) != 0)
+		{
+			break;
+		}
+	}
+	pthread_mutex_unlock(&sched->lock);
+}
+
+/*
+ * Waits for events for up to `timeout` seconds, for ever if it is
+ * negative. Without an event wait, only sleeps for the given time, or
+ * LV_FRAME_IDLE_MS instead of for ever.
+ */
+static void
+lv_frame_events_wait(lv_scheduler_s *sched, double timeout)
+{
+	if (atomic_load(&sched->threaded))
+	{
+		if (timeout != 0.0)
+		{
+			lv_frame_invalid_wait(sched, timeout);
+		}
+	}
+	else if (sched->wait != NULL)
+	{
+		sched->wait(timeout);
+	}
+	else if (timeout != 0.0)
+	{
+		lv_frame_sleep_until(lv_time_ms() + (timeout < 0.0 ? LV_FRAME_IDLE_MS : timeout * 1000.0));
+	}
+}
+
+/*
+ * Sets up the scheduler: continuous at 60 frames per second, the first
+ * frame pending.
+ */
+void lv_frame_init(lv_scheduler_s *sched)
+{
+	memset(sched, 0, sizeof(lv_scheduler_s));
+	sched->mode = LV_FRAME_CONTINUOUS;
+	sched->interval = 1000.0 / 60.0;
+	atomic_init(&sched->invalid, 1);
+	atomic_init(&sched->threaded, 0);
+
+	// timed waits go by the same clock as lv_time_ms()
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&sched->cond, &attr);
+	pthread_condattr_destroy(&attr);
+	pthread_mutex_init(&sched->lock, NULL);
+}
+
+void lv_frame_free(lv_scheduler_s *sched)
+{
+	pthread_cond_destroy(&sched->cond);
+	pthread_mutex_destroy(&sched->lock);
+}
+
+/*
+ * Switches to the given mode. `fps` is the target frame rate of the
+ * continuous mode, 0 or less draws as fast as the present mode allows.
+ */
+void lv_frame_mode(lv_state_s *lv, lv_frame_mode_e mode, double fps)
+{
+	lv_scheduler_s *sched = &lv->scheduler;
+	sched->mode = mode;
+	sched->interval = fps > 0.0 ? 1000.0 / fps : 0.0;
+	sched->deadline = 0.0;
+	sched->report = lv_time_ms();
+	sched->report_frames = sched->frames;
+	sched->report_draws  = lv->timings.draws;
+	lv_invalidate(lv);
+}
+
+/*
+ * Sets how to wait for window events. wait(timeout) has to return when
+ * events come in or after `timeout` seconds, wait for ever if it is
+ * negative and only handle pending events if it is 0; wake() has to make
+ * a wait() on the render loop's thread return, from any thread. For
+ * GLFW, these are glfwWaitEventsTimeout() (or glfwWaitEvents() and
+ * glfwPollEvents()) and glfwPostEmptyEvent().
+ */
+void lv_frame_events(lv_state_s *lv, void (*wait)(double timeout), void (*wake)())
+{
+	lv->scheduler.wait = wait;
+	lv->scheduler.wake = wake;
+}
+
+/*
+ * Asks for another frame: content, input or the window changed. Safe to
+ * call from any thread; wakes up the render loop if it waits for events,
+ * or the render thread.
+ */
+void lv_invalidate(lv_state_s *lv)
+{
+	lv_scheduler_s *sched = &lv->scheduler;
+	atomic_store(&sched->invalid, 1);
+
+	// nobody waits on it unless there is a render thread
+	pthread_mutex_lock(&sched->lock);
+	pthread_cond_signal(&sched->cond);
+	pthread_mutex_unlock(&sched->lock);
+
+	if (sched->wake != NULL && atomic_load(&sched->threaded) == 0)
+	{
+		sched->wake();
+	}
+}
+
+/*
+ * Handles events until the next frame is due. Returns 1 if the frame
+ * should be drawn now, or 0 if it returned early for events, so the
+ * caller gets to check whether to quit before calling it again.
+ */
+int lv_frame_wait(lv_state_s *lv)
+{
+	lv_scheduler_s *sched = &lv->scheduler;
+
+	if (sched->mode == LV_FRAME_BENCHMARK || (sched->mode == LV_FRAME_CONTINUOUS && sched->interval <= 0.0))
+	{
+		lv_frame_events_wait(sched, 0.0);
+		atomic_store(&sched->invalid, 0);
+		return 1;
+	}
+
+	if (sched->mode == LV_FRAME_ON_DEMAND)
+	{
+		if (atomic_exchange(&sched->invalid, 0))
+		{
+			lv_frame_events_wait(sched, 0.0);
+			return 1;
+		}
+
+		lv_frame_events_wait(sched, -1.0);
+		return atomic_exchange(&sched->invalid, 0);
+	}
+
+	double now = lv_time_ms();
+
+	// a deadline that can't be met anymore is skipped, not caught up on
+	if (sched->deadline - sched->frame_ms < now)
+	{
+		double behind = now + sched->frame_ms - sched->deadline;
+		sched->deadline += ((uint64_t) (behind / sched->interval) + 1) * sched->interval;
+	}
+
+	double start = sched->deadline - sched->frame_ms;
+	if (start - now > LV_FRAME_SLACK_MS)
+	{
+		lv_frame_events_wait(sched, (start - now - LV_FRAME_SLACK_MS) / 1000.0);
+		if (lv_time_ms() < start - LV_FRAME_SLACK_MS)
+		{
+			return 0;
+		}
+	}
+	else
+	{
+		lv_frame_events_wait(sched, 0.0);
+	}
+
+	lv_frame_sleep_until(start);
+	sched->deadline += sched->interval;
+	atomic_store(&sched->invalid, 0);
+	return 1;
+}
+
+/*
+ * Called by lv_draw_frame() with how long the frame took, including the
+ * wait for its frame slot, which paces it to the GPU. Keeps the prediction of the next frame's
+ * duration and, in benchmark mode, logs the frame rate now and then, as
+ * well as what recording draw lists took.
+ */
+void lv_frame_finished(lv_state_s *lv, double ms)
+{
+	lv_scheduler_s *sched = &lv->scheduler;
+
+	sched->frame_ms = sched->frames == 0 ? ms : sched->frame_ms + (ms - sched->frame_ms) * LV_FRAME_SMOOTHING;
+	++sched->frames;
+
+	double now = lv_time_ms();
+	if (sched->mode == LV_FRAME_BENCHMARK && now - sched->report >= LV_FRAME_REPORT_MS)
+	{
+		uint64_t frames = sched->frames - sched->report_frames;
+		lv_log(LV_LOG_INFO, "%.1f frames per second, %.2f ms per frame predicted",
+				frames * 1000.0 / (now - sched->report), sched->frame_ms);
+
+		// what the draw lists of the frames since took, see lv_draw_frame()
+		const lv_draw_totals_s *draws = &lv->timings.draws;
+		const lv_draw_totals_s *last  = &sched->report_draws;
+		if (draws->frames > last->frames)
+		{
+			double n = (double) (draws->frames - last->frames);
+			lv_log(LV_LOG_INFO, "%.0f draws, %.0f binds (%.0f unsorted), %.3f ms sort, %.3f ms record per frame",
+					(draws->draws - last->draws) / n, (draws->binds - last->binds) / n,
+					(draws->binds_unsorted - last->binds_unsorted) / n,
+					(draws->sort_ms - last->sort_ms) / n, (draws->record_ms - last->record_ms) / n);
+		}
+
+		sched->report = now;
+		sched->report_frames = sched->frames;
+		sched->report_draws  = *draws;
+	}
+}
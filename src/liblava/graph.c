@@ -0,0 +1,737 @@
+#include "internal.h"
+
+//
+// A render graph: passes declare which resources they use and how, the
+// graph works out the barriers and layout transitions between them,
+// culls passes nobody consumes the output of, and lets transient images
+// that are never alive at the same time share memory.
+//
+
+/*
+ * What each use of a resource means for synchronization.
+ */
+struct lv_graph_access
+{
+	VkPipelineStageFlags stages;
+	VkAccessFlags        access;
+	VkImageLayout        layout;
+	VkImageUsageFlags    usage;	// needed on a transient image
+	int                  write;
+};
+
+typedef struct lv_graph_access lv_graph_access_s;
+
+static const lv_graph_access_s lv_graph_accesses[LV_USE_COUNT] = {
+	[LV_USE_NONE] = { 0, 0, VK_IMAGE_LAYOUT_UNDEFINED, 0, 0 },
+	[LV_USE_COLOR_ATTACHMENT] = {
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, 1 },
+	[LV_USE_DEPTH_ATTACHMENT] = {
+		VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 1 },
+	[LV_USE_DEPTH_READ] = {
+		VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 0 },
+	[LV_USE_SAMPLED] = {
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, 0 },
+	[LV_USE_STORAGE_READ] = {
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+		VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, 0 },
+	[LV_USE_STORAGE_WRITE] = {
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, 1 },
+	[LV_USE_TRANSFER_SRC] = {
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+		VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, 0 },
+	[LV_USE_TRANSFER_DST] = {
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT, 1 },
+	[LV_USE_VERTEX_BUFFER] = {
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+		VK_IMAGE_LAYOUT_UNDEFINED, 0, 0 },
+	[LV_USE_INDEX_BUFFER] = {
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT,
+		VK_IMAGE_LAYOUT_UNDEFINED, 0, 0 },
+	[LV_USE_INDIRECT_BUFFER] = {
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+		VK_IMAGE_LAYOUT_UNDEFINED, 0, 0 },
+	[LV_USE_HOST_READ] = {
+		VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT,
+		VK_IMAGE_LAYOUT_UNDEFINED, 0, 0 },
+	// the stage lv_draw_frame() waits for the acquire semaphore in, so
+	// the first barrier on a swapchain image chains with the wait
+	[LV_USE_PRESENT] = {
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0,
+		VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, 0, 0 },
+};
+
+/*
+ * Where a resource stands while the barriers are worked out.
+ */
+struct lv_graph_state
+{
+	VkImageLayout        layout;
+	VkPipelineStageFlags write_stages;	// of the last write
+	VkAccessFlags        write_access;
+	VkPipelineStageFlags read_stages;	// since the last write
+	VkPipelineStageFlags visible_stages;	// the last write is visible to
+	VkAccessFlags        visible_access;
+};
+
+typedef struct lv_graph_state lv_graph_state_s;
+
+void lv_graph_init(lv_graph_s *graph)
+{
+	memset(graph, 0, sizeof(lv_graph_s));
+}
+
+static int
+lv_graph_add_resource(lv_graph_s *graph, const char *name)
+{
+	if (graph->resource_count == LV_GRAPH_MAX_RESOURCES)
+	{
+		return -1;
+	}
+
+	int index = graph->resource_count++;
+	lv_graph_resource_s *res = &graph->resources[index];
+	res->name  = name;
+	res->first = -1;
+	res->last  = -1;
+	res->block = -1;
+
+	return index;
+}
+
+/*
+ * Adds an image, imported or transient (see lv_graph_image_s), and
+ * returns its index, or -1 if the graph is full.
+ */
+int lv_graph_image(lv_graph_s *graph, const char *name, const lv_graph_image_s *image)
+{
+	int index = lv_graph_add_resource(graph, name);
+	if (index == -1)
+	{
+		return -1;
+	}
+
+	lv_graph_resource_s *res = &graph->resources[index];
+	res->image     = *image;
+	res->transient = image->image == VK_NULL_HANDLE;
+
+	if (res->image.samples == 0)
+	{
+		res->image.samples = VK_SAMPLE_COUNT_1_BIT;
+	}
+
+	return index;
+}
+
+/*
+ * Adds a buffer owned by the caller and returns its index, or -1 if the
+ * graph is full. Buffers have no layouts and are never aliased.
+ */
+int lv_graph_buffer(lv_graph_s *graph, const char *name, VkBuffer buffer, lv_graph_use_e before, lv_graph_use_e after)
+{
+	int index = lv_graph_add_resource(graph, name);
+	if (index == -1)
+	{
+		return -1;
+	}
+
+	lv_graph_resource_s *res = &graph->resources[index];
+	res->is_buffer    = 1;
+	res->buffer       = buffer;
+	res->image.before = before;
+	res->image.after  = after;
+	res->image.preserve = 1;
+
+	return index;
+}
+
+/*
+ * Adds a pass, run in the order passes are added. `record` is called by
+ * lv_graph_execute() once the barriers for the pass are recorded.
+ */
+int lv_graph_pass(lv_graph_s *graph, const char *name, void (*record)(VkCommandBuffer, void *), void *user)
+{
+	if (graph->pass_count == LV_GRAPH_MAX_PASSES)
+	{
+		return -1;
+	}
+
+	int index = graph->pass_count++;
+	lv_graph_pass_s *pass = &graph->passes[index];
+	pass->name   = name;
+	pass->record = record;
+	pass->user   = user;
+
+	return index;
+}
+
+/*
+ * Declares that `pass` uses `resource` as `use`. A pass can use a
+ * resource only once; one that is read and written, like a depth buffer
+ * that is tested and written, has a use that covers both.
+ */
+int lv_graph_use(lv_graph_s *graph, int pass, int resource, lv_graph_use_e use)
+{
+	if (pass < 0 || pass >= graph->pass_count || resource < 0 || resource >= graph->resource_count)
+	{
+		return 0;
+	}
+
+	lv_graph_pass_s *p = &graph->passes[pass];
+	if (p->use_count == LV_GRAPH_MAX_USES)
+	{
+		return 0;
+	}
+
+	for (uint32_t i = 0; i < p->use_count; ++i)
+	{
+		if (p->resources[i] == resource)
+		{
+			return 0;
+		}
+	}
+
+	p->resources[p->use_count] = resource;
+	p->uses[p->use_count]      = use;
+	++p->use_count;
+
+	return 1;
+}
+
+/*
+ * Marks the passes whose results are used: walking backwards from the
+ * resources used after the graph, a pass is live if it writes something
+ * a later live pass (or the caller) reads. Everything else is culled.
+ */
+static void
+lv_graph_cull(lv_graph_s *graph)
+{
+	int needed[LV_GRAPH_MAX_RESOURCES] = { 0 };
+
+	for (uint32_t r = 0; r < graph->resource_count; ++r)
+	{
+		needed[r] = graph->resources[r].transient == 0 && graph->resources[r].image.after != LV_USE_NONE;
+	}
+
+	for (int p = (int) graph->pass_count - 1; p >= 0; --p)
+	{
+		lv_graph_pass_s *pass = &graph->passes[p];
+		pass->live = 0;
+
+		for (uint32_t u = 0; u < pass->use_count; ++u)
+		{
+			if (lv_graph_accesses[pass->uses[u]].write && needed[pass->resources[u]])
+			{
+				pass->live = 1;
+			}
+		}
+
+		if (pass->live == 0)
+		{
+			continue;
+		}
+
+		// a write ends the need for earlier contents, a read starts it
+		for (uint32_t u = 0; u < pass->use_count; ++u)
+		{
+			needed[pass->resources[u]] = lv_graph_accesses[pass->uses[u]].write == 0;
+		}
+	}
+}
+
+/*
+ * Finds the live passes using each resource, and the image usage of
+ * transient images.
+ */
+static void
+lv_graph_lifetimes(lv_graph_s *graph)
+{
+	for (uint32_t p = 0; p < graph->pass_count; ++p)
+	{
+		lv_graph_pass_s *pass = &graph->passes[p];
+		if (pass->live == 0)
+		{
+			continue;
+		}
+
+		for (uint32_t u = 0; u < pass->use_count; ++u)
+		{
+			lv_graph_resource_s *res = &graph->resources[pass->resources[u]];
+			if (res->first == -1)
+			{
+				res->first = p;
+			}
+			res->last   = p;
+			res->usage |= lv_graph_accesses[pass->uses[u]].usage;
+		}
+	}
+}
+
+static int
+lv_graph_overlaps(const lv_graph_resource_s *a, const lv_graph_resource_s *b)
+{
+	return a->first <= b->last && b->first <= a->last;
+}
+
+/*
+ * Creates the transient images and puts them into memory blocks: an image
+ * goes into the first block none of whose images is alive at the same
+ * time and whose memory types fit, the largest images first.
+ */
+static int
+lv_graph_create_transients(lv_state_s *lv, lv_graph_s *graph)
+{
+	int order[LV_GRAPH_MAX_RESOURCES];
+	uint32_t count = 0;
+
+	VkMemoryRequirements reqs[LV_GRAPH_MAX_RESOURCES] = { 0 };
+
+	for (uint32_t r = 0; r < graph->resource_count; ++r)
+	{
+		lv_graph_resource_s *res = &graph->resources[r];
+		if (res->transient == 0 || res->first == -1)
+		{
+			continue;
+		}
+
+		// images that only ever are attachments can live in tile memory
+		VkImageUsageFlags attachments = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		if ((res->usage & ~attachments) == 0)
+		{
+			res->usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		}
+
+		VkImageCreateInfo info = { 0 };
+		info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		info.imageType     = VK_IMAGE_TYPE_2D;
+		info.format        = res->image.format;
+		info.extent.width  = res->image.extent.width;
+		info.extent.height = res->image.extent.height;
+		info.extent.depth  = 1;
+		info.mipLevels     = 1;
+		info.arrayLayers   = 1;
+		info.samples       = res->image.samples;
+		info.tiling        = VK_IMAGE_TILING_OPTIMAL;
+		info.usage         = res->usage;
+		info.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+		info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		if (vkCreateImage(lv->device, &info, lv_allocator(), &res->image.image) != VK_SUCCESS)
+		{
+			return 0;
+		}
+
+		vkGetImageMemoryRequirements(lv->device, res->image.image, &reqs[r]);
+		res->size = reqs[r].size;
+		graph->transient_size += reqs[r].size;
+
+		// insertion sort by size, there are only a few
+		uint32_t i = count++;
+		while (i > 0 && reqs[order[i - 1]].size < reqs[r].size)
+		{
+			order[i] = order[i - 1];
+			--i;
+		}
+		order[i] = r;
+	}
+
+	VkDeviceSize block_size[LV_GRAPH_MAX_RESOURCES]  = { 0 };
+	uint32_t     block_types[LV_GRAPH_MAX_RESOURCES] = { 0 };
+	int          block_lazy[LV_GRAPH_MAX_RESOURCES]  = { 0 };
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		lv_graph_resource_s *res = &graph->resources[order[i]];
+		VkMemoryRequirements *req = &reqs[order[i]];
+		int lazy = (res->usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) != 0;
+
+		for (uint32_t b = 0; b < graph->block_count && res->block == -1; ++b)
+		{
+			if ((block_types[b] & req->memoryTypeBits) == 0 || block_lazy[b] != lazy)
+			{
+				continue;
+			}
+
+			int free = 1;
+			for (uint32_t j = 0; j < i && free; ++j)
+			{
+				lv_graph_resource_s *other = &graph->resources[order[j]];
+				free = other->block != b || lv_graph_overlaps(res, other) == 0;
+			}
+
+			if (free)
+			{
+				res->block = b;
+			}
+		}
+
+		if (res->block == -1)
+		{
+			res->block = graph->block_count++;
+			block_types[res->block] = req->memoryTypeBits;
+			block_lazy[res->block]  = lazy;
+		}
+
+		block_types[res->block] &= req->memoryTypeBits;
+		block_size[res->block]   = req->size > block_size[res->block] ? req->size : block_size[res->block];
+	}
+
+	for (uint32_t b = 0; b < graph->block_count; ++b)
+	{
+		uint32_t type = 0;
+		int found = block_lazy[b] && lv_device_memory_type(lv->gpu, block_types[b],
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, &type);
+
+		if (found == 0 && lv_device_memory_type(lv->gpu, block_types[b], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &type) == 0)
+		{
+			return 0;
+		}
+
+		VkMemoryAllocateInfo alloc = { 0 };
+		alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		alloc.allocationSize  = block_size[b];
+		alloc.memoryTypeIndex = type;
+
+		if (vkAllocateMemory(lv->device, &alloc, lv_allocator(), &graph->memory[b]) != VK_SUCCESS)
+		{
+			return 0;
+		}
+		graph->allocated_size += block_size[b];
+	}
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		lv_graph_resource_s *res = &graph->resources[order[i]];
+
+		// every image of a block starts at its beginning, which is aligned for any
+		if (vkBindImageMemory(lv->device, res->image.image, graph->memory[res->block], 0) != VK_SUCCESS)
+		{
+			return 0;
+		}
+
+		VkImageViewCreateInfo info = { 0 };
+		info.sType    = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		info.image    = res->image.image;
+		info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		info.format   = res->image.format;
+		info.subresourceRange.aspectMask = res->image.aspect;
+		info.subresourceRange.levelCount = 1;
+		info.subresourceRange.layerCount = 1;
+
+		if (vkCreateImageView(lv->device, &info, lv_allocator(), &res->image.view) != VK_SUCCESS)
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * The state a resource starts out in: whatever the caller says it was
+ * used for before, or, for a transient image, nothing but the accesses
+ * of the image that had its memory before.
+ */
+static void
+lv_graph_initial_state(lv_graph_s *graph, int r, lv_graph_state_s *states)
+{
+	lv_graph_resource_s *res = &graph->resources[r];
+	lv_graph_state_s *st = &states[r];
+	memset(st, 0, sizeof(lv_graph_state_s));
+
+	if (res->transient)
+	{
+		int prev = -1;
+		for (uint32_t o = 0; o < graph->resource_count; ++o)
+		{
+			lv_graph_resource_s *other = &graph->resources[o];
+			if (o != r && other->transient && other->block == res->block && other->last < res->first &&
+					(prev == -1 || other->last > graph->resources[prev].last))
+			{
+				prev = o;
+			}
+		}
+
+		if (prev != -1)
+		{
+			st->write_stages = states[prev].write_stages;
+			st->write_access = states[prev].write_access;
+			st->read_stages  = states[prev].read_stages;
+		}
+		return;
+	}
+
+	const lv_graph_access_s *before = &lv_graph_accesses[res->image.before];
+	st->layout = res->image.preserve ? before->layout : VK_IMAGE_LAYOUT_UNDEFINED;
+
+	if (before->write)
+	{
+		st->write_stages = before->stages;
+		st->write_access = before->access;
+	}
+	else
+	{
+		st->read_stages = before->stages;
+	}
+}
+
+/*
+ * Adds the barrier, if any, `use` of resource `r` needs to `pass`, and
+ * moves the resource on to its new state. Reads of something already
+ * visible in the right layout need none, only writes and layout changes
+ * wait for the reads before them.
+ */
+static void
+lv_graph_access(lv_graph_s *graph, lv_graph_pass_s *pass, int r, lv_graph_use_e use, lv_graph_state_s *st)
+{
+	lv_graph_resource_s *res = &graph->resources[r];
+	const lv_graph_access_s *acc = &lv_graph_accesses[use];
+
+	VkImageLayout old_layout = st->layout;
+	VkImageLayout layout = res->is_buffer ? VK_IMAGE_LAYOUT_UNDEFINED : acc->layout;
+	int transition = layout != old_layout;
+
+	VkPipelineStageFlags src_stages = 0;
+	VkAccessFlags        src_access = 0;
+	int barrier = 0;
+
+	if (acc->write || transition)
+	{
+		src_stages = st->write_stages | st->read_stages;
+		src_access = st->write_access;
+		barrier = src_stages != 0 || transition;
+
+		st->layout         = layout;
+		st->write_stages   = acc->stages;
+		st->write_access   = acc->write ? acc->access : 0;
+		st->read_stages    = acc->write ? 0 : acc->stages;
+		st->visible_stages = acc->stages;
+		st->visible_access = acc->access;
+	}
+	else
+	{
+		src_stages = st->write_stages;
+		src_access = st->write_access;
+		barrier = st->write_stages != 0 &&
+			((acc->stages & ~st->visible_stages) || (acc->access & ~st->visible_access));
+
+		st->read_stages    |= acc->stages;
+		st->visible_stages |= barrier ? acc->stages : 0;
+		st->visible_access |= barrier ? acc->access : 0;
+	}
+
+	if (barrier == 0)
+	{
+		return;
+	}
+
+	pass->src_stages |= src_stages ? src_stages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	pass->dst_stages |= acc->stages ? acc->stages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+
+	if (res->is_buffer)
+	{
+		VkBufferMemoryBarrier *b = &graph->buffer_barriers[pass->first_buffer_barrier + pass->buffer_barrier_count++];
+		b->sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		b->srcAccessMask       = src_access;
+		b->dstAccessMask       = acc->access;
+		b->srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		b->dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		b->buffer              = res->buffer;
+		b->size                = VK_WHOLE_SIZE;
+		return;
+	}
+
+	VkImageMemoryBarrier *b = &graph->image_barriers[pass->first_image_barrier + pass->image_barrier_count++];
+	b->sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	b->srcAccessMask       = src_access;
+	b->dstAccessMask       = acc->access;
+	b->oldLayout           = old_layout;
+	b->newLayout           = layout;
+	b->srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	b->dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	b->image               = res->image.image;
+	b->subresourceRange.aspectMask = res->image.aspect;
+	b->subresourceRange.levelCount = 1;
+	b->subresourceRange.layerCount = 1;
+}
+
+/*
+ * Culls unused passes, creates and aliases the transient images and works
+ * out the barriers before every pass and after the last one.
+ */
+int lv_graph_compile(lv_state_s *lv, lv_graph_s *graph)
+{
+	lv_graph_cull(graph);
+	lv_graph_lifetimes(graph);
+
+	if (lv_graph_create_transients(lv, graph) == 0)
+	{
+		return 0;
+	}
+
+	// at most one barrier per use, and one per resource at the end
+	uint32_t capacity = graph->pass_count * LV_GRAPH_MAX_USES + graph->resource_count;
+	graph->image_barriers  = calloc(capacity, sizeof(VkImageMemoryBarrier));
+	graph->buffer_barriers = calloc(capacity, sizeof(VkBufferMemoryBarrier));
+	if (graph->image_barriers == NULL || graph->buffer_barriers == NULL)
+	{
+		return 0;
+	}
+
+	lv_graph_state_s states[LV_GRAPH_MAX_RESOURCES];
+	for (uint32_t r = 0; r < graph->resource_count; ++r)
+	{
+		if (graph->resources[r].transient == 0)
+		{
+			lv_graph_initial_state(graph, r, states);
+		}
+	}
+
+	uint32_t next = 0;
+	for (uint32_t p = 0; p < graph->pass_count; ++p)
+	{
+		lv_graph_pass_s *pass = &graph->passes[p];
+		pass->first_image_barrier  = next;
+		pass->first_buffer_barrier = next;
+
+		if (pass->live == 0)
+		{
+			continue;
+		}
+
+		for (uint32_t u = 0; u < pass->use_count; ++u)
+		{
+			int r = pass->resources[u];
+
+			// transient images start out from whoever had their memory last
+			if (graph->resources[r].transient && graph->resources[r].first == p)
+			{
+				lv_graph_initial_state(graph, r, states);
+			}
+
+			lv_graph_access(graph, pass, r, pass->uses[u], &states[r]);
+		}
+
+		next += LV_GRAPH_MAX_USES;
+	}
+
+	lv_graph_pass_s *end = &graph->end;
+	end->first_image_barrier  = next;
+	end->first_buffer_barrier = next;
+
+	for (uint32_t r = 0; r < graph->resource_count; ++r)
+	{
+		lv_graph_resource_s *res = &graph->resources[r];
+		if (res->transient == 0 && res->image.after != LV_USE_NONE)
+		{
+			lv_graph_access(graph, end, r, res->image.after, &states[r]);
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * Returns the view of an image, which for transient images only exists
+ * once the graph is compiled.
+ */
+VkImageView lv_graph_view(lv_graph_s *graph, int resource)
+{
+	return graph->resources[resource].image.view;
+}
+
+static void
+lv_graph_barriers(lv_graph_s *graph, lv_graph_pass_s *pass, VkCommandBuffer cb)
+{
+	if (pass->image_barrier_count == 0 && pass->buffer_barrier_count == 0)
+	{
+		return;
+	}
+
+	vkCmdPipelineBarrier(cb, pass->src_stages, pass->dst_stages, 0, 0, NULL,
+			pass->buffer_barrier_count, &graph->buffer_barriers[pass->first_buffer_barrier],
+			pass->image_barrier_count, &graph->image_barriers[pass->first_image_barrier]);
+}
+
+/*
+ * Records the live passes into `cb`, each one after a single barrier
+ * command that covers everything it waits for.
+ */
+void lv_graph_execute(lv_graph_s *graph, VkCommandBuffer cb)
+{
+	for (uint32_t p = 0; p < graph->pass_count; ++p)
+	{
+		lv_graph_pass_s *pass = &graph->passes[p];
+		if (pass->live == 0)
+		{
+			continue;
+		}
+
+		lv_graph_barriers(graph, pass, cb);
+		if (pass->record != NULL)
+		{
+			pass->record(cb, pass->user);
+		}
+	}
+
+	lv_graph_barriers(graph, &graph->end, cb);
+}
+
+void lv_print_graph(lv_graph_s *graph)
+{
+	uint32_t barriers = 0;
+
+	for (uint32_t p = 0; p <= graph->pass_count; ++p)
+	{
+		lv_graph_pass_s *pass = p < graph->pass_count ? &graph->passes[p] : &graph->end;
+		const char *name = p < graph->pass_count ? pass->name : "(end)";
+		uint32_t count = pass->image_barrier_count + pass->buffer_barrier_count;
+		barriers += count;
+
+		if (p < graph->pass_count && pass->live == 0)
+		{
+			fprintf(stdout, "  %-24s culled\n", name);
+			continue;
+		}
+		fprintf(stdout, "  %-24s %u barriers\n", name, count);
+	}
+
+	fprintf(stdout, "  %u barriers, %u transient blocks, %llu of %llu bytes allocated\n", barriers, graph->block_count,
+			(unsigned long long) graph->allocated_size, (unsigned long long) graph->transient_size);
+}
+
+/*
+ * Retires the transient images and their memory, see lv_retire(); 
+ * imported resources are left alone. The command buffers the graph was
+ * executed into must not be submitted again afterwards. The graph can be
+ * set up again after lv_graph_init().
+ */
+void lv_graph_free(lv_state_s *lv, lv_graph_s *graph)
+{
+	for (uint32_t r = 0; r < graph->resource_count; ++r)
+	{
+		lv_graph_resource_s *res = &graph->resources[r];
+		if (res->transient)
+		{
+			lv_retire(lv, VK_OBJECT_TYPE_IMAGE_VIEW, (uint64_t) res->image.view);
+			lv_retire(lv, VK_OBJECT_TYPE_IMAGE, (uint64_t) res->image.image);
+		}
+	}
+
+	for (uint32_t b = 0; b < graph->block_count; ++b)
+	{
+		lv_retire(lv, VK_OBJECT_TYPE_DEVICE_MEMORY, (uint64_t) graph->memory[b]);
+	}
+
+	free(graph->image_barriers);
+	free(graph->buffer_barriers);
+	lv_graph_init(graph);
+}
@@ -0,0 +1,296 @@
+#include <unistd.h>            // close(), read()
+#include <poll.h>              // poll()
+#include <sys/inotify.h>       // inotify_init1(), inotify_add_watch()
+
+#include "internal.h"
+
+/*
+ * Adds an inotify watch for the directory containing `path`. We watch the
+ * directory instead of the file, as many tools replace files by renaming
+ * a new one over the old one, which would silently end a file watch.
+ */
+static int
+lv_hotreload_watch(int fd, const char *path)
+{
+	char dir[PATH_MAX];
+	const char *slash = strrchr(path, '/');
+
+	if (slash == NULL)
+	{
+		strcpy(dir, ".");
+	}
+	else
+	{
+		snprintf(dir, sizeof(dir), "%.*s", (int) (slash - path), path);
+	}
+
+	return inotify_add_watch(fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) != -1;
+}
+
+/*
+ * Returns 1 if the file name reported by inotify matches the file name
+ * part of `path`, otherwise 0.
+ */
+static int
+lv_hotreload_matches(const char *path, const char *name)
+{
+	const char *slash = strrchr(path, '/');
+	return strcmp(slash ? slash + 1 : path, name) == 0;
+}
+
+/*
+ * Loads the changed shaders and builds a new pipeline from them and the
+ * current version of the unchanged ones. Runs on the hot-reload thread
+ * while `ready` is 0, so the render thread leaves the shaders alone.
+ */
+static int
+lv_hotreload_build(lv_hotreload_s *hr, int vert_changed, int frag_changed)
+{
+	lv_state_s *lv = hr->lv;
+	double start = lv_time_ms();
+
+	lv_shader_s vert = lv->vert_shader;
+	lv_shader_s frag = lv->frag_shader;
+
+	// modules are created outside of the cache, which is owned by
+	// the render thread; releasing them later destroys them directly
+	if (vert_changed)
+	{
+		vert.module = VK_NULL_HANDLE;
+		if (lv_shader_from_file_spv(lv->device, NULL, hr->vert_path, &vert, LV_SHADER_VERT) == 0)
+		{
+			lv_log(LV_LOG_ERROR, "Hot-reload: failed loading %s", hr->vert_path);
+			return 0;
+		}
+	}
+
+	if (frag_changed)
+	{
+		frag.module = VK_NULL_HANDLE;
+		if (lv_shader_from_file_spv(lv->device, NULL, hr->frag_path, &frag, LV_SHADER_FRAG) == 0)
+		{
+			lv_log(LV_LOG_ERROR, "Hot-reload: failed loading %s", hr->frag_path);
+			if (vert_changed)
+			{
+				lv_shader_module_release(lv->device, NULL, &vert);
+			}
+			return 0;
+		}
+	}
+
+	lv_shader_stage_create(lv->gpu, lv->device, VK_NULL_HANDLE, &vert, &frag);
+
+	const VkPipelineShaderStageCreateInfo stages[] = { vert.info, frag.info };
+
+	if (lv_pipeline_build(lv, stages, 2, &hr->pipeline) == 0)
+	{
+		lv_log(LV_LOG_ERROR, "Hot-reload: failed building pipeline");
+		if (vert_changed)
+		{
+			lv_shader_module_release(lv->device, NULL, &vert);
+		}
+		if (frag_changed)
+		{
+			lv_shader_module_release(lv->device, NULL, &frag);
+		}
+		return 0;
+	}
+
+	// only hand over modules that are actually new
+	hr->vert_shader = vert;
+	hr->frag_shader = frag;
+	hr->vert_shader.module = vert_changed ? vert.module : VK_NULL_HANDLE;
+	hr->frag_shader.module = frag_changed ? frag.module : VK_NULL_HANDLE;
+	hr->build_ms = lv_time_ms() - start;
+	return 1;
+}
+
+static void*
+lv_hotreload_thread(void *arg)
+{
+	lv_hotreload_s *hr = arg;
+
+	char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	struct pollfd pfd = { .fd = hr->fd, .events = POLLIN };
+
+	int vert_changed = 0;
+	int frag_changed = 0;
+
+	while (atomic_load(&hr->running))
+	{
+		// wake up regularly to check `running`; once something changed,
+		// wait for a short quiet period as tools tend to write in bursts
+		int changed = vert_changed || frag_changed;
+		int polled  = poll(&pfd, 1, changed ? 50 : 250);
+
+		if (polled > 0)
+		{
+			ssize_t len = read(hr->fd, buf, sizeof(buf));
+			for (char *p = buf; len > 0 && p < buf + len; )
+			{
+				struct inotify_event *ev = (struct inotify_event *) p;
+				if (ev->len > 0)
+				{
+					vert_changed |= lv_hotreload_matches(hr->vert_path, ev->name);
+					frag_changed |= lv_hotreload_matches(hr->frag_path, ev->name);
+				}
+				p += sizeof(struct inotify_event) + ev->len;
+			}
+			continue;
+		}
+
+		// the previous reload has not been picked up by the render thread
+		if (changed == 0 || atomic_load_explicit(&hr->ready, memory_order_acquire))
+		{
+			continue;
+		}
+
+		if (lv_hotreload_build(hr, vert_changed, frag_changed))
+		{
+			atomic_store_explicit(&hr->ready, 1, memory_order_release);
+			lv_invalidate(hr->lv);
+		}
+
+		vert_changed = 0;
+		frag_changed = 0;
+	}
+
+	return NULL;
+}
+
+/*
+ * Starts watching the given SPIR-V files. Whenever one of them changes,
+ * the shader modules and the pipeline are rebuilt on a background thread
+ * and later swapped in by lv_hotreload_apply(), which has to be called 
+ * once per frame, before lv_draw_frame().
+ */
+int lv_hotreload_start(lv_state_s *lv, const char *vert_path, const char *frag_path)
+{
+	lv_hotreload_s *hr = calloc(1, sizeof(lv_hotreload_s));
+	if (hr == NULL)
+	{
+		return 0;
+	}
+
+	hr->lv = lv;
+	snprintf(hr->vert_path, sizeof(hr->vert_path), "%s", vert_path);
+	snprintf(hr->frag_path, sizeof(hr->frag_path), "%s", frag_path);
+
+	hr->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (hr->fd == -1)
+	{
+		free(hr);
+		return 0;
+	}
+
+	if (lv_hotreload_watch(hr->fd, vert_path) == 0 || lv_hotreload_watch(hr->fd, frag_path) == 0)
+	{
+		close(hr->fd);
+		free(hr);
+		return 0;
+	}
+
+	atomic_store(&hr->running, 1);
+	if (pthread_create(&hr->thread, NULL, lv_hotreload_thread, hr) != 0)
+	{
+		close(hr->fd);
+		free(hr);
+		return 0;
+	}
+
+	lv->hotreload = hr;
+	return 1;
+}
+
+/*
+ * Swaps in a pipeline rebuilt by the hot-reload thread, if there is one.
+ * Must be called at a frame boundary, when none of the command buffers
+ * are pending execution. Returns 1 if a new pipeline has been swapped in.
+ */
+int lv_hotreload_apply(lv_state_s *lv)
+{
+	lv_hotreload_s *hr = lv->hotreload;
+	if (hr == NULL)
+	{
+		return 0;
+	}
+
+	if (atomic_load_explicit(&hr->ready, memory_order_acquire) == 0)
+	{
+		return 0;
+	}
+
+	double start = lv_time_ms();
+
+	// the registry key changes with the shaders, re-register the pipeline;
+	// the old one goes once the frames in flight are done with it
+	lv_shader_s shaders[] = { lv->vert_shader, lv->frag_shader };
+	VkPipeline retired = lv_pipeline_registry_remove(&lv->pipelines, lv_pipeline_key(shaders, 2));
+	lv_retire(lv, VK_OBJECT_TYPE_PIPELINE, (uint64_t) retired);
+
+	if (hr->vert_shader.module != VK_NULL_HANDLE)
+	{
+		lv_shader_module_release(lv->device, &lv->shader_cache, &lv->vert_shader);
+		lv->vert_shader = hr->vert_shader;
+	}
+	if (hr->frag_shader.module != VK_NULL_HANDLE)
+	{
+		lv_shader_module_release(lv->device, &lv->shader_cache, &lv->frag_shader);
+		lv->frag_shader = hr->frag_shader;
+	}
+
+	// the stage infos still point at the specialization constants of
+	// the copies made on the hot-reload thread
+	lv_shader_stage_create(lv->gpu, lv->device, lv_primary_surface(lv), &lv->vert_shader, &lv->frag_shader);
+
+	shaders[0] = lv->vert_shader;
+	shaders[1] = lv->frag_shader;
+	uint64_t key = lv_pipeline_key(shaders, 2);
+
+	if (lv_pipeline_registry_insert(&lv->pipelines, key, hr->pipeline))
+	{
+		lv->pipeline = hr->pipeline;
+	}
+	else
+	{
+		// an identical pipeline is registered already, use that one
+		vkDestroyPipeline(lv->device, hr->pipeline, lv_allocator());
+		lv->pipeline = lv_pipeline_registry_find(&lv->pipelines, key);
+	}
+	hr->pipeline = VK_NULL_HANDLE;
+
+	// the command buffers have the old pipeline baked in
+	int recorded = lv_record_commandbuffers(lv);
+
+	lv_log(LV_LOG_INFO, "Hot-reload: pipeline rebuilt in %.2f ms (background), swapped in %.2f ms (frame)",
+			hr->build_ms, lv_time_ms() - start);
+
+	atomic_store_explicit(&hr->ready, 0, memory_order_release);
+	return recorded;
+}
+
+/*
+ * Stops the hot-reload thread and destroys everything it still owns.
+ */
+void lv_hotreload_stop(lv_state_s *lv)
+{
+	lv_hotreload_s *hr = lv->hotreload;
+	if (hr == NULL)
+	{
+		return;
+	}
+
+	atomic_store(&hr->running, 0);
+	pthread_join(hr->thread, NULL);
+	close(hr->fd);
+
+	if (atomic_load(&hr->ready))
+	{
+		vkDestroyPipeline(lv->device, hr->pipeline, lv_allocator());
+		lv_shader_module_release(lv->device, NULL, &hr->vert_shader);
+		lv_shader_module_release(lv->device, NULL, &hr->frag_shader);
+	}
+
+	free(hr);
+	lv->hotreload = NULL;
+}
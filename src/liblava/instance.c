@@ -0,0 +1,272 @@
+
+#include "internal.h"
+
+#if LV_VALIDATION
+
+static VKAPI_ATTR VkBool32 VKAPI_CALL
+lv_debug_callback(VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+		VkDebugUtilsMessageTypeFlagsEXT types,
+		const VkDebugUtilsMessengerCallbackDataEXT *data, void *user)
+{
+	lv_log_level_e level = LV_LOG_DEBUG;
+
+	if (severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
+	{
+		level = LV_LOG_ERROR;
+	}
+	else if (severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
+	{
+		level = LV_LOG_WARN;
+	}
+	else if (severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT)
+	{
+		level = LV_LOG_INFO;
+	}
+
+	lv_log(level, "Vulkan: %s", data->pMessage);
+
+	// the call that triggered the message must not be aborted
+	return VK_FALSE;
+}
+
+static void
+lv_debug_messenger_info(VkDebugUtilsMessengerCreateInfoEXT *info)
+{
+	info->sType           = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+	info->messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT |
+	                        VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT |
+	                        VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
+	                        VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+	info->messageType     = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
+	                        VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
+	                        VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+	info->pfnUserCallback = lv_debug_callback;
+}
+
+/*
+ * Routes validation messages into lv_log(). The functions come from the
+ * extension, so they have to be looked up through the instance.
+ */
+static int
+lv_debug_messenger_create(lv_state_s *lv)
+{
+	PFN_vkCreateDebugUtilsMessengerEXT create = (PFN_vkCreateDebugUtilsMessengerEXT) 
+		vkGetInstanceProcAddr(lv->instance, "vkCreateDebugUtilsMessengerEXT");
+
+	VkDebugUtilsMessengerCreateInfoEXT info = { 0 };
+	lv_debug_messenger_info(&info);
+
+	if (create == NULL || create(lv->instance, &info, lv_allocator(), &lv->messenger) != VK_SUCCESS)
+	{
+		lv_log(LV_LOG_WARN, "Could not create debug messenger, validation messages are lost");
+		lv->messenger = VK_NULL_HANDLE;
+		return 0;
+	}
+
+	return 1;
+}
+
+static void
+lv_debug_messenger_destroy(lv_state_s *lv)
+{
+	if (lv->messenger == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	PFN_vkDestroyDebugUtilsMessengerEXT destroy = (PFN_vkDestroyDebugUtilsMessengerEXT) 
+		vkGetInstanceProcAddr(lv->instance, "vkDestroyDebugUtilsMessengerEXT");
+
+	if (destroy != NULL)
+	{
+		destroy(lv->instance, lv->messenger, lv_allocator());
+	}
+	lv->messenger = VK_NULL_HANDLE;
+}
+
+#endif
+
+/*
+ * Returns the Vulkan version we ask the instance for: the loader's own
+ * version, capped to the newest one we make use of. Loaders that only
+ * support 1.0 don't have vkEnumerateInstanceVersion() and would refuse
+ * to create an instance for anything higher than 1.0.
+ */
+uint32_t lv_instance_version()
+{
+	PFN_vkVoidFunction fn = vkGetInstanceProcAddr(VK_NULL_HANDLE, "vkEnumerateInstanceVersion");
+	if (fn == NULL)
+	{
+		return VK_API_VERSION_1_0;
+	}
+
+	uint32_t version = VK_API_VERSION_1_0;
+	((VkResult (*)(uint32_t *)) fn)(&version);
+
+	return version < VK_API_VERSION_1_3 ? version : VK_API_VERSION_1_3;
+}
+
+int lv_instance_create(lv_state_s *lv, lv_name_set_s *extensions, lv_name_set_s *layers)
+{
+	// some information about our application. This data is technically 
+	// optional, but it may provide some useful information to the driver 
+	// in order to optimize our specific application
+	VkApplicationInfo app = { 0 };
+	app.sType              = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	app.pApplicationName   = "Hello Lava";
+	app.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+	app.pEngineName        = "No Engine";
+	app.engineVersion      = VK_MAKE_VERSION(1, 0, 0);
+	app.apiVersion         = lv_instance_version();
+
+	// tells the Vulkan driver which global extensions and validation 
+	// layers we want to use
+	VkInstanceCreateInfo info = { 0 };
+	info.sType                   = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	info.pApplicationInfo        = &app;
+	info.enabledLayerCount       = layers ? layers->count : 0;
+	info.ppEnabledLayerNames     = layers ? layers->names : NULL;
+	info.enabledExtensionCount   = extensions ? extensions->count : 0;
+	info.ppEnabledExtensionNames = extensions ? extensions->names : NULL;
+
+#if LV_VALIDATION
+	// the validation layer and debug utils extension are added on top of
+	// whatever the caller asked for; the messenger info is also chained 
+	// into the instance, so that instance creation itself is reported
+	const char **layer_names = NULL;
+	const char **ext_names = NULL;
+	VkDebugUtilsMessengerCreateInfoEXT debug = { 0 };
+
+	if (lv->validation)
+	{
+		layer_names = malloc((info.enabledLayerCount + 1) * sizeof(char *));
+		ext_names = malloc((info.enabledExtensionCount + 1) * sizeof(char *));
+		if (layer_names == NULL || ext_names == NULL)
+		{
+			free(layer_names);
+			free(ext_names);
+			return 0;
+		}
+
+		memcpy(layer_names, info.ppEnabledLayerNames, info.enabledLayerCount * sizeof(char *));
+		memcpy(ext_names, info.ppEnabledExtensionNames, info.enabledExtensionCount * sizeof(char *));
+		layer_names[info.enabledLayerCount++] = LV_VALIDATION_LAYER;
+		ext_names[info.enabledExtensionCount++] = LV_DEBUG_UTILS_EXTENSION;
+
+		info.ppEnabledLayerNames     = layer_names;
+		info.ppEnabledExtensionNames = ext_names;
+
+		lv_debug_messenger_info(&debug);
+		info.pNext = &debug;
+	}
+#endif
+
+	lv->api_version = app.apiVersion;
+	int created = (vkCreateInstance(&info, lv_allocator(), &lv->instance) == VK_SUCCESS);
+
+#if LV_VALIDATION
+	free(layer_names);
+	free(ext_names);
+
+	if (created && lv->validation)
+	{
+		lv_debug_messenger_create(lv);
+	}
+#endif
+
+	return created;
+}
+
+/*
+ * Destroys the instance, along with the debug messenger if there is one.
+ */
+void lv_instance_destroy(lv_state_s *lv)
+{
+#if LV_VALIDATION
+	lv_debug_messenger_destroy(lv);
+#endif
+	vkDestroyInstance(lv->instance, lv_allocator());
+	lv->instance = VK_NULL_HANDLE;
+}
+
+int lv_print_extensions()
+{
+	pthread_mutex_lock(&lv_caps_lock);
+	lv_instance_caps_s *caps = lv_instance_caps_get();
+
+	for (int i = 0; i < caps->extension_count; ++i)
+	{
+		fprintf(stdout, "%*d: %s\n", 2, i+1, caps->extensions[i].extensionName);
+	}
+
+	int ext_count = caps->extension_count;
+	pthread_mutex_unlock(&lv_caps_lock);
+	return ext_count;
+}
+
+int lv_instance_has_extension(const char *name)
+{
+	pthread_mutex_lock(&lv_caps_lock);
+	lv_instance_caps_s *caps = lv_instance_caps_get();
+
+	int found = bsearch(name, caps->extensions, caps->extension_count, 
+			sizeof(VkExtensionProperties), lv_caps_find_extension) != NULL;
+
+	pthread_mutex_unlock(&lv_caps_lock);
+	return found;
+}
+
+int lv_print_layers()
+{
+	pthread_mutex_lock(&lv_caps_lock);
+	lv_instance_caps_s *caps = lv_instance_caps_get();
+
+	for (int i = 0; i < caps->layer_count; ++i)
+	{
+		fprintf(stdout, "%*d: %s\n", 2, i+1, caps->layers[i].layerName);
+	}
+
+	int layer_count = caps->layer_count;
+	pthread_mutex_unlock(&lv_caps_lock);
+	return layer_count;
+}
+
+int lv_instance_has_layer(const char *name)
+{
+	pthread_mutex_lock(&lv_caps_lock);
+	lv_instance_caps_s *caps = lv_instance_caps_get();
+
+	int found = bsearch(name, caps->layers, caps->layer_count, 
+			sizeof(VkLayerProperties), lv_caps_find_layer) != NULL;
+
+	pthread_mutex_unlock(&lv_caps_lock);
+	return found;
+}
+
+/*
+ * Asks for validation on the next lv_instance_create(). Returns 0, and 
+ * leaves validation off, if this is a release build or the layer isn't
+ * installed, which is not an error: the application runs without it.
+ */
+int lv_validation_enable(lv_state_s *lv)
+{
+#if LV_VALIDATION
+	if (lv_instance_has_layer(LV_VALIDATION_LAYER) == 0)
+	{
+		lv_log(LV_LOG_WARN, "%s not installed, running without validation", LV_VALIDATION_LAYER);
+		return 0;
+	}
+
+	if (lv_instance_has_extension(LV_DEBUG_UTILS_EXTENSION) == 0)
+	{
+		lv_log(LV_LOG_WARN, "%s not available, running without validation", LV_DEBUG_UTILS_EXTENSION);
+		return 0;
+	}
+
+	lv->validation = 1;
+	return 1;
+#else
+	lv_log(LV_LOG_WARN, "Validation is not compiled into release builds");
+	return 0;
+#endif
+}
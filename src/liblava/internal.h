@@ -0,0 +1,495 @@
+#ifndef LIBLAVA_INTERNAL_H
+#define LIBLAVA_INTERNAL_H
+
+#include <stdio.h>             // fprintf(), ...
+#include <stdlib.h>            // malloc(), free(), ...
+#include <string.h>            // memcpy(), strcmp(), ...
+#include <limits.h>            // PATH_MAX
+#include <pthread.h>           // pthread_mutex_t
+#include <stdatomic.h>         // atomic_int, atomic_load(), ...
+
+#include "liblava.h"
+
+//
+// Shared between the modules of liblava, not part of its interface.
+//
+
+#define LV_VALIDATION_LAYER     "VK_LAYER_KHRONOS_validation"
+#define LV_DEBUG_UTILS_EXTENSION "VK_EXT_debug_utils"
+
+#define LV_MAX_PHASES 32
+
+#define LV_SCOPE_COUNT    5		// values of VkSystemAllocationScope
+#define LV_ARENA_SIZE     (256 * 1024)
+#define LV_POOL_CLASSES   8		// blocks of 64 bytes up to 8 KiB
+#define LV_POOL_MIN_SHIFT 6
+#define LV_POOL_SLAB_SIZE (64 * 1024)
+#define LV_ALLOC_ALIGN    16		// minimum alignment handed out
+
+//
+// ENUMS
+//
+
+enum lv_alloc_source
+{
+	LV_ALLOC_ARENA, // per thread bump arena, for command scope
+	LV_ALLOC_POOL,  // size class pool, for object scope
+	LV_ALLOC_HEAP   // malloc(), for everything else or too large
+};
+
+typedef enum lv_alloc_source lv_alloc_source_e;
+
+//
+// STRUCTS
+// 
+
+struct lv_instance_caps
+{
+	VkExtensionProperties *extensions;	// sorted by name
+	uint32_t               extension_count;
+	VkLayerProperties     *layers;		// sorted by name
+	uint32_t               layer_count;
+	int                    valid;
+};
+
+typedef struct lv_instance_caps lv_instance_caps_s;
+
+struct lv_device_caps
+{
+	VkPhysicalDevice          gpu;
+	VkExtensionProperties    *extensions;	// sorted by name
+	uint32_t                  extension_count;
+	VkQueueFamilyProperties  *queues;
+	uint32_t                  queue_count;
+};
+
+typedef struct lv_device_caps lv_device_caps_s;
+
+/*
+ * What a physical device can do with one surface. There is one per
+ * device and surface, as every output has a surface of its own.
+ */
+struct lv_surface_caps
+{
+	VkPhysicalDevice          gpu;
+	VkSurfaceKHR              surface;
+	VkBool32                 *queue_present;	// per queue family
+	uint32_t                  queue_count;
+	VkSurfaceCapabilitiesKHR  surface_caps;
+	VkSurfaceFormatKHR       *formats;
+	uint32_t                  format_count;
+	VkPresentModeKHR         *present_modes;
+	uint32_t                  present_mode_count;
+};
+
+typedef struct lv_surface_caps lv_surface_caps_s;
+
+struct lv_shader_cache_entry
+{
+	uint64_t        hash;		// FNV-1a hash of the bytecode
+	size_t          size;		// size of bytecode, guards against collisions
+	VkShaderModule  module;		// vulkan shader module
+	uint32_t        refs;		// number of lv_shader_s using the module
+};
+
+typedef struct lv_shader_cache_entry lv_shader_cache_entry_s;
+
+struct lv_shader_cache
+{
+	lv_shader_cache_entry_s *entries;	// open addressing, power of two
+	uint32_t                 capacity;
+	uint32_t                 count;
+};
+
+struct lv_pipeline_registry_entry
+{
+	uint64_t    key;		// see lv_pipeline_key()
+	VkPipeline  pipeline;
+};
+
+typedef struct lv_pipeline_registry_entry lv_pipeline_registry_entry_s;
+
+struct lv_pipeline_registry
+{
+	lv_pipeline_registry_entry_s *entries;	// open addressing, power of two
+	uint32_t                      capacity;
+	uint32_t                      count;
+};
+
+struct lv_buffer_set
+{
+	union
+	{
+		VkFramebuffer   *fbs;
+		VkCommandBuffer *cbs;
+	};
+	uint32_t  count;
+};
+
+typedef struct lv_buffer_set lv_buffer_set_s;
+
+/*
+ * Precedes every block handed out by the host allocator, directly before
+ * the aligned pointer, so that it can be freed without being looked up.
+ */
+struct lv_alloc_header
+{
+	size_t   size;		// as requested
+	void    *owner;		// arena or pool the block came from
+	uint32_t offset;	// from the start of the block to the pointer
+	uint8_t  scope;		// VkSystemAllocationScope
+	uint8_t  source;	// lv_alloc_source_e
+	uint8_t  size_class;	// pool size class
+};
+
+typedef struct lv_alloc_header lv_alloc_header_s;
+
+/*
+ * Command scope allocations only live for the duration of a single 
+ * Vulkan call, so they are bumped off a buffer owned by the calling 
+ * thread, which is rewound once all of them have been freed again.
+ */
+struct lv_arena
+{
+	char        *base;
+	size_t       top;
+	atomic_uint  live;	// blocks not freed yet and its thread, the last one frees it
+};
+
+typedef struct lv_arena lv_arena_s;
+
+/*
+ * Fixed size blocks carved from slabs, kept on a free list; the slabs 
+ * themselves are only returned on lv_allocator_free().
+ */
+struct lv_pool
+{
+	pthread_mutex_t  lock;
+	void            *free;	// blocks, linked through their first word
+	void            *slabs;	// slabs, linked through their first word
+	size_t           block_size;
+};
+
+typedef struct lv_pool lv_pool_s;
+
+/*
+ * Host memory the driver asked for, by VkSystemAllocationScope.
+ * `internal` is memory the driver allocated itself and only reported.
+ */
+struct lv_allocations
+{
+	atomic_size_t live_bytes[LV_SCOPE_COUNT];
+	atomic_size_t live_count[LV_SCOPE_COUNT];
+	atomic_size_t total_count[LV_SCOPE_COUNT];
+	atomic_size_t internal_bytes[LV_SCOPE_COUNT];
+	atomic_size_t source_count[3];	// by lv_alloc_source_e
+};
+
+typedef struct lv_allocations lv_allocations_s;
+
+struct lv_phase
+{
+	const char *name;
+	double      start;		// ms since lv_timings_start()
+	double      duration;	// ms
+	size_t      allocations;	// host allocations by the driver
+};
+
+typedef struct lv_phase lv_phase_s;
+
+/*
+ * lv_draw_stats_s summed over every frame that drew a list.
+ */
+struct lv_draw_totals
+{
+	uint64_t     frames;
+	uint64_t     draws;
+	uint64_t     binds;
+	uint64_t     binds_unsorted;
+	double       sort_ms;
+	double       record_ms;
+};
+
+typedef struct lv_draw_totals lv_draw_totals_s;
+
+/*
+ * Start up timings. Phases may be recorded from several threads at once,
+ * as independent parts of the initialization can run in parallel. Draw
+ * lists only from the one that draws.
+ */
+struct lv_timings
+{
+	double       start;		// lv_time_ms() at lv_timings_start()
+	double       first_frame;	// ms from start until the first present
+	lv_phase_s   phases[LV_MAX_PHASES];
+	atomic_uint  count;
+	lv_draw_totals_s draws;	// see lv_timings_draws()
+};
+
+typedef struct lv_timings lv_timings_s;
+
+/*
+ * An image that only lives within the render pass, like the depth buffer:
+ * cleared on load, never stored, and backed by lazily allocated memory
+ * where the device has it, so it may never leave tile memory.
+ */
+struct lv_attachment
+{
+	VkImage           image;
+	VkDeviceMemory    memory;
+	VkImageView       view;
+	int               lazy;		// in lazily allocated memory
+};
+
+typedef struct lv_attachment lv_attachment_s;
+
+/*
+ * What an output has to redraw, see damage.c. Every swapchain image 
+ * keeps the bounds of what changed since it was last drawn.
+ */
+struct lv_damage
+{
+	int               enabled;	// otherwise every frame draws all of it
+	VkRect2D          rects[LV_MAX_DAMAGE];	// changed since the last frame
+	uint32_t          count;
+	int               full;		// all of it changed
+	VkRectLayerKHR    present[LV_MAX_DAMAGE];	// what changed, for the compositor
+	uint32_t          present_count;
+	VkRect2D         *stale;	// per image, out of date
+	uint32_t          image_count;
+};
+
+typedef struct lv_damage lv_damage_s;
+
+/*
+ * Damage on its way from lv_output_damage(), on any thread, to the
+ * thread that draws. Every rectangle is packed into one word, 0 for a
+ * free slot, so neither side takes a lock, see damage.c.
+ */
+struct lv_damage_inbox
+{
+	_Atomic uint64_t  rects[LV_MAX_DAMAGE];
+	atomic_int        full;
+};
+
+typedef struct lv_damage_inbox lv_damage_inbox_s;
+
+/*
+ * One window and everything needed to present to it. All outputs share
+ * the device, the render pass and the pipelines; their command buffers
+ * are submitted together and presented with a single vkQueuePresentKHR.
+ */
+struct lv_output
+{
+	int               used;		// slot taken, see lv_output_add()
+	void             *window;	// kept for the application
+	VkSurfaceKHR      surface;
+	VkExtent2D        extent;
+	VkSwapchainKHR    swapchain;
+	atomic_int        stale;	// to be rebuilt, see lv_output_rebuild()
+	lv_image_set_s    images;
+	lv_attachment_s   depth;	// if there is a depth format
+	lv_attachment_s   msaa;		// multisampled color, resolved into the image
+	lv_buffer_set_s   framebuffers;
+	lv_buffer_set_s   commandbuffers;	// one per image
+	VkCommandBuffer   frame_cbs[LV_FRAMES_IN_FLIGHT];	// recorded per frame when tracking damage
+	lv_graph_s       *graphs;	// per command buffer, the frame ones first, see lv_record_scene_graph()
+	VkSemaphore       image_available[LV_FRAMES_IN_FLIGHT];	// per frame slot
+	uint32_t          image_index;	// acquired for the frame being drawn
+	lv_damage_s       damage;
+	lv_damage_inbox_s inbox;
+	int               rerecord;	// its command buffers, by the next frame
+	int               drawing;	// by the frame, see lv_draw_frame()
+	int               removed;	// while drawn, the frame removes it
+};
+
+typedef struct lv_output lv_output_s;
+
+/*
+ * What a frame in flight uses until the GPU is done with it. Frames take
+ * turns with the slots, so a frame only waits for the one that used its
+ * slot LV_FRAMES_IN_FLIGHT frames before.
+ */
+struct lv_frame_slot
+{
+	VkSemaphore       render_finished;	// signalled once for all outputs
+	uint64_t          value;	// of the last submit that used the slot
+};
+
+typedef struct lv_frame_slot lv_frame_slot_s;
+
+/*
+ * Decides when the next frame is drawn, see frame.c.
+ */
+struct lv_scheduler
+{
+	lv_frame_mode_e mode;
+	double          interval;	// ms between frames when continuous, 0 for no limit
+	double          deadline;	// lv_time_ms() the next frame should be done by
+	double          frame_ms;	// predicted duration of a frame, GPU included
+	atomic_int      invalid;	// set by lv_invalidate()
+	void          (*wait)(double timeout);	// for events, see lv_frame_events()
+	void          (*wake)();
+	atomic_int      threaded;	// frames are drawn on the render thread
+	pthread_mutex_t lock;		// the render thread waits on `invalid` with it
+	pthread_cond_t  cond;
+	uint64_t        frames;
+	double          report;		// lv_time_ms() of the last frame rate report
+	uint64_t        report_frames;
+	lv_draw_totals_s report_draws;	// lv->timings.draws at the last report
+};
+
+typedef struct lv_scheduler lv_scheduler_s;
+
+/*
+ * A triple-buffered copy of some state, see render.c.
+ */
+struct lv_snapshot
+{
+	unsigned char    *data;		// three copies, `stride` bytes apart
+	size_t            size;
+	size_t            stride;	// size rounded up to a cache line
+	atomic_uint       middle;	// handed over, LV_SNAPSHOT_FRESH until read
+	unsigned          back;		// the writer's
+	unsigned          front;	// the reader's
+};
+
+/*
+ * An object waiting to be destroyed until the graphics queue's timeline
+ * reaches the value of the last submit at the time it was retired.
+ */
+struct lv_retired
+{
+	VkObjectType type;
+	uint64_t     handle;
+	uint64_t     value;
+};
+
+typedef struct lv_retired lv_retired_s;
+
+struct lv_state
+{
+	VkInstance        instance;
+	uint32_t          api_version;	// version requested for the instance
+	int               validation;	// enable validation, see lv_validation_enable()
+	VkDebugUtilsMessengerEXT messenger;
+	VkPhysicalDevice  gpu;
+	VkPhysicalDeviceFeatures features;	// required, enabled on the device
+	VkDevice          device;
+	lv_queue_s        gqueue;
+	lv_queue_s        pqueue;
+	int               classic_rendering;	// see lv_dynamic_rendering_disable()
+	int               dynamic_rendering;	// in use, no render pass or framebuffers
+	PFN_vkCmdBeginRenderingKHR cmd_begin_rendering;
+	PFN_vkCmdEndRenderingKHR   cmd_end_rendering;
+	int               timeline_semaphores;	// gqueue.timeline is usable
+	int               incremental_present;	// VK_KHR_incremental_present enabled
+	PFN_vkWaitSemaphoresKHR    wait_semaphores;
+	PFN_vkGetSemaphoreCounterValueKHR get_semaphore_counter;
+	int               external_memory_host;	// VK_EXT_external_memory_host enabled
+	VkDeviceSize      host_pointer_alignment;	// of imported host memory
+	PFN_vkGetMemoryHostPointerPropertiesEXT get_host_pointer_properties;
+	VkSurfaceFormatKHR format;	// of all swapchains and the render pass
+	VkFormat          depth_format;	// VK_FORMAT_UNDEFINED if there is no depth buffer
+	VkSampleCountFlagBits samples;	// of color and depth, see lv_msaa_set()
+	lv_output_s       outputs[LV_MAX_OUTPUTS];
+	uint32_t          output_count;	// slots up to the last one used
+	pthread_mutex_t   outputs_lock;	// outputs and the command pool
+	lv_shader_s       vert_shader;
+	lv_shader_s       frag_shader;
+	lv_shader_cache_s shader_cache;
+	VkRenderPass      render_pass;
+	VkRenderPass      render_pass_preserve;	// loads the presented image, see lv_renderpass_create()
+	VkPipelineLayout  pipeline_layout;	// with lv_mesh_dequant_s as push constants
+	lv_vertex_layout_s vertex_layout;	// of all pipelines, see lv_vertex_layout_set()
+	VkPipeline        pipeline;
+	VkPipelineCache   pipeline_cache;
+	lv_pipeline_registry_s pipelines;
+	VkCommandPool     commandpool;	// of the outputs, reset by lv_record_commandbuffers()
+	pthread_mutex_t   submit_lock;	// queue submits and presents, uploads come from any thread
+	lv_frame_slot_s   frames[LV_FRAMES_IN_FLIGHT];
+	uint64_t          frame_count;	// frames submitted, picks the next slot
+	atomic_int        rerecord;	// by some output, see lv_output_rerecord()
+	lv_retired_s     *retired;	// ordered by value, see lv_retire()
+	uint32_t          retired_count;
+	uint32_t          retired_capacity;
+	pthread_mutex_t   retired_lock;
+	struct lv_hotreload *hotreload;
+	lv_timings_s      timings;
+	lv_scheduler_s    scheduler;
+	pthread_t         render_thread;	// see lv_render_thread_start()
+	int               render_result;	// 0 if it stopped because a frame failed
+	int             (*render_frame)(lv_state_s *lv, void *user);
+	void             *render_user;
+	lv_jobs_s        *jobs;	// shared by everything that runs in parallel
+	lv_draw_list_s   *draws;	// recorded by the scene pass, see lv_draws_set()
+};
+
+struct lv_hotreload
+{
+	lv_state_s       *lv;
+	char              vert_path[PATH_MAX];
+	char              frag_path[PATH_MAX];
+	int               fd;		// inotify instance
+	pthread_t         thread;	// watches and rebuilds in the background
+	atomic_int        running;	// cleared to stop the thread
+	atomic_int        ready;	// set by the thread once `pipeline` and the shaders are ready
+	lv_shader_s       vert_shader;	// replacement shaders, module set if changed
+	lv_shader_s       frag_shader;
+	VkPipeline        pipeline;	// replacement pipeline
+	double            build_ms;	// time spent on the background thread
+};
+
+typedef struct lv_hotreload lv_hotreload_s;
+
+//
+// FUNCTIONS
+//
+
+// core.c, on the thread that draws
+void lv_timings_draws(lv_state_s *lv, const lv_draw_stats_s *stats);
+
+// caps.c, all of these have to be called with lv_caps_lock held
+extern pthread_mutex_t lv_caps_lock;
+lv_instance_caps_s *lv_instance_caps_get();
+lv_device_caps_s *lv_device_caps_get(VkPhysicalDevice device);
+lv_surface_caps_s *lv_surface_caps_get(VkPhysicalDevice device, VkSurfaceKHR surface);
+int lv_caps_find_extension(const void *name, const void *ext);
+int lv_caps_find_layer(const void *name, const void *layer);
+
+// instance.c
+void lv_instance_destroy(lv_state_s *lv);
+
+// swapchain.c, the output functions have to be called with outputs_lock held
+VkSurfaceKHR lv_primary_surface(lv_state_s *lv);
+int lv_output_build(lv_state_s *lv, lv_output_s *out);
+int lv_output_rebuild(lv_state_s *lv, lv_output_s *out);
+void lv_output_release(lv_state_s *lv, lv_output_s *out);
+int lv_outputs_build(lv_state_s *lv);	// takes outputs_lock itself
+void lv_output_destroy(lv_state_s *lv, lv_output_s *out);
+
+// commands.c, with outputs_lock held
+int lv_output_record(lv_state_s *lv, lv_output_s *out);
+void lv_output_rerecord(lv_state_s *lv, lv_output_s *out);
+
+// damage.c, with outputs_lock held
+int lv_damage_create(lv_output_s *out);
+void lv_damage_free(lv_output_s *out);
+void lv_damage_receive(lv_output_s *out);
+int lv_damage_pending(lv_output_s *out);
+VkRect2D lv_damage_take(lv_output_s *out, uint32_t image, VkPresentRegionKHR *region);
+
+// frame.c
+void lv_frame_init(lv_scheduler_s *sched);
+void lv_frame_free(lv_scheduler_s *sched);
+void lv_frame_finished(lv_state_s *lv, double ms);
+
+// sync.c
+void lv_retire_flush(lv_state_s *lv);	// waits for the device to go idle
+VkResult lv_queue_present(lv_state_s *lv, const VkPresentInfoKHR *info);
+
+// upload.c
+int lv_buffer_create(lv_state_s *lv, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags props,
+		VkBuffer *buffer, VkDeviceMemory *memory);
+
+#endif
@@ -0,0 +1,597 @@
+#define _GNU_SOURCE            // pthread_setaffinity_np(), CPU_SET()
+#include <unistd.h>            // sysconf()
+#include <sched.h>             // cpu_set_t, sched_yield()
+
+#include "internal.h"
+
+//
+// A job system for everything in liblava, and the application, that can
+// run in parallel, so nothing has to start threads of its own.
+//
+// There is one worker per core but one, the thread that created the job
+// system takes part in it as well while it waits for jobs. Every one of
+// them has a work-stealing deque (Chase-Lev, with C11 atomics as in Lê
+// et al., "Correct and Efficient Work-Stealing for Weak Memory Models"):
+// the owner pushes and pops at the bottom without locking, idle threads
+// steal from the top. Jobs submitted from other threads go through a
+// locked queue, and so do jobs that have to run on the main thread, such
+// as everything calling GLFW.
+//
+// Jobs are fork/join: lv_jobs_run() adds the jobs to a counter, each job
+// finished takes one off, lv_jobs_wait() runs jobs until it reaches 0.
+// The jobs are the caller's and have to stay around until then.
+//
+
+#define LV_JOBS_DEQUE_SIZE 4096	// per thread, a power of two
+#define LV_JOBS_SPIN       64	// rounds of stealing before a worker sleeps
+
+/*
+ * A Chase-Lev deque of job pointers with a fixed size. Thieves and the
+ * owner each get a cache line of their own.
+ */
+struct lv_job_deque
+{
+	_Alignas(64) atomic_llong top;	// stolen from
+	_Alignas(64) atomic_llong bottom;	// pushed to and popped from by the owner
+	lv_job_s  *_Atomic  slots[LV_JOBS_DEQUE_SIZE];
+};
+
+typedef struct lv_job_deque lv_job_deque_s;
+
+/*
+ * A locked ring of jobs, for the submissions that can't use a deque.
+ */
+struct lv_job_queue
+{
+	pthread_mutex_t     lock;
+	lv_job_s          **jobs;
+	uint32_t            head;
+	uint32_t            count;
+	uint32_t            capacity;
+	atomic_uint         size;	// count, to look without locking
+};
+
+typedef struct lv_job_queue lv_job_queue_s;
+
+struct lv_jobs
+{
+	uint32_t            thread_count;	// workers plus the main thread
+	lv_job_deque_s     *deques;	// per thread, the main thread's first
+	pthread_t          *threads;	// the workers'
+	lv_job_queue_s      submitted;	// from threads without a deque
+	lv_job_queue_s      main;	// only for the main thread
+	atomic_int          running;
+	atomic_uint         epoch;	// bumped with every submission
+	atomic_uint         sleeping;
+	pthread_mutex_t     sleep_lock;
+	pthread_cond_t      sleep_cond;
+};
+
+/*
+ * The thread's index into the deques of the job system it belongs to.
+ */
+static _Thread_local lv_jobs_s *lv_jobs_owner = NULL;
+static _Thread_local uint32_t   lv_jobs_index = 0;
+
+static void
+lv_job_deque_init(lv_job_deque_s *deque)
+{
+	atomic_init(&deque->top, 0);
+	atomic_init(&deque->bottom, 0);
+}
+
+/*
+ * Owner only. Returns 0 if the deque is full.
+ */
+static int
+lv_job_deque_push(lv_job_deque_s *deque, lv_job_s *job)
+{
+	long long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+	long long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+
+	if (b - t >= LV_JOBS_DEQUE_SIZE)
+	{
+		return 0;
+	}
+
+	atomic_store_explicit(&deque->slots[b & (LV_JOBS_DEQUE_SIZE - 1)], job, memory_order_relaxed);
+	atomic_store_explicit(&deque->bottom, b + 1, memory_order_release);
+	return 1;
+}
+
+/*
+ * Owner only, takes the job pushed last.
+ */
+static lv_job_s *
+lv_job_deque_pop(lv_job_deque_s *deque)
+{
+	long long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+	atomic_store_explicit(&deque->bottom, b, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	long long t = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+	if (t > b)
+	{
+		atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+		return NULL;
+	}
+
+	lv_job_s *job = atomic_load_explicit(&deque->slots[b & (LV_JOBS_DEQUE_SIZE - 1)], memory_order_relaxed);
+	if (t == b)
+	{
+		// the last one, a thief may be after it as well
+		if (atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1,
+					memory_order_seq_cst, memory_order_relaxed) == 0)
+		{
+			job = NULL;
+		}
+		atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+	}
+	return job;
+}
+
+/*
+ * Any thread, takes the job pushed first. May fail to a competing thief.
+ */
+static lv_job_s *
+lv_job_deque_steal(lv_job_deque_s *deque)
+{
+	long long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+	atomic_thread_fence(memory_order_seq_cst);
+	long long b = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+	if (t >= b)
+	{
+		return NULL;
+	}
+
+	lv_job_s *job = atomic_load_explicit(&deque->slots[t & (LV_JOBS_DEQUE_SIZE - 1)], memory_order_relaxed);
+	if (atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1,
+				memory_order_seq_cst, memory_order_relaxed) == 0)
+	{
+		return NULL;
+	}
+	return job;
+}
+
+static void
+lv_job_queue_init(lv_job_queue_s *queue)
+{
+	memset(queue, 0, sizeof(lv_job_queue_s));
+	pthread_mutex_init(&queue->lock, NULL);
+	atomic_init(&queue->size, 0);
+}
+
+static void
+lv_job_queue_free(lv_job_queue_s *queue)
+{
+	pthread_mutex_destroy(&queue->lock);
+	free(queue->jobs);
+}
+
+static int
+lv_job_queue_push(lv_job_queue_s *queue, lv_job_s *job)
+{
+	pthread_mutex_lock(&queue->lock);
+	if (queue->count == queue->capacity)
+	{
+		uint32_t capacity = queue->capacity ? queue->capacity * 2 : 256;
+		lv_job_s **jobs = malloc(sizeof(lv_job_s *) * capacity);
+		if (jobs == NULL)
+		{
+			pthread_mutex_unlock(&queue->lock);
+			return 0;
+		}
+
+		for (uint32_t i = 0; i < queue->count; ++i)
+		{
+			jobs[i] = queue->jobs[(queue->head + i) % queue->capacity];
+		}
+		free(queue->jobs);
+		queue->jobs = jobs;
+		queue->head = 0;
+		queue->capacity = capacity;
+	}
+
+	queue->jobs[(queue->head + queue->count++) % queue->capacity] = job;
+	atomic_store(&queue->size, queue->count);
+	pthread_mutex_unlock(&queue->lock);
+	return 1;
+}
+
+static lv_job_s *
+lv_job_queue_pop(lv_job_queue_s *queue)
+{
+	if (atomic_load_explicit(&queue->size, memory_order_relaxed) == 0)
+	{
+		return NULL;
+	}
+
+	lv_job_s *job = NULL;
+	pthread_mutex_lock(&queue->lock);
+	if (queue->count > 0)
+	{
+		job = queue->jobs[queue->head];
+		queue->head = (queue->head + 1) % queue->capacity;
+		--queue->count;
+		atomic_store(&queue->size, queue->count);
+	}
+	pthread_mutex_unlock(&queue->lock);
+	return job;
+}
+
+static void
+lv_job_execute(lv_job_s *job)
+{
+	job->fn(job->arg);
+	atomic_fetch_sub_explicit(&job->counter->pending, 1, memory_order_release);
+}
+
+/*
+ * Finds a job for the calling thread: its own newest one first, then
+ * the oldest of someone else's, then a submitted one.
+ */
+static lv_job_s *
+lv_jobs_find(lv_jobs_s *jobs, uint32_t self)
+{
+	lv_job_s *job = lv_job_deque_pop(&jobs->deques[self]);
+
+	for (uint32_t i = 1; job == NULL && i < jobs->thread_count; ++i)
+	{
+		job = lv_job_deque_steal(&jobs->deques[(self + i) % jobs->thread_count]);
+	}
+
+	if (job == NULL)
+	{
+		job = lv_job_queue_pop(&jobs->submitted);
+	}
+
+	return job;
+}
+
+static void
+lv_jobs_wake(lv_jobs_s *jobs)
+{
+	atomic_fetch_add(&jobs->epoch, 1);
+	if (atomic_load(&jobs->sleeping) > 0)
+	{
+		pthread_mutex_lock(&jobs->sleep_lock);
+		pthread_cond_broadcast(&jobs->sleep_cond);
+		pthread_mutex_unlock(&jobs->sleep_lock);
+	}
+}
+
+static void *
+lv_jobs_worker(void *arg)
+{
+	lv_jobs_s *jobs = arg;
+
+	// the index was handed over before the thread was started
+	lv_jobs_owner = jobs;
+	pthread_mutex_lock(&jobs->sleep_lock);
+	for (uint32_t i = 1; i < jobs->thread_count; ++i)
+	{
+		if (pthread_equal(jobs->threads[i - 1], pthread_self()))
+		{
+			lv_jobs_index = i;
+		}
+	}
+	pthread_mutex_unlock(&jobs->sleep_lock);
+
+	uint32_t idle = 0;
+	while (atomic_load_explicit(&jobs->running, memory_order_relaxed))
+	{
+		unsigned epoch = atomic_load(&jobs->epoch);
+
+		lv_job_s *job = lv_jobs_find(jobs, lv_jobs_index);
+		if (job != NULL)
+		{
+			lv_job_execute(job);
+			idle = 0;
+			continue;
+		}
+
+		if (++idle < LV_JOBS_SPIN)
+		{
+			sched_yield();
+			continue;
+		}
+
+		// nothing has been submitted since looking, sleep until it is
+		pthread_mutex_lock(&jobs->sleep_lock);
+		atomic_fetch_add(&jobs->sleeping, 1);
+		while (atomic_load(&jobs->epoch) == epoch && atomic_load(&jobs->running))
+		{
+			pthread_cond_wait(&jobs->sleep_cond, &jobs->sleep_lock);
+		}
+		atomic_fetch_sub(&jobs->sleeping, 1);
+		pthread_mutex_unlock(&jobs->sleep_lock);
+		idle = 0;
+	}
+
+	return NULL;
+}
+
+/*
+ * Creates a job system with the given number of workers, or one per
+ * core but one if it is 0. Each worker is pinned to a core of its own.
+ * The calling thread becomes the main thread, see lv_jobs_run_main().
+ */
+lv_jobs_s *lv_jobs_create(uint32_t workers)
+{
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	if (workers == 0)
+	{
+		workers = cores > 1 ? (uint32_t) cores - 1 : 1;
+	}
+
+	lv_jobs_s *jobs = calloc(1, sizeof(lv_jobs_s));
+	if (jobs == NULL)
+	{
+		return NULL;
+	}
+
+	jobs->thread_count = workers + 1;
+	jobs->deques  = aligned_alloc(64, sizeof(lv_job_deque_s) * jobs->thread_count);
+	jobs->threads = calloc(workers, sizeof(pthread_t));
+
+	if (jobs->deques == NULL || jobs->threads == NULL)
+	{
+		free(jobs->deques);
+		free(jobs->threads);
+		free(jobs);
+		return NULL;
+	}
+
+	for (uint32_t i = 0; i < jobs->thread_count; ++i)
+	{
+		lv_job_deque_init(&jobs->deques[i]);
+	}
+
+	lv_job_queue_init(&jobs->submitted);
+	lv_job_queue_init(&jobs->main);
+	atomic_init(&jobs->running, 1);
+	atomic_init(&jobs->epoch, 0);
+	atomic_init(&jobs->sleeping, 0);
+	pthread_mutex_init(&jobs->sleep_lock, NULL);
+	pthread_cond_init(&jobs->sleep_cond, NULL);
+
+	lv_jobs_owner = jobs;
+	lv_jobs_index = 0;
+
+	// the workers look up their index once all of them have been started
+	pthread_mutex_lock(&jobs->sleep_lock);
+	uint32_t started = 0;
+	for (uint32_t i = 0; i < workers; ++i)
+	{
+		if (pthread_create(&jobs->threads[started], NULL, lv_jobs_worker, jobs) != 0)
+		{
+			continue;
+		}
+
+		// more workers than cores are left to the OS to place
+		if (i + 1 < cores)
+		{
+			cpu_set_t cpus;
+			CPU_ZERO(&cpus);
+			CPU_SET(i + 1, &cpus);
+			pthread_setaffinity_np(jobs->threads[started], sizeof(cpu_set_t), &cpus);
+		}
+		++started;
+	}
+	jobs->thread_count = started + 1;
+	pthread_mutex_unlock(&jobs->sleep_lock);
+
+	lv_log(LV_LOG_INFO, "Job system with %u workers", started);
+	return jobs;
+}
+
+/*
+ * Stops the workers. Jobs still queued are not run.
+ */
+void lv_jobs_free(lv_jobs_s *jobs)
+{
+	if (jobs == NULL)
+	{
+		return;
+	}
+
+	atomic_store(&jobs->running, 0);
+	pthread_mutex_lock(&jobs->sleep_lock);
+	pthread_cond_broadcast(&jobs->sleep_cond);
+	pthread_mutex_unlock(&jobs->sleep_lock);
+
+	for (uint32_t i = 0; i + 1 < jobs->thread_count; ++i)
+	{
+		pthread_join(jobs->threads[i], NULL);
+	}
+
+	if (lv_jobs_owner == jobs)
+	{
+		lv_jobs_owner = NULL;
+	}
+
+	lv_job_queue_free(&jobs->submitted);
+	lv_job_queue_free(&jobs->main);
+	pthread_cond_destroy(&jobs->sleep_cond);
+	pthread_mutex_destroy(&jobs->sleep_lock);
+	free(jobs->threads);
+	free(jobs->deques);
+	free(jobs);
+}
+
+/*
+ * Returns the number of threads running jobs, the main thread included.
+ */
+uint32_t lv_jobs_threads(lv_jobs_s *jobs)
+{
+	return jobs->thread_count;
+}
+
+/*
+ * Submits `count` jobs and adds them to `counter`. The workers and the
+ * main thread push to their own deques, any other thread to a shared
+ * queue. The jobs must not go away before the counter reaches 0.
+ */
+void lv_jobs_run(lv_jobs_s *jobs, lv_job_s *list, uint32_t count, lv_job_counter_s *counter)
+{
+	atomic_fetch_add_explicit(&counter->pending, (int) count, memory_order_relaxed);
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		lv_job_s *job = &list[i];
+		job->counter = counter;
+
+		int queued = lv_jobs_owner == jobs
+			? lv_job_deque_push(&jobs->deques[lv_jobs_index], job)
+			: lv_job_queue_push(&jobs->submitted, job);
+
+		// out of room, no point in waiting for it
+		if (queued == 0)
+		{
+			lv_job_execute(job);
+		}
+	}
+
+	lv_jobs_wake(jobs);
+}
+
+/*
+ * Submits jobs that may only run on the main thread, like anything
+ * calling GLFW. They are run by lv_jobs_wait() and lv_jobs_run_pending()
+ * on the main thread.
+ */
+void lv_jobs_run_main(lv_jobs_s *jobs, lv_job_s *list, uint32_t count, lv_job_counter_s *counter)
+{
+	atomic_fetch_add_explicit(&counter->pending, (int) count, memory_order_relaxed);
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		list[i].counter = counter;
+		if (lv_job_queue_push(&jobs->main, &list[i]) == 0)
+		{
+			lv_log(LV_LOG_ERROR, "Out of memory queueing a main thread job");
+			atomic_fetch_sub(&counter->pending, 1);
+		}
+	}
+}
+
+/*
+ * Runs the main thread jobs queued so far. Only on the main thread,
+ * meant to be called once per pass of its loop. Returns how many ran.
+ */
+uint32_t lv_jobs_run_pending(lv_jobs_s *jobs)
+{
+	uint32_t count = 0;
+	lv_job_s *job;
+
+	while ((job = lv_job_queue_pop(&jobs->main)) != NULL)
+	{
+		lv_job_execute(job);
+		++count;
+	}
+	return count;
+}
+
+/*
+ * Runs jobs until the counter reaches 0. On the main thread, this
+ * includes the main thread jobs. Other threads that aren't part of the
+ * job system only help with submitted jobs.
+ */
+void lv_jobs_wait(lv_jobs_s *jobs, lv_job_counter_s *counter)
+{
+	int member = lv_jobs_owner == jobs;
+
+	while (atomic_load_explicit(&counter->pending, memory_order_acquire) > 0)
+	{
+		lv_job_s *job = NULL;
+
+		if (member && lv_jobs_index == 0)
+		{
+			job = lv_job_queue_pop(&jobs->main);
+		}
+
+		if (job == NULL)
+		{
+			job = member ? lv_jobs_find(jobs, lv_jobs_index) : lv_job_queue_pop(&jobs->submitted);
+		}
+
+		if (job != NULL)
+		{
+			lv_job_execute(job);
+		}
+		else
+		{
+			sched_yield();
+		}
+	}
+}
+
+/*
+ * The jobs of lv_jobs_parallel_for(), each one a range of the indices.
+ */
+struct lv_jobs_range
+{
+	void   (*fn)(void *arg, uint32_t begin, uint32_t end);
+	void    *arg;
+	uint32_t begin;
+	uint32_t end;
+};
+
+typedef struct lv_jobs_range lv_jobs_range_s;
+
+static void
+lv_jobs_range_run(void *arg)
+{
+	lv_jobs_range_s *range = arg;
+	range->fn(range->arg, range->begin, range->end);
+}
+
+/*
+ * Calls fn(arg, begin, end) for ranges of `batch` indices out of
+ * [0, count), in parallel, and returns when all of them are done.
+ */
+int lv_jobs_parallel_for(lv_jobs_s *jobs, uint32_t count, uint32_t batch,
+		void (*fn)(void *arg, uint32_t begin, uint32_t end), void *arg)
+{
+	if (batch == 0)
+	{
+		batch = 1;
+	}
+
+	uint32_t job_count = (count + batch - 1) / batch;
+	if (job_count <= 1 || jobs == NULL)
+	{
+		fn(arg, 0, count);
+		return 1;
+	}
+
+	lv_job_s        *list   = lv_scratch_alloc(sizeof(lv_job_s) * job_count);
+	lv_jobs_range_s *ranges = lv_scratch_alloc(sizeof(lv_jobs_range_s) * job_count);
+
+	if (list == NULL || ranges == NULL)
+	{
+		lv_scratch_free(ranges);
+		lv_scratch_free(list);
+		return 0;
+	}
+
+	for (uint32_t i = 0; i < job_count; ++i)
+	{
+		ranges[i].fn    = fn;
+		ranges[i].arg   = arg;
+		ranges[i].begin = i * batch;
+		ranges[i].end   = i + 1 == job_count ? count : (i + 1) * batch;
+
+		list[i].fn  = lv_jobs_range_run;
+		list[i].arg = &ranges[i];
+	}
+
+	lv_job_counter_s counter = { 0 };
+	lv_jobs_run(jobs, list, job_count, &counter);
+	lv_jobs_wait(jobs, &counter);
+
+	lv_scratch_free(ranges);
+	lv_scratch_free(list);
+	return 1;
+}
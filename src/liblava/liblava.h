@@ -0,0 +1,955 @@
+#ifndef LIBLAVA_H
+#define LIBLAVA_H
+
+#include <vulkan/vulkan.h>
+#include <stddef.h>            // size_t
+#include <stdint.h>            // uint32_t, uint64_t, ...
+#include <pthread.h>           // pthread_t
+#include <stdatomic.h>         // atomic_int
+
+//
+// liblava keeps its state behind an opaque lv_state_s, created with 
+// lv_create() and released with lv_free(). Everything else in here is
+// either a value type the caller owns or a function on top of Vulkan.
+//
+
+// validation layers and the debug messenger are only compiled in for 
+// debug builds, and even then they are only used when asked for
+#ifndef LV_VALIDATION
+#ifdef NDEBUG
+#define LV_VALIDATION 0
+#else
+#define LV_VALIDATION 1
+#endif
+#endif
+
+#define LV_MAX_OUTPUTS 8
+#define LV_MAX_DAMAGE  16	// rectangles per output and frame, more mean all of it
+#define LV_FRAMES_IN_FLIGHT 2	// submitted frames the next one doesn't wait for
+
+#define LV_SPIRV_MAGIC 0x07230203
+
+#define LV_FNV1A_SEED 0xcbf29ce484222325ULL
+
+#define LV_SPEC_MAX_CONSTANTS 16
+#define LV_SPEC_MAX_DATA      128
+
+#define LV_ARCHIVE_MAGIC     "LVSA"
+#define LV_ARCHIVE_VERSION   1
+#define LV_ARCHIVE_NAME_SIZE 64
+#define LV_ARCHIVE_ALIGN     16
+
+#define LV_MESH_MAGIC       "LVMS"
+#define LV_MESH_VERSION     2
+#define LV_MESH_MAX_STREAMS 4
+#define LV_MESH_MAX_LODS    8		// per submesh, the full detail one included
+#define LV_MESH_ALIGN       64		// of every stream and the index data
+#define LV_MESH_FILE_ALIGN  4096	// of the file size, so all of it can be imported
+
+#define LV_MESHLET_MAX_VERTICES  64
+#define LV_MESHLET_MAX_TRIANGLES 124
+
+#define LV_UPLOAD_FRAMES 3	// slices of an upload buffer, one per frame in flight
+
+#define LV_SCENE_NONE UINT32_MAX	// parent of a root node
+
+// fields of a draw's sort key, from the most significant bits down
+#define LV_DRAW_PASS_BITS     4
+#define LV_DRAW_PIPELINE_BITS 12
+#define LV_DRAW_MATERIAL_BITS 24
+#define LV_DRAW_DEPTH_BITS    24
+
+#define LV_GRAPH_MAX_PASSES    16
+#define LV_GRAPH_MAX_RESOURCES 32
+#define LV_GRAPH_MAX_USES      8	// resources per pass
+
+//
+// ENUMS
+//
+
+enum lv_shader_type
+{
+	LV_SHADER_NONE, // type not specified or unknown
+	LV_SHADER_VERT, // vertex
+	LV_SHADER_TESC, // tessellation control
+	LV_SHADER_TESE, // tessellation evaluation
+	LV_SHADER_GEOM, // geometry
+	LV_SHADER_FRAG, // fragment
+	LV_SHADER_COMP  // compute
+};
+
+typedef enum lv_shader_type lv_shader_type_e;
+
+enum lv_log_level
+{
+	LV_LOG_ERROR,
+	LV_LOG_WARN,
+	LV_LOG_INFO,
+	LV_LOG_DEBUG
+};
+
+typedef enum lv_log_level lv_log_level_e;
+
+/*
+ * When lv_frame_wait() lets the next frame be drawn.
+ */
+enum lv_frame_mode
+{
+	LV_FRAME_CONTINUOUS,	// paced to a target frame rate
+	LV_FRAME_ON_DEMAND,	// only after lv_invalidate()
+	LV_FRAME_BENCHMARK	// unthrottled
+};
+
+typedef enum lv_frame_mode lv_frame_mode_e;
+
+/*
+ * What a vertex stream of a mesh holds, either as floats or quantized
+ * to the second format, see lv_mesh_dequant_s.
+ */
+enum lv_mesh_attribute
+{
+	LV_MESH_POSITION,	// R32G32B32_SFLOAT, R16G16B16A16_UNORM within the bounds
+	LV_MESH_NORMAL,		// R32G32B32_SFLOAT, R8G8_SNORM octahedral
+	LV_MESH_UV		// R32G32_SFLOAT, R16G16_SFLOAT
+};
+
+typedef enum lv_mesh_attribute lv_mesh_attribute_e;
+
+/*
+ * How a render graph pass uses a resource, which decides the pipeline 
+ * stage, access and image layout the graph synchronizes on.
+ */
+enum lv_graph_use
+{
+	LV_USE_NONE,		// not used (before or after the graph)
+	LV_USE_COLOR_ATTACHMENT,	// written as color or resolve attachment
+	LV_USE_DEPTH_ATTACHMENT,	// depth tested and written
+	LV_USE_DEPTH_READ,	// depth tested, read-only
+	LV_USE_SAMPLED,		// sampled in a fragment shader
+	LV_USE_STORAGE_READ,	// read by a compute shader
+	LV_USE_STORAGE_WRITE,	// written by a compute shader
+	LV_USE_TRANSFER_SRC,	// copied from
+	LV_USE_TRANSFER_DST,	// copied or cleared to
+	LV_USE_VERTEX_BUFFER,
+	LV_USE_INDEX_BUFFER,
+	LV_USE_INDIRECT_BUFFER,
+	LV_USE_HOST_READ,	// read back by the CPU
+	LV_USE_PRESENT,		// acquired from or handed to the swapchain
+	LV_USE_COUNT
+};
+
+typedef enum lv_graph_use lv_graph_use_e;
+
+//
+// STRUCTS
+// 
+
+typedef struct lv_state lv_state_s;
+typedef struct lv_snapshot lv_snapshot_s;
+typedef struct lv_jobs lv_jobs_s;
+typedef struct lv_scene lv_scene_s;
+typedef struct lv_shader_cache lv_shader_cache_s;
+typedef struct lv_pipeline_registry lv_pipeline_registry_s;
+
+struct lv_name_set
+{
+	const char* const* names; // same as const char** ?
+	uint32_t           count;
+};
+
+typedef struct lv_name_set lv_name_set_s;
+
+struct lv_queue
+{
+	VkQueue  queue;
+	uint32_t index;
+	float priority;
+	VkSemaphore timeline;	// signalled with submitted by every lv_queue_submit()
+	_Atomic uint64_t submitted;	// value of the last submit, read on any thread
+	_Atomic uint64_t completed;	// highest value known to be reached
+};
+
+typedef struct lv_queue lv_queue_s;
+
+struct lv_image_set
+{
+	VkImage     *images;
+	VkImageView *views;
+	uint32_t     count;
+};
+
+typedef struct lv_image_set lv_image_set_s;
+
+/*
+ * The outcome of rating a physical device for our purposes. If it isn't
+ * `suitable`, `reason` says why; otherwise `score` is the sum of the 
+ * individual scores, which are kept around to explain the choice.
+ */
+struct lv_device_rating
+{
+	VkPhysicalDevice  gpu;
+	char              name[VK_MAX_PHYSICAL_DEVICE_NAME_SIZE];
+	uint8_t           uuid[VK_UUID_SIZE];
+	int               has_uuid;
+	int               suitable;
+	const char       *reason;
+	VkDeviceSize      local_memory;	// largest device local heap, bytes
+	int               gqueue_index;
+	int               pqueue_index;
+	int               score_type;	// device type
+	int               score_memory;	// device local memory
+	int               score_limits;	// image and attachment limits
+	int               score_queues;	// graphics and present share a family
+	int               score;
+};
+
+typedef struct lv_device_rating lv_device_rating_s;
+
+/*
+ * Specialization constants for one shader stage. The values are copied
+ * into `data`, so a specialization can be filled from temporaries.
+ */
+struct lv_specialization
+{
+	VkSpecializationMapEntry entries[LV_SPEC_MAX_CONSTANTS];
+	uint32_t                 count;
+	unsigned char            data[LV_SPEC_MAX_DATA];
+	size_t                   size;
+	VkSpecializationInfo     info;	// filled by lv_shader_stage_create()
+};
+
+typedef struct lv_specialization lv_specialization_s;
+
+struct lv_shader
+{
+	uint32_t         *data;		// SPIR-V bytecode (mapped, NULL once released)
+	size_t            size;		// size of bytecode
+	uint64_t          hash;		// FNV-1a hash of the bytecode
+	lv_shader_type_e  type;		// shader type (vertex, fragment, ...)
+	VkShaderModule    module;	// vulkan shader module 
+	lv_specialization_s spec;	// specialization constants for the stage
+	VkPipelineShaderStageCreateInfo info;
+};
+
+typedef struct lv_shader lv_shader_s;
+
+/*
+ * Shader archive layout, all offsets relative to the start of the file:
+ *
+ *   lv_archive_header_s                     header
+ *   lv_archive_entry_s[count]               table of contents
+ *   uint32_t[bucket_count]                  name hash -> entry index + 1
+ *   uint32_t[bucket_count]                  code hash -> entry index + 1
+ *   SPIR-V blobs, LV_ARCHIVE_ALIGN aligned
+ *
+ * Both bucket tables use linear probing, bucket_count is a power of two
+ * and at least twice the entry count, 0 marks an empty bucket.
+ */
+struct lv_archive_header
+{
+	char      magic[4];		// LV_ARCHIVE_MAGIC
+	uint32_t  version;		// LV_ARCHIVE_VERSION
+	uint32_t  count;		// number of entries
+	uint32_t  bucket_count;		// number of buckets per lookup table
+	uint64_t  size;			// size of the entire archive
+	uint64_t  reserved;
+};
+
+typedef struct lv_archive_header lv_archive_header_s;
+
+struct lv_archive_entry
+{
+	uint64_t  name_hash;		// FNV-1a hash of the name
+	uint64_t  hash;			// FNV-1a hash of the SPIR-V bytecode
+	uint64_t  offset;		// offset of the bytecode
+	uint64_t  size;			// size of the bytecode
+	char      name[LV_ARCHIVE_NAME_SIZE];
+};
+
+typedef struct lv_archive_entry lv_archive_entry_s;
+
+struct lv_shader_archive
+{
+	void                      *map;		// the entire archive file
+	size_t                     size;
+	const lv_archive_header_s *header;
+	const lv_archive_entry_s  *entries;
+	const uint32_t            *name_buckets;
+	const uint32_t            *hash_buckets;
+};
+
+typedef struct lv_shader_archive lv_shader_archive_s;
+
+/*
+ * Mesh file layout, all offsets relative to the start of the file:
+ *
+ *   lv_mesh_header_s                        header
+ *   lv_mesh_submesh_s[submesh_count]        ranges of the index data
+ *   lv_mesh_lod_s[lod_count]                detail levels of the submeshes
+ *   lv_meshlet_s[meshlet_count]             clusters of the detail levels
+ *   vertex streams and index data, LV_MESH_ALIGN aligned
+ *   zeros up to a multiple of LV_MESH_FILE_ALIGN
+ *
+ * Streams and indices are laid out the way they go to the GPU: all of
+ * them lie within [data_offset, data_offset + data_size), which is copied
+ * into a single buffer as it is. The detail levels of a submesh share its
+ * vertices and have index ranges of their own, the first one is the
+ * submesh itself. The index range of every level is split into meshlets.
+ */
+struct lv_mesh_stream
+{
+	uint32_t  attribute;		// lv_mesh_attribute_e
+	uint32_t  format;		// VkFormat
+	uint32_t  stride;
+	uint32_t  reserved;
+	uint64_t  offset;
+};
+
+typedef struct lv_mesh_stream lv_mesh_stream_s;
+
+struct lv_mesh_header
+{
+	char      magic[4];		// LV_MESH_MAGIC
+	uint32_t  version;		// LV_MESH_VERSION
+	uint32_t  vertex_count;
+	uint32_t  index_count;
+	uint32_t  index_type;		// VkIndexType
+	uint32_t  stream_count;
+	uint32_t  submesh_count;
+	uint32_t  lod_count;
+	uint32_t  meshlet_count;
+	uint32_t  reserved;
+	float     min[3];		// bounds of all vertices
+	float     max[3];
+	uint64_t  data_offset;		// of the first stream
+	uint64_t  data_size;		// up to the end of the index data
+	uint64_t  index_offset;
+	uint64_t  size;			// size of the entire file
+	lv_mesh_stream_s streams[LV_MESH_MAX_STREAMS];
+};
+
+typedef struct lv_mesh_header lv_mesh_header_s;
+
+struct lv_mesh_submesh
+{
+	uint32_t  first_index;
+	uint32_t  index_count;
+	uint32_t  first_vertex;		// the range of vertices it uses
+	uint32_t  vertex_count;
+	float     min[3];
+	float     max[3];
+	uint32_t  first_lod;
+	uint32_t  lod_count;		// 0 if it has no detail levels
+};
+
+typedef struct lv_mesh_submesh lv_mesh_submesh_s;
+
+/*
+ * A detail level of a submesh, see lv_lod_select().
+ */
+struct lv_mesh_lod
+{
+	uint32_t  first_index;
+	uint32_t  index_count;
+	uint32_t  first_meshlet;
+	uint32_t  meshlet_count;
+	float     error;		// how far vertices moved, in object space
+	uint32_t  reserved;
+};
+
+typedef struct lv_mesh_lod lv_mesh_lod_s;
+
+/*
+ * A cluster of up to LV_MESHLET_MAX_TRIANGLES triangles on at most
+ * LV_MESHLET_MAX_VERTICES vertices, with the bounds to cull it by: a
+ * sphere around it and a cone around the normals of its triangles.
+ */
+struct lv_meshlet
+{
+	float     center[3];
+	float     radius;
+	float     cone_axis[3];
+	float     cone_cutoff;		// sine of the cone's half angle, 1 if it can't be culled
+	uint32_t  first_index;
+	uint32_t  index_count;
+};
+
+typedef struct lv_meshlet lv_meshlet_s;
+
+/*
+ * A mesh file mapped into memory, see lv_mesh_open().
+ */
+struct lv_mesh_file
+{
+	void                      *map;
+	size_t                     size;
+	const lv_mesh_header_s    *header;
+	const lv_mesh_submesh_s   *submeshes;
+	const lv_mesh_lod_s       *lods;
+	const lv_meshlet_s        *meshlets;
+};
+
+typedef struct lv_mesh_file lv_mesh_file_s;
+
+/*
+ * The vertex input of pipelines drawing a mesh: one binding per stream,
+ * each with one attribute at the location of its lv_mesh_attribute_e.
+ * See lv_mesh_layout() and lv_vertex_layout_set().
+ */
+struct lv_vertex_layout
+{
+	uint32_t                          count;
+	VkVertexInputBindingDescription   bindings[LV_MESH_MAX_STREAMS];
+	VkVertexInputAttributeDescription attributes[LV_MESH_MAX_STREAMS];
+};
+
+typedef struct lv_vertex_layout lv_vertex_layout_s;
+
+/*
+ * Turns quantized positions back into object space, pushed as vertex
+ * shader constants at offset 0 by lv_mesh_bind():
+ *
+ *   layout(push_constant) uniform Mesh { vec4 scale; vec4 offset; };
+ *   vec3 position = offset.xyz + scale.xyz * in_position.xyz;
+ *
+ * Float positions come with a scale of 1 and an offset of 0, so the same
+ * shader reads both. Octahedral normals decode as
+ *
+ *   vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+ *   if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * sign(n.xy);
+ *   n = normalize(n);
+ */
+struct lv_mesh_dequant
+{
+	float     scale[4];
+	float     offset[4];
+};
+
+typedef struct lv_mesh_dequant lv_mesh_dequant_s;
+
+/*
+ * A mesh on the GPU: streams and indices in one device local buffer.
+ */
+struct lv_mesh
+{
+	VkBuffer           buffer;
+	VkDeviceMemory     memory;
+	VkDeviceSize       stream_offsets[LV_MESH_MAX_STREAMS];
+	uint32_t           stream_count;
+	VkDeviceSize       index_offset;
+	VkIndexType        index_type;
+	uint32_t           index_count;
+	uint32_t           vertex_count;
+	lv_mesh_submesh_s *submeshes;
+	uint32_t           submesh_count;
+	lv_mesh_lod_s     *lods;
+	uint32_t           lod_count;
+	lv_meshlet_s      *meshlets;
+	uint32_t           meshlet_count;
+	lv_mesh_dequant_s  dequant;
+	uint64_t           uploaded;	// gqueue value the upload signals
+	VkBuffer           source;	// on the imported file, until lv_mesh_ready()
+	VkDeviceMemory     source_memory;
+};
+
+typedef struct lv_mesh lv_mesh_s;
+
+/*
+ * A buffer written by the CPU every frame, see upload.c.
+ */
+struct lv_upload
+{
+	VkBuffer           buffer;
+	VkDeviceMemory     memory;
+	unsigned char     *map;		// all slices, mapped for good
+	VkDeviceSize       slice_size;
+	uint64_t           used[LV_UPLOAD_FRAMES];	// gqueue value of the last submit reading a slice
+	uint32_t           frame;		// slice being written
+};
+
+typedef struct lv_upload lv_upload_s;
+
+/*
+ * One indexed draw of a submesh, or without a mesh, `vertex_count`
+ * vertices the pipeline makes up on its own. What it binds is told by
+ * the handles, the key only decides the order, see lv_draw_key().
+ */
+struct lv_draw
+{
+	uint64_t           key;
+	VkPipeline         pipeline;
+	VkDescriptorSet    material;	// set 0, VK_NULL_HANDLE to bind none
+	const lv_mesh_s   *mesh;	// NULL to draw without vertex and index buffers
+	uint32_t           submesh;
+	uint32_t           vertex_count;	// without a mesh only
+	uint32_t           instance;	// firstInstance, e.g. a node of a scene
+};
+
+typedef struct lv_draw lv_draw_s;
+
+/*
+ * What sorting the draws saved, as of the last lv_draws_sort() and
+ * lv_draws_record(). Binds are pipelines, materials and meshes bound,
+ * record_ms is of all recordings since the sort.
+ */
+struct lv_draw_stats
+{
+	uint32_t           draws;
+	uint32_t           binds;		// in the order recorded
+	uint32_t           binds_unsorted;	// in the order the draws were added
+	double             sort_ms;
+	double             record_ms;
+};
+
+typedef struct lv_draw_stats lv_draw_stats_s;
+
+/*
+ * The draws of a frame, see draw.c. Set up with lv_draws_init(), then
+ * every frame lv_draws_clear(), lv_draws_add() and lv_draws_sort(). Once
+ * handed to lv_draws_set(), every frame records it to all outputs.
+ */
+struct lv_draw_list
+{
+	lv_draw_s         *draws;
+	uint32_t           count;
+	uint32_t           capacity;
+	uint64_t          *keys;		// twice the capacity, sorted and scratch
+	uint32_t          *order;		// the same, indices into draws
+	VkPipelineLayout   layout;	// for the materials, lv->pipeline_layout if VK_NULL_HANDLE
+	int                unsorted;	// record in the order added, to compare
+	lv_draw_stats_s    stats;
+};
+
+typedef struct lv_draw_list lv_draw_list_s;
+
+/*
+ * A point in time, along with the number of allocations the driver made 
+ * on the calling thread so far. See lv_mark().
+ */
+struct lv_mark
+{
+	double ms;
+	size_t allocations;
+};
+
+typedef struct lv_mark lv_mark_s;
+
+/*
+ * A function running on a thread of its own, for parts of the set up that
+ * don't depend on each other. Use lv_task_start() and lv_task_join().
+ */
+struct lv_task
+{
+	pthread_t    thread;
+	int        (*fn)(void *);
+	void        *arg;
+	int          result;	// return value of fn, valid after joining
+};
+
+typedef struct lv_task lv_task_s;
+
+/*
+ * An image in a render graph. Imported images (`image` set) are owned by
+ * the caller, who says how they were used before the graph and will be
+ * used after it. Transient images (`image` left VK_NULL_HANDLE) are
+ * created by lv_graph_compile() from format, extent and samples, and 
+ * share memory with other transient images that aren't alive at the 
+ * same time.
+ */
+struct lv_graph_image
+{
+	VkImage               image;
+	VkImageView           view;
+	VkImageAspectFlags    aspect;
+	VkFormat              format;	// transient images only
+	VkExtent2D            extent;
+	VkSampleCountFlagBits samples;	// 0 is VK_SAMPLE_COUNT_1_BIT
+	lv_graph_use_e        before;	// imported only, last use before the graph
+	lv_graph_use_e        after;	// imported only, use after the graph
+	int                   preserve;	// imported only, keep the contents from before
+};
+
+typedef struct lv_graph_image lv_graph_image_s;
+
+struct lv_graph_resource
+{
+	const char           *name;
+	int                   is_buffer;
+	lv_graph_image_s      image;
+	VkBuffer              buffer;
+	int                   transient;	// created by lv_graph_compile()
+	VkImageUsageFlags     usage;	// of a transient image, from its uses
+	int                   first;	// first and last live pass using it,
+	int                   last;	// -1 if none
+	int                   block;	// memory shared with other transient images
+	VkDeviceSize          size;
+};
+
+typedef struct lv_graph_resource lv_graph_resource_s;
+
+struct lv_graph_pass
+{
+	const char           *name;
+	void                (*record)(VkCommandBuffer cb, void *user);
+	void                 *user;
+	int                   resources[LV_GRAPH_MAX_USES];
+	lv_graph_use_e        uses[LV_GRAPH_MAX_USES];
+	uint32_t              use_count;
+	int                   live;	// not culled by lv_graph_compile()
+	VkPipelineStageFlags  src_stages;	// of the barriers recorded before the pass
+	VkPipelineStageFlags  dst_stages;
+	uint32_t              first_image_barrier;
+	uint32_t              image_barrier_count;
+	uint32_t              first_buffer_barrier;
+	uint32_t              buffer_barrier_count;
+};
+
+typedef struct lv_graph_pass lv_graph_pass_s;
+
+/*
+ * Passes, in the order they run, and the resources they use. Set up with
+ * lv_graph_image(), lv_graph_buffer(), lv_graph_pass() and lv_graph_use(),
+ * then lv_graph_compile() once and lv_graph_execute() for every command
+ * buffer to record the passes into.
+ */
+struct lv_graph
+{
+	lv_graph_pass_s       passes[LV_GRAPH_MAX_PASSES];
+	uint32_t              pass_count;
+	lv_graph_resource_s   resources[LV_GRAPH_MAX_RESOURCES];
+	uint32_t              resource_count;
+	lv_graph_pass_s       end;	// barriers into the `after` uses
+	VkImageMemoryBarrier *image_barriers;
+	VkBufferMemoryBarrier *buffer_barriers;
+	VkDeviceMemory        memory[LV_GRAPH_MAX_RESOURCES];	// per block
+	uint32_t              block_count;
+	VkDeviceSize          transient_size;	// sum of all transient images
+	VkDeviceSize          allocated_size;	// after aliasing
+};
+
+typedef struct lv_graph lv_graph_s;
+
+/*
+ * Goes down to 0 as the jobs it was handed with are done.
+ */
+struct lv_job_counter
+{
+	atomic_int            pending;
+};
+
+typedef struct lv_job_counter lv_job_counter_s;
+
+struct lv_job
+{
+	void                (*fn)(void *arg);
+	void                 *arg;
+	lv_job_counter_s     *counter;	// set by lv_jobs_run()
+};
+
+typedef struct lv_job lv_job_s;
+
+//
+// CORE (core.c)
+//
+
+lv_state_s *lv_create();
+int lv_free(lv_state_s *lv);
+
+VkInstance lv_get_instance(lv_state_s *lv);
+VkPhysicalDevice lv_get_gpu(lv_state_s *lv);
+VkDevice lv_get_device(lv_state_s *lv);
+lv_jobs_s *lv_get_jobs(lv_state_s *lv);
+
+void lv_log_level(lv_log_level_e level);
+void lv_log(lv_log_level_e level, const char *format, ...);
+
+const VkAllocationCallbacks *lv_allocator();
+void lv_allocator_disable();
+void lv_allocator_free();
+void *lv_scratch_alloc(size_t size);
+void lv_scratch_free(void *ptr);
+void lv_print_allocations();
+
+double lv_time_ms();
+lv_mark_s lv_mark();
+void lv_timings_start(lv_state_s *lv);
+void lv_timings_add(lv_state_s *lv, const char *name, lv_mark_s start);
+double lv_timings_first_frame(lv_state_s *lv);
+void lv_print_timings(lv_state_s *lv);
+
+void lv_task_start(lv_task_s *task, int (*fn)(void *), void *arg);
+int lv_task_join(lv_task_s *task);
+
+//
+// INSTANCE (instance.c, caps.c)
+//
+
+uint32_t lv_instance_version();
+int lv_instance_create(lv_state_s *lv, lv_name_set_s *extensions, lv_name_set_s *layers);
+int lv_validation_enable(lv_state_s *lv);
+int lv_print_extensions();
+int lv_instance_has_extension(const char *name);
+int lv_print_layers();
+int lv_instance_has_layer(const char *name);
+void lv_caps_invalidate_surface(VkSurfaceKHR surface);
+void lv_caps_free();
+
+//
+// DEVICE (device.c)
+//
+
+int lv_device_has_extension(VkPhysicalDevice device, const char *name);
+int lv_device_has_graphics_queue(VkPhysicalDevice device, int *idx);
+int lv_device_has_present_queue(VkPhysicalDevice device, VkSurfaceKHR surface, int *idx);
+VkSurfaceCapabilitiesKHR lv_device_surface_get_capabilities(VkPhysicalDevice device, VkSurfaceKHR surface);
+int lv_device_surface_format_count(VkPhysicalDevice device, VkSurfaceKHR surface);
+int lv_device_surface_has_format(VkPhysicalDevice device, VkSurfaceKHR surface, VkFormat format, VkColorSpaceKHR cspace, int *idx);
+VkSurfaceFormatKHR lv_device_surface_get_format_by_index(VkPhysicalDevice device, VkSurfaceKHR surface, int index);
+int lv_device_surface_present_mode_count(VkPhysicalDevice device, VkSurfaceKHR surface);
+VkPresentModeKHR lv_device_surface_get_present_mode_by_index(VkPhysicalDevice device, VkSurfaceKHR surface, int index);
+int lv_device_surface_has_present_mode(VkPhysicalDevice device, VkSurfaceKHR surface, VkPresentModeKHR mode, int *idx);
+
+void lv_device_name(VkPhysicalDevice device, char *name);
+int lv_print_devices(VkInstance instance);
+int lv_device_score(VkPhysicalDevice device);
+int lv_swapchain_adequate(VkPhysicalDevice device, VkSurfaceKHR surface);
+int lv_device_has_features(VkPhysicalDevice device, const VkPhysicalDeviceFeatures *required);
+void lv_device_rate(VkPhysicalDevice device, VkSurfaceKHR surface, uint32_t api_version,
+		const VkPhysicalDeviceFeatures *required, lv_device_rating_s *rating);
+int lv_device_matches(const lv_device_rating_s *rating, const char *match);
+lv_device_rating_s *lv_device_rate_all(lv_state_s *lv, uint32_t *count);
+int lv_device_select(lv_state_s *lv, const char *match);
+int lv_device_autoselect(lv_state_s *lv);
+int lv_print_device_ratings(lv_state_s *lv);
+int lv_device_memory_type(VkPhysicalDevice device, uint32_t type_bits, VkMemoryPropertyFlags props, uint32_t *index);
+VkFormat lv_device_depth_format(VkPhysicalDevice device);
+int lv_format_has_stencil(VkFormat format);
+VkSampleCountFlagBits lv_device_sample_count(VkPhysicalDevice device, VkSampleCountFlagBits requested);
+void lv_msaa_set(lv_state_s *lv, VkSampleCountFlagBits samples);
+void lv_dynamic_rendering_disable(lv_state_s *lv);
+int lv_dynamic_rendering_enabled(lv_state_s *lv);
+int lv_logical_device_create(lv_state_s *lv, lv_name_set_s *extensions);
+
+//
+// OUTPUTS (swapchain.c)
+//
+
+int lv_create_swapchain(VkPhysicalDevice gpu, VkSurfaceKHR surface, VkDevice device,
+		lv_queue_s *gqueue, lv_queue_s *pqueue, VkSurfaceFormatKHR format, VkSwapchainKHR old, VkSwapchainKHR *swapchain);
+int lv_get_swapchain_images(VkDevice device, VkSwapchainKHR swapchain, lv_image_set_s *images);
+int lv_swapchain_create(lv_state_s *lv);
+int lv_create_framebuffers(lv_state_s *lv);
+
+int lv_output_add(lv_state_s *lv, void *window);
+int lv_output_set_surface(lv_state_s *lv, int index, VkSurfaceKHR surface);
+int lv_output_remove(lv_state_s *lv, int index);
+int lv_output_resize(lv_state_s *lv, int index);
+uint32_t lv_output_count(lv_state_s *lv);
+void *lv_output_window(lv_state_s *lv, int index);
+VkSurfaceKHR lv_output_surface(lv_state_s *lv, int index);
+
+//
+// DAMAGE (damage.c)
+//
+
+int lv_output_track_damage(lv_state_s *lv, int index, int enable);
+int lv_output_damage(lv_state_s *lv, int index, const VkRect2D *rect);
+
+//
+// MESHES (mesh.c)
+//
+
+int lv_mesh_open(const char *path, lv_mesh_file_s *file);
+void lv_mesh_close(lv_mesh_file_s *file);
+int lv_mesh_upload(lv_state_s *lv, const lv_mesh_file_s *file, lv_mesh_s *mesh);
+int lv_mesh_ready(lv_state_s *lv, lv_mesh_s *mesh);
+int lv_mesh_layout(const lv_mesh_header_s *header, lv_vertex_layout_s *layout);
+void lv_mesh_bind(lv_state_s *lv, VkCommandBuffer cb, const lv_mesh_s *mesh);
+void lv_mesh_draw(VkCommandBuffer cb, const lv_mesh_s *mesh, uint32_t submesh);
+uint32_t lv_mesh_draw_culled(VkCommandBuffer cb, const lv_mesh_s *mesh, uint32_t submesh,
+		const float eye[3], const float planes[6][4], float scale, float threshold);
+void lv_mesh_destroy(lv_state_s *lv, lv_mesh_s *mesh);
+
+//
+// CLUSTERS (cluster.c)
+//
+
+uint32_t lv_simplify(lv_jobs_s *jobs, const float *positions, uint32_t first_vertex, uint32_t vertex_count,
+		const uint32_t *indices, uint32_t index_count, float cell, uint32_t *out, float *error);
+uint32_t lv_meshlets_max(uint32_t index_count);
+uint32_t lv_meshlets_build(lv_jobs_s *jobs, const float *positions, const uint32_t *indices,
+		uint32_t first_index, uint32_t index_count, lv_meshlet_s *meshlets);
+float lv_edge_length(const float *positions, const uint32_t *indices, uint32_t index_count);
+uint32_t lv_lod_select(const lv_mesh_lod_s *lods, uint32_t count, float distance, float scale, float threshold);
+int lv_meshlet_visible(const lv_meshlet_s *meshlet, const float eye[3], const float planes[6][4]);
+
+//
+// QUANTIZATION (quantize.c)
+//
+
+void lv_quantize_positions(const float *positions, uint32_t count, const float min[3], const float max[3], uint16_t *out);
+void lv_quantize_normals(const float *normals, uint32_t count, int8_t *out);
+void lv_quantize_uvs(const float *uvs, uint32_t count, uint16_t *out);
+uint16_t lv_half_from_float(float value);
+float lv_half_to_float(uint16_t half);
+
+//
+// UPLOADS (upload.c)
+//
+
+int lv_upload_create(lv_state_s *lv, VkDeviceSize size, VkBufferUsageFlags usage, lv_upload_s *upload);
+void *lv_upload_next(lv_state_s *lv, lv_upload_s *upload);
+VkDeviceSize lv_upload_offset(const lv_upload_s *upload);
+void lv_upload_destroy(lv_state_s *lv, lv_upload_s *upload);
+
+//
+// SCENES (scene.c)
+//
+
+lv_scene_s *lv_scene_create(uint32_t capacity);
+void lv_scene_free(lv_scene_s *scene);
+uint32_t lv_scene_add(lv_scene_s *scene, uint32_t parent);
+uint32_t lv_scene_count(const lv_scene_s *scene);
+void lv_scene_set(lv_scene_s *scene, uint32_t node, const float translation[3], const float rotation[4], const float scale[3]);
+void lv_scene_world(const lv_scene_s *scene, uint32_t node, float matrix[16]);
+uint32_t lv_scene_update(lv_scene_s *scene, lv_jobs_s *jobs, float *out, uint64_t *written);
+
+//
+// DRAWS (draw.c)
+//
+
+uint64_t lv_draw_key(uint32_t pass, uint32_t pipeline, uint32_t material, float depth);
+void lv_draws_init(lv_draw_list_s *list);
+void lv_draws_free(lv_draw_list_s *list);
+void lv_draws_clear(lv_draw_list_s *list);
+int lv_draws_add(lv_draw_list_s *list, const lv_draw_s *draw);
+void lv_draws_sort(lv_draw_list_s *list);
+uint32_t lv_draws_record(lv_state_s *lv, VkCommandBuffer cb, lv_draw_list_s *list);
+void lv_draws_set(lv_state_s *lv, lv_draw_list_s *list);
+
+//
+// SHADERS (shader.c)
+//
+
+uint64_t lv_hash_fnv1a(const void *data, size_t size, uint64_t seed);
+int lv_spirv_valid(const uint32_t *data, size_t size);
+int lv_load_shader_spv(const char* path, lv_shader_s *shader);
+void lv_unload_shader_spv(lv_shader_s *shader);
+int lv_shader_module_create(VkDevice device, lv_shader_cache_s *cache, lv_shader_s *shader);
+void lv_shader_module_release(VkDevice device, lv_shader_cache_s *cache, lv_shader_s *shader);
+void lv_shader_cache_free(VkDevice device, lv_shader_cache_s *cache);
+int lv_specialization_set(lv_specialization_s *spec, uint32_t id, const void *value, size_t size);
+int lv_specialization_set_u32(lv_specialization_s *spec, uint32_t id, uint32_t value);
+int lv_specialization_set_f32(lv_specialization_s *spec, uint32_t id, float value);
+int lv_specialization_set_bool(lv_specialization_s *spec, uint32_t id, int value);
+int lv_shader_stage_create(VkPhysicalDevice gpu, VkDevice device, VkSurfaceKHR surface, lv_shader_s *vert_shader, lv_shader_s *frag_shader);
+int lv_shader_from_file_spv(VkDevice device, lv_shader_cache_s *cache, const char *path, lv_shader_s *shader, lv_shader_type_e type);
+int lv_shader_archive_open(const char *path, lv_shader_archive_s *archive);
+void lv_shader_archive_close(lv_shader_archive_s *archive);
+const lv_archive_entry_s *lv_shader_archive_find(const lv_shader_archive_s *archive, const char *name);
+const lv_archive_entry_s *lv_shader_archive_find_hash(const lv_shader_archive_s *archive, uint64_t hash);
+int lv_shader_from_archive(VkDevice device, lv_shader_cache_s *cache, const lv_shader_archive_s *archive, const char *name, lv_shader_s *shader, lv_shader_type_e type);
+int lv_shaders_from_archive(lv_state_s *lv, const lv_shader_archive_s *archive, const char *vert_name, const char *frag_name);
+int lv_shaders_from_spv(lv_state_s *lv, lv_shader_s *vert_shader, lv_shader_s *frag_shader);
+
+//
+// PIPELINES (pipeline.c)
+//
+
+int lv_renderpass_create(lv_state_s *lv);
+void lv_vertex_layout_set(lv_state_s *lv, const lv_vertex_layout_s *layout);
+int lv_pipeline_build(lv_state_s *lv, const VkPipelineShaderStageCreateInfo *stages, uint32_t stage_count, VkPipeline *pipeline);
+int lv_pipeline_cache_read(const char *path, void **data, size_t *size);
+int lv_pipeline_cache_create(lv_state_s *lv, const void *data, size_t size);
+int lv_pipeline_cache_write(lv_state_s *lv, const char *path);
+uint64_t lv_pipeline_key(const lv_shader_s *shaders, uint32_t count);
+VkPipeline lv_pipeline_registry_find(lv_pipeline_registry_s *registry, uint64_t key);
+int lv_pipeline_registry_insert(lv_pipeline_registry_s *registry, uint64_t key, VkPipeline pipeline);
+VkPipeline lv_pipeline_registry_remove(lv_pipeline_registry_s *registry, uint64_t key);
+void lv_pipeline_registry_free(VkDevice device, lv_pipeline_registry_s *registry);
+int lv_pipeline_get(lv_state_s *lv, lv_shader_s *vert_shader, lv_shader_s *frag_shader, VkPipeline *pipeline);
+int lv_pipeline_create(lv_state_s *lv);
+
+//
+// COMMANDS (commands.c)
+//
+
+int lv_create_commandpool(lv_state_s *lv);
+int lv_create_commandbuffers(lv_state_s *lv);
+int lv_record_commandbuffers(lv_state_s *lv);
+int lv_create_semaphores(lv_state_s *lv);
+int lv_draw_frame(lv_state_s *lv);
+
+//
+// FRAMES (frame.c)
+//
+
+void lv_frame_mode(lv_state_s *lv, lv_frame_mode_e mode, double fps);
+void lv_frame_events(lv_state_s *lv, void (*wait)(double timeout), void (*wake)());
+void lv_invalidate(lv_state_s *lv);
+int lv_frame_wait(lv_state_s *lv);
+
+//
+// RENDER THREAD (render.c)
+//
+
+int lv_render_thread_start(lv_state_s *lv, int (*frame)(lv_state_s *lv, void *user), void *user);
+int lv_render_thread_stop(lv_state_s *lv);
+int lv_render_thread_running(lv_state_s *lv);
+lv_snapshot_s *lv_snapshot_create(size_t size, const void *initial);
+void lv_snapshot_publish(lv_snapshot_s *snap, const void *data);
+const void *lv_snapshot_read(lv_snapshot_s *snap, int *fresh);
+void lv_snapshot_free(lv_snapshot_s *snap);
+
+//
+// JOBS (jobs.c)
+//
+
+lv_jobs_s *lv_jobs_create(uint32_t workers);
+void lv_jobs_free(lv_jobs_s *jobs);
+uint32_t lv_jobs_threads(lv_jobs_s *jobs);
+void lv_jobs_run(lv_jobs_s *jobs, lv_job_s *list, uint32_t count, lv_job_counter_s *counter);
+void lv_jobs_run_main(lv_jobs_s *jobs, lv_job_s *list, uint32_t count, lv_job_counter_s *counter);
+uint32_t lv_jobs_run_pending(lv_jobs_s *jobs);
+void lv_jobs_wait(lv_jobs_s *jobs, lv_job_counter_s *counter);
+int lv_jobs_parallel_for(lv_jobs_s *jobs, uint32_t count, uint32_t batch,
+		void (*fn)(void *arg, uint32_t begin, uint32_t end), void *arg);
+
+//
+// SYNC (sync.c)
+//
+
+int lv_timeline_create(lv_state_s *lv, lv_queue_s *queue);
+void lv_timeline_destroy(lv_state_s *lv, lv_queue_s *queue);
+uint64_t lv_queue_submit(lv_state_s *lv, lv_queue_s *queue, const VkSubmitInfo *submit,
+		const lv_queue_s *after, uint64_t after_value);
+uint64_t lv_timeline_completed(lv_state_s *lv, lv_queue_s *queue);
+int lv_timeline_reached(lv_state_s *lv, lv_queue_s *queue, uint64_t value);
+int lv_timeline_wait(lv_state_s *lv, lv_queue_s *queue, uint64_t value, uint64_t timeout);
+int lv_retire(lv_state_s *lv, VkObjectType type, uint64_t handle);
+uint32_t lv_retire_collect(lv_state_s *lv);
+
+//
+// RENDER GRAPH (graph.c)
+//
+
+void lv_graph_init(lv_graph_s *graph);
+int lv_graph_image(lv_graph_s *graph, const char *name, const lv_graph_image_s *image);
+int lv_graph_buffer(lv_graph_s *graph, const char *name, VkBuffer buffer, lv_graph_use_e before, lv_graph_use_e after);
+int lv_graph_pass(lv_graph_s *graph, const char *name, void (*record)(VkCommandBuffer, void *), void *user);
+int lv_graph_use(lv_graph_s *graph, int pass, int resource, lv_graph_use_e use);
+int lv_graph_compile(lv_state_s *lv, lv_graph_s *graph);
+VkImageView lv_graph_view(lv_graph_s *graph, int resource);
+void lv_graph_execute(lv_graph_s *graph, VkCommandBuffer cb);
+void lv_print_graph(lv_graph_s *graph);
+void lv_graph_free(lv_state_s *lv, lv_graph_s *graph);
+
+//
+// HOT-RELOAD (hotreload.c)
+//
+
+int lv_hotreload_start(lv_state_s *lv, const char *vert_path, const char *frag_path);
+int lv_hotreload_apply(lv_state_s *lv);
+void lv_hotreload_stop(lv_state_s *lv);
+
+#endif
@@ -0,0 +1,588 @@
+#include <sys/mman.h>          // mmap(), munmap(), madvise()
+#include <sys/stat.h>          // fstat(), struct stat
+#include <fcntl.h>             // open()
+#include <unistd.h>            // close()
+
+#include <math.h>              // sqrtf()
+
+#include "internal.h"
+
+//
+// Meshes in the binary format written by lvmesh, see lv_mesh_header_s.
+// Opening one is a single mmap() and a check of the header, there is
+// nothing to parse: the streams and indices are stored the way the GPU
+// reads them, in one block that is copied into one buffer as it is.
+//
+// With VK_EXT_external_memory_host, the mapping itself is imported as
+// the source of that copy, so the data goes from the page cache to the
+// GPU without being touched by the CPU. Otherwise it is copied once,
+// straight from the mapping into a staging buffer.
+//
+// Streams are either floats or quantized, see lv_mesh_attribute_e; the
+// vertex input of the pipelines has to match, see lv_mesh_layout().
+//
+
+/*
+ * Maps a mesh file into memory and checks that every range in it lies
+ * within the file. Only reads the header and the tables after it.
+ */
+int lv_mesh_open(const char *path, lv_mesh_file_s *file)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd == -1)
+	{
+		return 0;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) == -1 || st.st_size < (off_t) sizeof(lv_mesh_header_s))
+	{
+		close(fd);
+		return 0;
+	}
+
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (map == MAP_FAILED)
+	{
+		return 0;
+	}
+
+	const lv_mesh_header_s *header = map;
+	size_t size = st.st_size;
+
+	size_t table_end = sizeof(lv_mesh_header_s)
+			+ (size_t) header->submesh_count * sizeof(lv_mesh_submesh_s)
+			+ (size_t) header->lod_count * sizeof(lv_mesh_lod_s)
+			+ (size_t) header->meshlet_count * sizeof(lv_meshlet_s);
+	uint64_t data_end = header->data_offset + header->data_size;
+	uint64_t index_size = header->index_type == VK_INDEX_TYPE_UINT16 ? 2 : 4;
+
+	int valid = memcmp(header->magic, LV_MESH_MAGIC, 4) == 0 &&
+			header->version == LV_MESH_VERSION &&
+			header->size == size &&
+			header->stream_count <= LV_MESH_MAX_STREAMS &&
+			(header->index_type == VK_INDEX_TYPE_UINT16 || header->index_type == VK_INDEX_TYPE_UINT32) &&
+			table_end <= header->data_offset &&
+			header->data_offset % LV_MESH_ALIGN == 0 &&
+			header->data_size <= size && header->data_offset <= size - header->data_size &&
+			header->index_offset % LV_MESH_ALIGN == 0 &&
+			header->index_offset >= header->data_offset &&
+			header->index_offset + header->index_count * index_size <= data_end;
+
+	for (uint32_t i = 0; valid && i < header->stream_count; ++i)
+	{
+		const lv_mesh_stream_s *stream = &header->streams[i];
+		valid = stream->offset % LV_MESH_ALIGN == 0 &&
+				stream->offset >= header->data_offset &&
+				stream->offset + (uint64_t) stream->stride * header->vertex_count <= data_end;
+	}
+
+	const lv_mesh_submesh_s *submeshes = (const lv_mesh_submesh_s *) (header + 1);
+	const lv_mesh_lod_s *lods = (const lv_mesh_lod_s *) (submeshes + header->submesh_count);
+	const lv_meshlet_s *meshlets = (const lv_meshlet_s *) (lods + header->lod_count);
+
+	for (uint32_t i = 0; valid && i < header->submesh_count; ++i)
+	{
+		valid = (uint64_t) submeshes[i].first_index + submeshes[i].index_count <= header->index_count &&
+				(uint64_t) submeshes[i].first_vertex + submeshes[i].vertex_count <= header->vertex_count &&
+				(uint64_t) submeshes[i].first_lod + submeshes[i].lod_count <= header->lod_count;
+	}
+
+	for (uint32_t i = 0; valid && i < header->lod_count; ++i)
+	{
+		valid = (uint64_t) lods[i].first_index + lods[i].index_count <= header->index_count &&
+				(uint64_t) lods[i].first_meshlet + lods[i].meshlet_count <= header->meshlet_count;
+	}
+
+	for (uint32_t i = 0; valid && i < header->meshlet_count; ++i)
+	{
+		valid = (uint64_t) meshlets[i].first_index + meshlets[i].index_count <= header->index_count;
+	}
+
+	if (valid == 0)
+	{
+		munmap(map, size);
+		return 0;
+	}
+
+	// all of it is about to be read, start paging it in
+	madvise(map, size, MADV_WILLNEED);
+
+	file->map       = map;
+	file->size      = size;
+	file->header    = header;
+	file->submeshes = submeshes;
+	file->lods      = lods;
+	file->meshlets  = meshlets;
+
+	return 1;
+}
+
+/*
+ * Unmaps the file. If it was uploaded, not before lv_mesh_ready() says
+ * the upload is done, the GPU may be reading from the mapping, and
+ * memory imported from it must be freed before.
+ */
+void lv_mesh_close(lv_mesh_file_s *file)
+{
+	if (file->map != NULL)
+	{
+		munmap(file->map, file->size);
+	}
+	memset(file, 0, sizeof(lv_mesh_file_s));
+}
+
+/*
+ * Imports the whole mapping as host memory and creates a transfer source
+ * buffer on it. Returns 0 if the device can't, which is no error.
+ */
+static int
+lv_mesh_import(lv_state_s *lv, const lv_mesh_file_s *file, VkBuffer *buffer, VkDeviceMemory *memory)
+{
+	VkDeviceSize align = lv->host_pointer_alignment;
+	if (lv->external_memory_host == 0 || align == 0 || (uintptr_t) file->map % align != 0 || file->size % align != 0)
+	{
+		return 0;
+	}
+
+	VkMemoryHostPointerPropertiesEXT host = { 0 };
+	host.sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT;
+
+	if (lv->get_host_pointer_properties(lv->device, VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT,
+				file->map, &host) != VK_SUCCESS)
+	{
+		return 0;
+	}
+
+	VkExternalMemoryBufferCreateInfo external = { 0 };
+	external.sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO;
+	external.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+
+	VkBufferCreateInfo info = { 0 };
+	info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	info.pNext = &external;
+	info.size  = file->size;
+	info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(lv->device, &info, lv_allocator(), buffer) != VK_SUCCESS)
+	{
+		return 0;
+	}
+
+	VkMemoryRequirements req;
+	vkGetBufferMemoryRequirements(lv->device, *buffer, &req);
+
+	VkImportMemoryHostPointerInfoEXT import = { 0 };
+	import.sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT;
+	import.handleType   = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+	import.pHostPointer = file->map;
+
+	VkMemoryAllocateInfo alloc = { 0 };
+	alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	alloc.pNext = &import;
+	alloc.allocationSize = file->size;
+
+	if (lv_device_memory_type(lv->gpu, req.memoryTypeBits & host.memoryTypeBits, 0, &alloc.memoryTypeIndex) == 0 ||
+			vkAllocateMemory(lv->device, &alloc, lv_allocator(), memory) != VK_SUCCESS)
+	{
+		vkDestroyBuffer(lv->device, *buffer, lv_allocator());
+		*buffer = VK_NULL_HANDLE;
+		return 0;
+	}
+
+	if (vkBindBufferMemory(lv->device, *buffer, *memory, 0) != VK_SUCCESS)
+	{
+		vkFreeMemory(lv->device, *memory, lv_allocator());
+		vkDestroyBuffer(lv->device, *buffer, lv_allocator());
+		*buffer = VK_NULL_HANDLE;
+		*memory = VK_NULL_HANDLE;
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * Creates a staging buffer holding the data of the mesh, copied straight
+ * out of the mapping.
+ */
+static int
+lv_mesh_stage(lv_state_s *lv, const lv_mesh_file_s *file, VkBuffer *buffer, VkDeviceMemory *memory)
+{
+	const lv_mesh_header_s *header = file->header;
+
+	if (lv_buffer_create(lv, header->data_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer, memory) == 0)
+	{
+		return 0;
+	}
+
+	void *data;
+	if (vkMapMemory(lv->device, *memory, 0, header->data_size, 0, &data) != VK_SUCCESS)
+	{
+		vkFreeMemory(lv->device, *memory, lv_allocator());
+		vkDestroyBuffer(lv->device, *buffer, lv_allocator());
+		return 0;
+	}
+
+	memcpy(data, (const char *) file->map + header->data_offset, header->data_size);
+	vkUnmapMemory(lv->device, *memory);
+	return 1;
+}
+
+/*
+ * Records and submits the copy into the mesh buffer, then hands the
+ * source buffer and the command pool to the retire queue. The command
+ * buffer comes from a transient pool of its own, the outputs' pool is
+ * reset by hot reload on the thread that draws.
+ */
+static int
+lv_mesh_copy(lv_state_s *lv, lv_mesh_s *mesh, VkBuffer src, VkDeviceSize src_offset, VkDeviceSize size)
+{
+	VkCommandPoolCreateInfo pool_info = { 0 };
+	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_info.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	pool_info.queueFamilyIndex = lv->gqueue.index;
+
+	VkCommandPool pool;
+	if (vkCreateCommandPool(lv->device, &pool_info, lv_allocator(), &pool) != VK_SUCCESS)
+	{
+		return 0;
+	}
+
+	VkCommandBufferAllocateInfo info = { 0 };
+	info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	info.commandPool        = pool;
+	info.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	info.commandBufferCount = 1;
+
+	VkCommandBuffer cb;
+	if (vkAllocateCommandBuffers(lv->device, &info, &cb) != VK_SUCCESS)
+	{
+		vkDestroyCommandPool(lv->device, pool, lv_allocator());
+		return 0;
+	}
+
+	VkCommandBufferBeginInfo begin = { 0 };
+	begin.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(cb, &begin);
+
+	VkBufferCopy region = { src_offset, 0, size };
+	vkCmdCopyBuffer(cb, src, mesh->buffer, 1, &region);
+
+	// draws submitted later on the same queue see the data
+	VkBufferMemoryBarrier barrier = { 0 };
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = mesh->buffer;
+	barrier.size   = VK_WHOLE_SIZE;
+
+	vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+			0, 0, NULL, 1, &barrier, 0, NULL);
+
+	int ok = vkEndCommandBuffer(cb) == VK_SUCCESS;
+
+	VkSubmitInfo submit = { 0 };
+	submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit.commandBufferCount = 1;
+	submit.pCommandBuffers    = &cb;
+
+	mesh->uploaded = ok ? lv_queue_submit(lv, &lv->gqueue, &submit, NULL, 0) : 0;
+
+	// the command buffer goes with its pool
+	lv_retire(lv, VK_OBJECT_TYPE_COMMAND_POOL, (uint64_t) pool);
+	return mesh->uploaded != 0;
+}
+
+/*
+ * Creates the GPU side of a mesh file: one device local buffer with its
+ * streams and indices, filled by a copy on the graphics queue. Doesn't
+ * wait for the copy, draws submitted afterwards come after it anyway;
+ * the file has to stay open until lv_mesh_ready().
+ */
+int lv_mesh_upload(lv_state_s *lv, const lv_mesh_file_s *file, lv_mesh_s *mesh)
+{
+	const lv_mesh_header_s *header = file->header;
+	memset(mesh, 0, sizeof(lv_mesh_s));
+
+	// the tables are small next to the data, the file doesn't have to stay
+	mesh->submeshes = malloc(sizeof(lv_mesh_submesh_s) * header->submesh_count);
+	mesh->lods      = malloc(sizeof(lv_mesh_lod_s) * header->lod_count);
+	mesh->meshlets  = malloc(sizeof(lv_meshlet_s) * header->meshlet_count);
+
+	if ((mesh->submeshes == NULL && header->submesh_count > 0) ||
+			(mesh->lods == NULL && header->lod_count > 0) ||
+			(mesh->meshlets == NULL && header->meshlet_count > 0))
+	{
+		lv_mesh_destroy(lv, mesh);
+		return 0;
+	}
+
+	memcpy(mesh->submeshes, file->submeshes, sizeof(lv_mesh_submesh_s) * header->submesh_count);
+	memcpy(mesh->lods, file->lods, sizeof(lv_mesh_lod_s) * header->lod_count);
+	memcpy(mesh->meshlets, file->meshlets, sizeof(lv_meshlet_s) * header->meshlet_count);
+	mesh->submesh_count = header->submesh_count;
+	mesh->lod_count     = header->lod_count;
+	mesh->meshlet_count = header->meshlet_count;
+	mesh->stream_count  = header->stream_count;
+	mesh->vertex_count  = header->vertex_count;
+	mesh->index_count   = header->index_count;
+	mesh->index_type    = header->index_type;
+	mesh->index_offset  = header->index_offset - header->data_offset;
+
+	for (int k = 0; k < 3; ++k)
+	{
+		mesh->dequant.scale[k] = 1.0f;
+	}
+
+	for (uint32_t i = 0; i < header->stream_count; ++i)
+	{
+		mesh->stream_offsets[i] = header->streams[i].offset - header->data_offset;
+
+		// unorm positions span the bounds
+		if (header->streams[i].attribute == LV_MESH_POSITION && header->streams[i].format == VK_FORMAT_R16G16B16A16_UNORM)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				mesh->dequant.scale[k]  = header->max[k] - header->min[k];
+				mesh->dequant.offset[k] = header->min[k];
+			}
+		}
+	}
+
+	if (lv_buffer_create(lv, header->data_size,
+				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &mesh->buffer, &mesh->memory) == 0)
+	{
+		lv_mesh_destroy(lv, mesh);
+		return 0;
+	}
+
+	VkBuffer src;
+	VkDeviceMemory src_memory;
+	VkDeviceSize src_offset = header->data_offset;
+	int imported = lv_mesh_import(lv, file, &src, &src_memory);
+
+	if (imported == 0)
+	{
+		src_offset = 0;
+		if (lv_mesh_stage(lv, file, &src, &src_memory) == 0)
+		{
+			lv_mesh_destroy(lv, mesh);
+			return 0;
+		}
+	}
+
+	int ok = lv_mesh_copy(lv, mesh, src, src_offset, header->data_size);
+
+	if (imported)
+	{
+		// lives on the mapping, so it isn't left to the retire queue:
+		// the file may be closed right after lv_mesh_ready()
+		mesh->source        = src;
+		mesh->source_memory = src_memory;
+	}
+	else
+	{
+		// the buffer goes before its memory
+		lv_retire(lv, VK_OBJECT_TYPE_BUFFER, (uint64_t) src);
+		lv_retire(lv, VK_OBJECT_TYPE_DEVICE_MEMORY, (uint64_t) src_memory);
+	}
+
+	if (ok == 0)
+	{
+		lv_mesh_destroy(lv, mesh);
+		return 0;
+	}
+
+	lv_log(LV_LOG_DEBUG, "Mesh of %u vertices, %u indices %s", header->vertex_count, header->index_count,
+			imported ? "imported" : "staged");
+	return 1;
+}
+
+/*
+ * Frees the buffer and memory imported from the file once the copy out
+ * of them is done, or failed to be submitted.
+ */
+static void
+lv_mesh_free_source(lv_state_s *lv, lv_mesh_s *mesh)
+{
+	vkDestroyBuffer(lv->device, mesh->source, lv_allocator());
+	vkFreeMemory(lv->device, mesh->source_memory, lv_allocator());
+	mesh->source        = VK_NULL_HANDLE;
+	mesh->source_memory = VK_NULL_HANDLE;
+}
+
+/*
+ * Returns 1 once the upload of the mesh is done and nothing refers to
+ * the file anymore, so it can be closed.
+ */
+int lv_mesh_ready(lv_state_s *lv, lv_mesh_s *mesh)
+{
+	if (lv_timeline_reached(lv, &lv->gqueue, mesh->uploaded) == 0)
+	{
+		return 0;
+	}
+
+	if (mesh->source_memory != VK_NULL_HANDLE)
+	{
+		lv_mesh_free_source(lv, mesh);
+	}
+	return 1;
+}
+
+/*
+ * Describes the vertex input for the streams of a mesh, for
+ * lv_vertex_layout_set(). Fails on streams of unknown attributes.
+ */
+int lv_mesh_layout(const lv_mesh_header_s *header, lv_vertex_layout_s *layout)
+{
+	memset(layout, 0, sizeof(lv_vertex_layout_s));
+
+	for (uint32_t i = 0; i < header->stream_count && i < LV_MESH_MAX_STREAMS; ++i)
+	{
+		const lv_mesh_stream_s *stream = &header->streams[i];
+		if (stream->attribute > LV_MESH_UV)
+		{
+			return 0;
+		}
+
+		layout->bindings[i].binding   = i;
+		layout->bindings[i].stride    = stream->stride;
+		layout->bindings[i].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		layout->attributes[i].location = stream->attribute;
+		layout->attributes[i].binding  = i;
+		layout->attributes[i].format   = stream->format;
+		layout->attributes[i].offset   = 0;
+	}
+
+	layout->count = header->stream_count;
+	return 1;
+}
+
+/*
+ * Binds the streams of the mesh to the bindings of the same number, and
+ * its indices, and pushes its lv_mesh_dequant_s.
+ */
+void lv_mesh_bind(lv_state_s *lv, VkCommandBuffer cb, const lv_mesh_s *mesh)
+{
+	VkBuffer buffers[LV_MESH_MAX_STREAMS];
+	for (uint32_t i = 0; i < mesh->stream_count; ++i)
+	{
+		buffers[i] = mesh->buffer;
+	}
+
+	if (mesh->stream_count > 0)
+	{
+		vkCmdBindVertexBuffers(cb, 0, mesh->stream_count, buffers, mesh->stream_offsets);
+	}
+	vkCmdBindIndexBuffer(cb, mesh->buffer, mesh->index_offset, mesh->index_type);
+	vkCmdPushConstants(cb, lv->pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(lv_mesh_dequant_s), &mesh->dequant);
+}
+
+/*
+ * Draws one submesh of a bound mesh.
+ */
+void lv_mesh_draw(VkCommandBuffer cb, const lv_mesh_s *mesh, uint32_t submesh)
+{
+	if (submesh < mesh->submesh_count)
+	{
+		vkCmdDrawIndexed(cb, mesh->submeshes[submesh].index_count, 1, mesh->submeshes[submesh].first_index, 0, 0);
+	}
+}
+
+/*
+ * Draws one submesh of a bound mesh at the detail level that fits its
+ * size on screen, see lv_lod_select(), and only the meshlets of it that
+ * lv_meshlet_visible() from `eye`. Meshlets next to each other in the
+ * index data are drawn together. Draws the whole submesh if it has no
+ * detail levels. Returns how many meshlets were drawn.
+ */
+uint32_t lv_mesh_draw_culled(VkCommandBuffer cb, const lv_mesh_s *mesh, uint32_t submesh,
+		const float eye[3], const float planes[6][4], float scale, float threshold)
+{
+	if (submesh >= mesh->submesh_count)
+	{
+		return 0;
+	}
+
+	const lv_mesh_submesh_s *sub = &mesh->submeshes[submesh];
+	if (sub->lod_count == 0)
+	{
+		lv_mesh_draw(cb, mesh, submesh);
+		return 0;
+	}
+
+	float center[3], radius = 0.0f, distance = 0.0f;
+	for (int k = 0; k < 3; ++k)
+	{
+		float half = (sub->max[k] - sub->min[k]) * 0.5f;
+		center[k] = sub->min[k] + half;
+		radius   += half * half;
+		distance += (center[k] - eye[k]) * (center[k] - eye[k]);
+	}
+
+	// to the nearest point of the bounds, roughly
+	distance = sqrtf(distance) - sqrtf(radius);
+
+	const lv_mesh_lod_s *lod = &mesh->lods[sub->first_lod
+		+ lv_lod_select(&mesh->lods[sub->first_lod], sub->lod_count, distance, scale, threshold)];
+
+	uint32_t drawn = 0;
+	uint32_t first = 0, count = 0;
+
+	for (uint32_t i = 0; i < lod->meshlet_count; ++i)
+	{
+		const lv_meshlet_s *m = &mesh->meshlets[lod->first_meshlet + i];
+		if (lv_meshlet_visible(m, eye, planes) == 0)
+		{
+			continue;
+		}
+
+		if (count > 0 && first + count != m->first_index)
+		{
+			vkCmdDrawIndexed(cb, count, 1, first, 0, 0);
+			count = 0;
+		}
+
+		first = count == 0 ? m->first_index : first;
+		count += m->index_count;
+		++drawn;
+	}
+
+	if (count > 0)
+	{
+		vkCmdDrawIndexed(cb, count, 1, first, 0, 0);
+	}
+
+	return drawn;
+}
+
+/*
+ * Retires the buffer and memory of the mesh, so it can be destroyed
+ * while frames drawing it are still in flight. Waits for the upload if
+ * lv_mesh_ready() hasn't seen it done yet and it was imported.
+ */
+void lv_mesh_destroy(lv_state_s *lv, lv_mesh_s *mesh)
+{
+	if (mesh->source_memory != VK_NULL_HANDLE)
+	{
+		lv_timeline_wait(lv, &lv->gqueue, mesh->uploaded, UINT64_MAX);
+		lv_mesh_free_source(lv, mesh);
+	}
+
+	lv_retire(lv, VK_OBJECT_TYPE_BUFFER, (uint64_t) mesh->buffer);
+	lv_retire(lv, VK_OBJECT_TYPE_DEVICE_MEMORY, (uint64_t) mesh->memory);
+	free(mesh->meshlets);
+	free(mesh->lods);
+	free(mesh->submeshes);
+	memset(mesh, 0, sizeof(lv_mesh_s));
+}
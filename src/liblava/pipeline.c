@@ -0,0 +1,597 @@
+#include <sys/stat.h>          // fstat(), struct stat
+#include <fcntl.h>             // open()
+#include <unistd.h>            // close(), read()
+
+#include "internal.h"
+
+// https://vulkan-tutorial.com/en/Drawing_a_triangle/Graphics_pipeline_basics/Render_passes
+/*
+ * Creates a render pass; `presented` is the layout the presented image 
+ * comes in, UNDEFINED if its contents can be thrown away.
+ */
+static int
+lv_renderpass_build(lv_state_s *lv, VkImageLayout presented, VkRenderPass *render_pass)
+{
+	// picked along with the first swapchain, shared by all outputs
+	VkSurfaceFormatKHR format = lv->format;
+
+	int msaa  = lv->samples > VK_SAMPLE_COUNT_1_BIT;
+	int depth = lv->depth_format != VK_FORMAT_UNDEFINED;
+
+	// color, depth and the resolve target, if there are any; everything 
+	// but the presented image is transient and not stored
+	VkAttachmentDescription attachments[3] = { 0 };
+	uint32_t count = 0;
+
+	VkAttachmentDescription *colorAttachment = &attachments[count++];
+	colorAttachment->format         = format.format;
+	colorAttachment->samples        = lv->samples;
+	colorAttachment->loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	colorAttachment->storeOp        = msaa ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachment->stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	colorAttachment->stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	colorAttachment->initialLayout  = msaa ? VK_IMAGE_LAYOUT_UNDEFINED : presented;
+	colorAttachment->finalLayout    = msaa ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+	VkAttachmentReference colorAttachmentRef = { 0 };
+	colorAttachmentRef.attachment = 0;
+	colorAttachmentRef.layout     = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference depthAttachmentRef = { 0 };
+	if (depth)
+	{
+		VkAttachmentDescription *depthAttachment = &attachments[count];
+		depthAttachment->format         = lv->depth_format;
+		depthAttachment->samples        = lv->samples;
+		depthAttachment->loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		depthAttachment->storeOp        = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		depthAttachment->stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		depthAttachment->stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		depthAttachment->initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
+		depthAttachment->finalLayout    = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+		depthAttachmentRef.attachment = count++;
+		depthAttachmentRef.layout     = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	}
+
+	VkAttachmentReference resolveAttachmentRef = { 0 };
+	if (msaa)
+	{
+		VkAttachmentDescription *resolveAttachment = &attachments[count];
+		resolveAttachment->format         = format.format;
+		resolveAttachment->samples        = VK_SAMPLE_COUNT_1_BIT;
+		resolveAttachment->loadOp         = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		resolveAttachment->storeOp        = VK_ATTACHMENT_STORE_OP_STORE;
+		resolveAttachment->stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		resolveAttachment->stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		resolveAttachment->initialLayout  = presented;
+		resolveAttachment->finalLayout    = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+		resolveAttachmentRef.attachment = count++;
+		resolveAttachmentRef.layout     = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	}
+
+	// resolves at the end of the subpass, the multisampled image never
+	// has to be written out
+	VkSubpassDescription subpass = { 0 };
+	subpass.pipelineBindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount    = 1;
+	subpass.pColorAttachments       = &colorAttachmentRef;
+	subpass.pDepthStencilAttachment = depth ? &depthAttachmentRef : NULL;
+	subpass.pResolveAttachments     = msaa ? &resolveAttachmentRef : NULL;
+
+	// the depth buffer is shared by consecutive frames, so clearing it
+	// has to wait for the depth writes of the previous one
+	VkSubpassDependency dependency = { 0 };
+	dependency.srcSubpass    = VK_SUBPASS_EXTERNAL;
+	dependency.dstSubpass    = 0;
+	dependency.srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependency.srcAccessMask = 0;
+	dependency.dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+	if (depth)
+	{
+		dependency.srcStageMask  |= VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependency.srcAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		dependency.dstStageMask  |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+		dependency.dstAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	}
+
+	VkRenderPassCreateInfo renderPassInfo = { 0 };
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = count;
+	renderPassInfo.pAttachments    = attachments;
+	renderPassInfo.subpassCount    = 1;
+	renderPassInfo.pSubpasses      = &subpass;
+	renderPassInfo.dependencyCount = 1;
+	renderPassInfo.pDependencies   = &dependency;
+
+	return vkCreateRenderPass(lv->device, &renderPassInfo, lv_allocator(), render_pass) == VK_SUCCESS;
+}
+
+/*
+ * Creates the render passes, unless the device renders dynamically and 
+ * doesn't need them. The second one keeps what the presented image had 
+ * outside the render area, for drawing nothing but the damage; both are
+ * compatible, so they share framebuffers and pipelines.
+ */
+int lv_renderpass_create(lv_state_s *lv)
+{
+	if (lv->dynamic_rendering)
+	{
+		return 1;
+	}
+
+	return lv_renderpass_build(lv, VK_IMAGE_LAYOUT_UNDEFINED, &lv->render_pass)
+		&& lv_renderpass_build(lv, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, &lv->render_pass_preserve);
+}
+
+// https://vulkan-tutorial.com/en/Drawing_a_triangle/Graphics_pipeline_basics/Fixed_functions
+/*
+ * Builds a graphics pipeline from the given shader stages, using the
+ * pipeline layout and render pass (or, with dynamic rendering, the 
+ * attachment formats) already present in `lv`. Only reads from `lv`, 
+ * so it can run on a thread other than the render thread.
+ */
+int lv_pipeline_build(lv_state_s *lv, const VkPipelineShaderStageCreateInfo *stages, uint32_t stage_count, VkPipeline *pipeline)
+{
+	// describes the format of the vertex data that will be passed to 
+	// the vertex shader
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo = { 0 };
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount   = lv->vertex_layout.count;
+	vertexInputInfo.pVertexBindingDescriptions      = lv->vertex_layout.bindings;
+	vertexInputInfo.vertexAttributeDescriptionCount = lv->vertex_layout.count;
+	vertexInputInfo.pVertexAttributeDescriptions    = lv->vertex_layout.attributes;
+
+	// describes two things: what kind of geometry will be drawn from
+	// the vertices and if primitive restart should be enabled
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = { 0 };
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology               = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	// A viewport basically describes the region of the framebuffer that 
+	// the output will be rendered to, scissor rectangles define in which
+	// regions pixels will actually be stored. Both are dynamic state, set
+	// when recording, so one pipeline serves outputs of any size.
+	VkPipelineViewportStateCreateInfo viewportState = { 0 };
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount  = 1;
+
+	// The rasterizer takes the geometry that is shaped by the vertices 
+	// from the vertex shader and turns it into fragments to be colored 
+	// by the fragment shader
+	VkPipelineRasterizationStateCreateInfo rasterizer = { 0 };
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.depthClampEnable        = VK_FALSE;
+	rasterizer.rasterizerDiscardEnable = VK_FALSE;
+	rasterizer.polygonMode             = VK_POLYGON_MODE_FILL;
+	rasterizer.lineWidth               = 1.0f;
+	rasterizer.cullMode                = VK_CULL_MODE_BACK_BIT;
+	rasterizer.frontFace               = VK_FRONT_FACE_CLOCKWISE;
+	rasterizer.depthBiasEnable         = VK_FALSE;
+
+	// multisampling, which is one of the ways to perform anti-aliasing. 
+	// It works by combining the fragment shader results of multiple 
+	// polygons that rasterize to the same pixel.
+	VkPipelineMultisampleStateCreateInfo multisampling = { 0 };
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.sampleShadingEnable  = VK_FALSE;
+	multisampling.rasterizationSamples = lv->samples;
+
+	// Depth testing, with a plain less-than compare and writes on, so
+	// the hardware can reject hidden fragments before shading them. The
+	// shaders must not write gl_FragDepth or discard to keep it that way.
+	VkPipelineDepthStencilStateCreateInfo depthStencil = { 0 };
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable       = VK_TRUE;
+	depthStencil.depthWriteEnable      = VK_TRUE;
+	depthStencil.depthCompareOp        = VK_COMPARE_OP_LESS;
+	depthStencil.depthBoundsTestEnable = VK_FALSE;
+	depthStencil.stencilTestEnable     = VK_FALSE;
+
+	// After a fragment shader has returned a color, it needs to be 
+	// combined with the color that is already in the framebuffer. 
+	// This transformation is known as color blending
+
+	// VkPipelineColorBlendAttachmentState contains the configuration
+	//  per attached framebuffer 	
+	VkPipelineColorBlendAttachmentState colorBlendAttachment = { 0 };
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable    = VK_FALSE;
+
+	// VkPipelineColorBlendStateCreateInfo contains the global color 
+	// blending settings
+	VkPipelineColorBlendStateCreateInfo colorBlending = { 0 };
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable   = VK_FALSE;
+	colorBlending.attachmentCount = 1;
+	colorBlending.pAttachments    = &colorBlendAttachment;
+
+	VkDynamicState dynamicStates[] =
+	{
+	    VK_DYNAMIC_STATE_VIEWPORT,
+	    VK_DYNAMIC_STATE_SCISSOR
+	};
+
+	// A limited amount of the state that we've specified in the previous 
+	// structs can actually be changed without recreating the pipeline. 
+	// Examples are the size of the viewport, line width and blend constants.
+	// If you want to do that, then you'll have to fill in 
+	// a VkPipelineDynamicStateCreateInfo structure
+	VkPipelineDynamicStateCreateInfo dynamicState = { 0 };
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = 2;
+	dynamicState.pDynamicStates    = dynamicStates;
+
+	VkGraphicsPipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount          = stage_count;
+	pipelineInfo.pStages             = stages;
+	pipelineInfo.pVertexInputState   = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState      = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState   = &multisampling;
+	pipelineInfo.pDepthStencilState  = lv->depth_format != VK_FORMAT_UNDEFINED ? &depthStencil : NULL;
+	pipelineInfo.pColorBlendState    = &colorBlending;
+	pipelineInfo.pDynamicState       = &dynamicState;
+	pipelineInfo.layout              = lv->pipeline_layout;
+	pipelineInfo.renderPass          = lv->render_pass;
+	pipelineInfo.subpass             = 0;
+
+	// without a render pass the pipeline is told the attachment formats
+	VkPipelineRenderingCreateInfo renderingInfo = { 0 };
+	renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+	renderingInfo.colorAttachmentCount    = 1;
+	renderingInfo.pColorAttachmentFormats = &lv->format.format;
+	renderingInfo.depthAttachmentFormat   = lv->depth_format;
+	renderingInfo.stencilAttachmentFormat = lv_format_has_stencil(lv->depth_format) ? lv->depth_format : VK_FORMAT_UNDEFINED;
+
+	if (lv->dynamic_rendering)
+	{
+		pipelineInfo.pNext = &renderingInfo;
+	}
+
+	if (vkCreateGraphicsPipelines(lv->device, lv->pipeline_cache, 1, &pipelineInfo, lv_allocator(), pipeline) != VK_SUCCESS)
+	{
+		return 0;
+	}
+	
+	return 1;
+}
+
+/*
+ * Sets the vertex input of all pipelines, see lv_mesh_layout(); NULL for
+ * none, which is the default. Has to be called before lv_pipeline_create(),
+ * as the layout is not part of the pipeline keys.
+ */
+void lv_vertex_layout_set(lv_state_s *lv, const lv_vertex_layout_s *layout)
+{
+	if (layout == NULL)
+	{
+		memset(&lv->vertex_layout, 0, sizeof(lv_vertex_layout_s));
+		return;
+	}
+
+	lv->vertex_layout = *layout;
+}
+
+/*
+ * Reads a pipeline cache file written by lv_pipeline_cache_write() into a
+ * newly allocated buffer, which the caller has to free. Does not need a
+ * device, so it can run while the device is still being created.
+ */
+int lv_pipeline_cache_read(const char *path, void **data, size_t *size)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd == -1)
+	{
+		return 0;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) == -1 || st.st_size <= 0)
+	{
+		close(fd);
+		return 0;
+	}
+
+	*data = malloc(st.st_size);
+	*size = st.st_size;
+
+	if (*data == NULL || read(fd, *data, st.st_size) != st.st_size)
+	{
+		free(*data);
+		*data = NULL;
+		*size = 0;
+		close(fd);
+		return 0;
+	}
+
+	close(fd);
+	return 1;
+}
+
+/*
+ * Creates the pipeline cache used for all pipelines, seeded with the data
+ * previously read by lv_pipeline_cache_read() (may be NULL). Data from a
+ * different device or driver is dropped instead of handed to the driver.
+ */
+int lv_pipeline_cache_create(lv_state_s *lv, const void *data, size_t size)
+{
+	// header version one: length, version, vendor id, device id, uuid
+	const size_t header_size = 16 + VK_UUID_SIZE;
+
+	if (data != NULL && size >= header_size)
+	{
+		VkPhysicalDeviceProperties props;
+		vkGetPhysicalDeviceProperties(lv->gpu, &props);
+
+		const uint32_t *header = data;
+		if (header[1] != 1 || header[2] != props.vendorID || header[3] != props.deviceID ||
+				memcmp(header + 4, props.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+		{
+			data = NULL;
+		}
+	}
+	else
+	{
+		data = NULL;
+	}
+
+	VkPipelineCacheCreateInfo info = { 0 };
+	info.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	info.initialDataSize = data ? size : 0;
+	info.pInitialData    = data;
+
+	return vkCreatePipelineCache(lv->device, &info, lv_allocator(), &lv->pipeline_cache) == VK_SUCCESS;
+}
+
+/*
+ * Writes the contents of the pipeline cache to the given file, so the 
+ * next start can skip compiling pipelines the driver has seen before.
+ * Writes to a temporary file first, as to never leave a truncated one.
+ */
+int lv_pipeline_cache_write(lv_state_s *lv, const char *path)
+{
+	size_t size = 0;
+	if (lv->pipeline_cache == VK_NULL_HANDLE ||
+			vkGetPipelineCacheData(lv->device, lv->pipeline_cache, &size, NULL) != VK_SUCCESS || size == 0)
+	{
+		return 0;
+	}
+
+	void *data = malloc(size);
+	if (data == NULL || vkGetPipelineCacheData(lv->device, lv->pipeline_cache, &size, data) != VK_SUCCESS)
+	{
+		free(data);
+		return 0;
+	}
+
+	char tmp[PATH_MAX];
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+	FILE *file = fopen(tmp, "wb");
+	int written = file && fwrite(data, 1, size, file) == size;
+	written = file && fclose(file) == 0 && written;
+	free(data);
+
+	return written && rename(tmp, path) == 0;
+}
+
+/*
+ * Computes the key under which a pipeline built from the given shaders is
+ * registered: the bytecode hashes and the specialization constants of all
+ * stages. Everything else about our pipelines is fixed per lv_state_s.
+ */
+uint64_t lv_pipeline_key(const lv_shader_s *shaders, uint32_t count)
+{
+	uint64_t key = LV_FNV1A_SEED;
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const lv_shader_s *shader = &shaders[i];
+		key = lv_hash_fnv1a(&shader->hash, sizeof(shader->hash), key);
+		key = lv_hash_fnv1a(&shader->size, sizeof(shader->size), key);
+		key = lv_hash_fnv1a(&shader->type, sizeof(shader->type), key);
+		key = lv_hash_fnv1a(&shader->spec.count, sizeof(shader->spec.count), key);
+
+		for (uint32_t j = 0; j < shader->spec.count; ++j)
+		{
+			const VkSpecializationMapEntry *entry = &shader->spec.entries[j];
+			key = lv_hash_fnv1a(&entry->constantID, sizeof(entry->constantID), key);
+			key = lv_hash_fnv1a(shader->spec.data + entry->offset, entry->size, key);
+		}
+	}
+
+	return key;
+}
+
+static lv_pipeline_registry_entry_s*
+lv_pipeline_registry_slot(lv_pipeline_registry_s *registry, uint64_t key)
+{
+	uint32_t mask = registry->capacity - 1;
+	uint32_t i = (uint32_t) key & mask;
+
+	while (registry->entries[i].pipeline != VK_NULL_HANDLE && registry->entries[i].key != key)
+	{
+		i = (i + 1) & mask;
+	}
+
+	return &registry->entries[i];
+}
+
+/*
+ * Returns the pipeline registered under `key`, VK_NULL_HANDLE if none.
+ */
+VkPipeline lv_pipeline_registry_find(lv_pipeline_registry_s *registry, uint64_t key)
+{
+	if (registry->capacity == 0)
+	{
+		return VK_NULL_HANDLE;
+	}
+
+	return lv_pipeline_registry_slot(registry, key)->pipeline;
+}
+
+/*
+ * Registers the pipeline under `key`. The registry takes ownership and
+ * destroys the pipeline in lv_pipeline_registry_free(). Fails if there
+ * already is a pipeline registered under the key.
+ */
+int lv_pipeline_registry_insert(lv_pipeline_registry_s *registry, uint64_t key, VkPipeline pipeline)
+{
+	if ((registry->count + 1) * 2 > registry->capacity)
+	{
+		lv_pipeline_registry_s grown = { 0 };
+		grown.capacity = registry->capacity ? registry->capacity * 2 : 16;
+		grown.entries  = calloc(grown.capacity, sizeof(lv_pipeline_registry_entry_s));
+
+		if (grown.entries == NULL)
+		{
+			return 0;
+		}
+
+		for (uint32_t i = 0; i < registry->capacity; ++i)
+		{
+			if (registry->entries[i].pipeline != VK_NULL_HANDLE)
+			{
+				*lv_pipeline_registry_slot(&grown, registry->entries[i].key) = registry->entries[i];
+				++grown.count;
+			}
+		}
+
+		free(registry->entries);
+		*registry = grown;
+	}
+
+	lv_pipeline_registry_entry_s *entry = lv_pipeline_registry_slot(registry, key);
+	if (entry->pipeline != VK_NULL_HANDLE)
+	{
+		return 0;
+	}
+
+	entry->key      = key;
+	entry->pipeline = pipeline;
+	++registry->count;
+	return 1;
+}
+
+/*
+ * Removes the pipeline registered under `key` from the registry and hands
+ * ownership back to the caller. Returns VK_NULL_HANDLE if there is none.
+ */
+VkPipeline lv_pipeline_registry_remove(lv_pipeline_registry_s *registry, uint64_t key)
+{
+	if (registry->capacity == 0)
+	{
+		return VK_NULL_HANDLE;
+	}
+
+	lv_pipeline_registry_entry_s *entry = lv_pipeline_registry_slot(registry, key);
+	VkPipeline pipeline = entry->pipeline;
+
+	if (pipeline == VK_NULL_HANDLE)
+	{
+		return VK_NULL_HANDLE;
+	}
+
+	entry->pipeline = VK_NULL_HANDLE;
+	--registry->count;
+
+	// re-insert the rest of the cluster so lookups don't stop early
+	uint32_t mask = registry->capacity - 1;
+	for (uint32_t i = ((uint32_t) (entry - registry->entries) + 1) & mask; ; i = (i + 1) & mask)
+	{
+		lv_pipeline_registry_entry_s moved = registry->entries[i];
+		if (moved.pipeline == VK_NULL_HANDLE)
+		{
+			break;
+		}
+		registry->entries[i].pipeline = VK_NULL_HANDLE;
+		*lv_pipeline_registry_slot(registry, moved.key) = moved;
+	}
+
+	return pipeline;
+}
+
+void lv_pipeline_registry_free(VkDevice device, lv_pipeline_registry_s *registry)
+{
+	for (uint32_t i = 0; i < registry->capacity; ++i)
+	{
+		if (registry->entries[i].pipeline != VK_NULL_HANDLE)
+		{
+			vkDestroyPipeline(device, registry->entries[i].pipeline, lv_allocator());
+		}
+	}
+
+	free(registry->entries);
+	registry->entries  = NULL;
+	registry->capacity = 0;
+	registry->count    = 0;
+}
+
+/*
+ * Returns the registered pipeline for the given vertex and fragment 
+ * shader (including their specialization constants) in `pipeline`,
+ * building and registering it first if needed.
+ */
+int lv_pipeline_get(lv_state_s *lv, lv_shader_s *vert_shader, lv_shader_s *frag_shader, VkPipeline *pipeline)
+{
+	const lv_shader_s shaders[] = { *vert_shader, *frag_shader };
+	uint64_t key = lv_pipeline_key(shaders, 2);
+
+	*pipeline = lv_pipeline_registry_find(&lv->pipelines, key);
+	if (*pipeline != VK_NULL_HANDLE)
+	{
+		return 1;
+	}
+
+	lv_shader_stage_create(lv->gpu, lv->device, lv_primary_surface(lv), vert_shader, frag_shader);
+
+	const VkPipelineShaderStageCreateInfo stages[] = { vert_shader->info, frag_shader->info };
+
+	if (lv_pipeline_build(lv, stages, 2, pipeline) == 0)
+	{
+		return 0;
+	}
+
+	if (lv_pipeline_registry_insert(&lv->pipelines, key, *pipeline) == 0)
+	{
+		vkDestroyPipeline(lv->device, *pipeline, lv_allocator());
+		*pipeline = VK_NULL_HANDLE;
+		return 0;
+	}
+
+	return 1;
+}
+
+int lv_pipeline_create(lv_state_s *lv)
+{
+	// You can use uniform values in shaders, which can be changed at 
+	// drawing time to alter the behavior of your shaders without having 
+	// to recreate them. These uniform values need to be specified during 
+	// pipeline creation by creating a VkPipelineLayout object.
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = { 0 };
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+
+	// how to get from quantized vertices to object space, see lv_mesh_bind()
+	VkPushConstantRange dequant = { 0 };
+	dequant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	dequant.offset     = 0;
+	dequant.size       = sizeof(lv_mesh_dequant_s);
+
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges    = &dequant;
+
+	if (vkCreatePipelineLayout(lv->device, &pipelineLayoutInfo, lv_allocator(), &lv->pipeline_layout) != VK_SUCCESS)
+	{
+		return 0;
+	}
+
+	return lv_pipeline_get(lv, &lv->vert_shader, &lv->frag_shader, &lv->pipeline);
+}
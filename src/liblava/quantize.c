@@ -0,0 +1,267 @@
+#include <math.h>              // fabsf(), lrintf(), ...
+#include <string.h>            // memcpy()
+#ifdef __SSE2__
+#include <emmintrin.h>         // _mm_cvtps_epi32(), _mm_packs_epi32(), ...
+#endif
+
+#include "internal.h"
+
+//
+// Encoders for the quantized vertex formats, used by lvmesh. Together
+// they take a vertex from 32 bytes down to 14: positions as 16-bit unorm
+// within the bounds of the mesh, normals octahedral in two signed bytes
+// and texture coordinates as half floats. All three round to nearest.
+//
+// The SSE2 paths do four values per step and give the same results as
+// the scalar ones, which do the tails and everything without SSE2.
+//
+
+// positions are stored as four components, three have no usable format
+#define LV_POSITION_COMPONENTS 4
+
+static inline uint32_t
+lv_float_bits(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+static inline float
+lv_bits_float(uint32_t bits)
+{
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+/*
+ * Converts to a half float, rounding to nearest even. Too large values
+ * become infinity, NaNs stay NaNs.
+ */
+uint16_t lv_half_from_float(float value)
+{
+	uint32_t bits = lv_float_bits(value);
+	uint32_t sign = bits & 0x80000000u;
+	uint32_t abs  = bits ^ sign;
+	uint32_t half;
+
+	if (abs >= (127 + 16) << 23)
+	{
+		half = abs > 255u << 23 ? 0x7e00 : 0x7c00;
+	}
+	else if (abs < 113 << 23)
+	{
+		// denormal or zero: adding 0.5 lines the mantissa up, the FPU rounds
+		half = lv_float_bits(lv_bits_float(abs) + 0.5f) - lv_float_bits(0.5f);
+	}
+	else
+	{
+		// rebias the exponent, then round; the carry may bump it
+		half = (abs + ((uint32_t) (15 - 127) << 23) + 0xfff + ((abs >> 13) & 1)) >> 13;
+	}
+
+	return (uint16_t) (half | sign >> 16);
+}
+
+float lv_half_to_float(uint16_t half)
+{
+	uint32_t sign = (uint32_t) (half & 0x8000) << 16;
+	uint32_t exponent = (half >> 10) & 0x1f;
+	uint32_t mantissa = half & 0x3ff;
+
+	if (exponent == 0x1f)
+	{
+		return lv_bits_float(sign | 0x7f800000u | mantissa << 13);
+	}
+
+	if (exponent == 0)
+	{
+		// denormal or zero, 2^-24 per step
+		float value = (float) mantissa * (1.0f / 16777216.0f);
+		return sign ? -value : value;
+	}
+
+	return lv_bits_float(sign | (exponent + 127 - 15) << 23 | mantissa << 13);
+}
+
+#ifdef __SSE2__
+/*
+ * Packs the low 16 bits of the lanes of both into one, unsigned. SSE2
+ * only has a signed saturating pack, so the values are moved into its
+ * range and back.
+ */
+static inline __m128i
+lv_pack_u16(__m128i lo, __m128i hi)
+{
+	const __m128i bias = _mm_set1_epi32(0x8000);
+	__m128i packed = _mm_packs_epi32(_mm_sub_epi32(lo, bias), _mm_sub_epi32(hi, bias));
+	return _mm_xor_si128(packed, _mm_set1_epi16((short) 0x8000));
+}
+
+/*
+ * lv_half_from_float() on four lanes, the results in the low 16 bits.
+ */
+static inline __m128i
+lv_half_from_float4(__m128 value)
+{
+	__m128i bits = _mm_castps_si128(value);
+	__m128i sign = _mm_and_si128(bits, _mm_set1_epi32((int) 0x80000000u));
+	__m128i abs  = _mm_xor_si128(bits, sign);
+
+	__m128i is_large = _mm_cmpgt_epi32(abs, _mm_set1_epi32(((127 + 16) << 23) - 1));
+	__m128i is_nan   = _mm_cmpgt_epi32(abs, _mm_set1_epi32(255 << 23));
+	__m128i is_small = _mm_cmplt_epi32(abs, _mm_set1_epi32(113 << 23));
+
+	__m128i large = _mm_or_si128(_mm_set1_epi32(0x7c00), _mm_and_si128(is_nan, _mm_set1_epi32(0x200)));
+
+	const __m128 half = _mm_set1_ps(0.5f);
+	__m128i small = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(abs), half)), _mm_castps_si128(half));
+
+	__m128i odd = _mm_and_si128(_mm_srli_epi32(abs, 13), _mm_set1_epi32(1));
+	__m128i normal = _mm_add_epi32(abs, _mm_set1_epi32((int) (((uint32_t) (15 - 127) << 23) + 0xfff)));
+	normal = _mm_srli_epi32(_mm_add_epi32(normal, odd), 13);
+
+	__m128i result = _mm_or_si128(_mm_and_si128(is_small, small), _mm_andnot_si128(is_small, normal));
+	result = _mm_or_si128(_mm_and_si128(is_large, large), _mm_andnot_si128(is_large, result));
+	return _mm_or_si128(result, _mm_srli_epi32(sign, 16));
+}
+#endif
+
+/*
+ * Maps positions into the box from `min` to `max` as four unsigned 16-bit
+ * components each, the fourth always 0; the box has to hold all of them.
+ * The matching lv_mesh_dequant_s has a scale of max - min and an offset
+ * of min.
+ */
+void lv_quantize_positions(const float *positions, uint32_t count, const float min[3], const float max[3], uint16_t *out)
+{
+	float scale[LV_POSITION_COMPONENTS] = { 0 };
+	for (int k = 0; k < 3; ++k)
+	{
+		scale[k] = max[k] > min[k] ? 65535.0f / (max[k] - min[k]) : 0.0f;
+	}
+
+	uint32_t i = 0;
+
+#ifdef __SSE2__
+	// the fourth lane reads the next vertex, the zero scale drops it
+	const __m128 origin = _mm_setr_ps(min[0], min[1], min[2], 0.0f);
+	const __m128 factor = _mm_loadu_ps(scale);
+	const __m128 limit  = _mm_set1_ps(65535.0f);
+
+	for (; i + 2 < count; i += 2)
+	{
+		__m128 a = _mm_loadu_ps(&positions[i * 3]);
+		__m128 b = _mm_loadu_ps(&positions[i * 3 + 3]);
+
+		a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(a, origin), factor), _mm_setzero_ps()), limit);
+		b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(b, origin), factor), _mm_setzero_ps()), limit);
+
+		__m128i packed = lv_pack_u16(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+		_mm_storeu_si128((__m128i *) &out[i * LV_POSITION_COMPONENTS], packed);
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			float value = (positions[i * 3 + k] - min[k]) * scale[k];
+			value = value < 0.0f ? 0.0f : (value > 65535.0f ? 65535.0f : value);
+			out[i * LV_POSITION_COMPONENTS + k] = (uint16_t) lrintf(value);
+		}
+		out[i * LV_POSITION_COMPONENTS + 3] = 0;
+	}
+}
+
+/*
+ * Encodes unit normals as two signed bytes each: projected onto an
+ * octahedron, with the lower half folded over the upper one.
+ */
+void lv_quantize_normals(const float *normals, uint32_t count, int8_t *out)
+{
+	uint32_t i = 0;
+
+#ifdef __SSE2__
+	const __m128 sign_mask = _mm_set1_ps(-0.0f);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 tiny = _mm_set1_ps(1e-20f);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		// x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3 into one vector per axis
+		__m128 a = _mm_loadu_ps(&normals[i * 3]);
+		__m128 b = _mm_loadu_ps(&normals[i * 3 + 4]);
+		__m128 c = _mm_loadu_ps(&normals[i * 3 + 8]);
+
+		__m128 x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+		__m128 y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)),
+				_mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)),
+				_mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+
+		__m128 sum = _mm_add_ps(_mm_add_ps(_mm_andnot_ps(sign_mask, x), _mm_andnot_ps(sign_mask, y)),
+				_mm_andnot_ps(sign_mask, z));
+		__m128 inv = _mm_div_ps(one, _mm_max_ps(sum, tiny));
+		x = _mm_mul_ps(x, inv);
+		y = _mm_mul_ps(y, inv);
+
+		// below the equator, 1 - |other| with the sign kept
+		__m128 folded_x = _mm_or_ps(_mm_sub_ps(one, _mm_andnot_ps(sign_mask, y)), _mm_and_ps(sign_mask, x));
+		__m128 folded_y = _mm_or_ps(_mm_sub_ps(one, _mm_andnot_ps(sign_mask, x)), _mm_and_ps(sign_mask, y));
+		__m128 below = _mm_cmplt_ps(z, _mm_setzero_ps());
+		x = _mm_or_ps(_mm_and_ps(below, folded_x), _mm_andnot_ps(below, x));
+		y = _mm_or_ps(_mm_and_ps(below, folded_y), _mm_andnot_ps(below, y));
+
+		__m128i ix = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(127.0f)));
+		__m128i iy = _mm_cvtps_epi32(_mm_mul_ps(y, _mm_set1_ps(127.0f)));
+
+		__m128i words = _mm_packs_epi32(_mm_unpacklo_epi32(ix, iy), _mm_unpackhi_epi32(ix, iy));
+		_mm_storel_epi64((__m128i *) &out[i * 2], _mm_packs_epi16(words, words));
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		const float *n = &normals[i * 3];
+		float sum = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+		sum = sum > 1e-20f ? sum : 1e-20f;
+
+		float x = n[0] / sum;
+		float y = n[1] / sum;
+
+		if (n[2] < 0.0f)
+		{
+			float folded_x = copysignf(1.0f - fabsf(y), x);
+			y = copysignf(1.0f - fabsf(x), y);
+			x = folded_x;
+		}
+
+		out[i * 2]     = (int8_t) lrintf(x * 127.0f);
+		out[i * 2 + 1] = (int8_t) lrintf(y * 127.0f);
+	}
+}
+
+/*
+ * Converts texture coordinates, pairs of floats, to half floats.
+ */
+void lv_quantize_uvs(const float *uvs, uint32_t count, uint16_t *out)
+{
+	uint32_t total = count * 2;
+	uint32_t i = 0;
+
+#ifdef __SSE2__
+	for (; i + 8 <= total; i += 8)
+	{
+		__m128i lo = lv_half_from_float4(_mm_loadu_ps(&uvs[i]));
+		__m128i hi = lv_half_from_float4(_mm_loadu_ps(&uvs[i + 4]));
+		_mm_storeu_si128((__m128i *) &out[i], lv_pack_u16(lo, hi));
+	}
+#endif
+
+	for (; i < total; ++i)
+	{
+		out[i] = lv_half_from_float(uvs[i]);
+	}
+}
@@ -0,0 +1,194 @@
+#include "internal.h"
+
+//
+// Rendering on a thread of its own. The thread that owns the windows
+// keeps handling events, as GLFW wants it to, and can't be held up by a
+// blocking acquire or present; the render thread can't be held up by
+// slow event handling. The render thread is paced by the scheduler, see
+// frame.c, which waits on a condition variable instead of for events.
+//
+// State goes from one thread to the other through snapshots: three
+// copies, one being written, one being read and one in between, which
+// are handed over with a single atomic exchange on either side. The
+// reader always gets the latest complete copy, neither side ever waits.
+//
+
+// the middle copy hasn't been picked up by the reader yet
+#define LV_SNAPSHOT_FRESH 4u
+
+#define LV_CACHE_LINE 64
+
+/*
+ * Runs frames until lv_render_thread_stop(), or until one fails. Then it
+ * wakes the thread waiting for events, which finds it no longer running.
+ */
+static void *
+lv_render_thread(void *arg)
+{
+	lv_state_s *lv = arg;
+
+	while (atomic_load(&lv->scheduler.threaded))
+	{
+		if (lv_frame_wait(lv) == 0)
+		{
+			continue;
+		}
+
+		if (lv->render_frame(lv, lv->render_user) == 0)
+		{
+			lv_log(LV_LOG_ERROR, "Render thread: frame failed, stopping");
+			lv->render_result = 0;
+			atomic_store(&lv->scheduler.threaded, 0);
+
+			if (lv->scheduler.wake != NULL)
+			{
+				lv->scheduler.wake();
+			}
+			return NULL;
+		}
+	}
+
+	lv->render_result = 1;
+	return NULL;
+}
+
+/*
+ * Starts drawing on a thread of its own. Whenever the scheduler says a
+ * frame is due, it calls frame(lv, user), which does what the frame
+ * needs and calls lv_draw_frame(). Everything the frame reads from other
+ * threads should come in through a snapshot. Returns 0 if the thread
+ * can't be created, frames are then drawn by the caller as before.
+ */
+int lv_render_thread_start(lv_state_s *lv, int (*frame)(lv_state_s *lv, void *user), void *user)
+{
+	if (atomic_load(&lv->scheduler.threaded))
+	{
+		return 0;
+	}
+
+	lv->render_frame = frame;
+	lv->render_user  = user;
+	atomic_store(&lv->scheduler.threaded, 1);
+
+	if (pthread_create(&lv->render_thread, NULL, lv_render_thread, lv) != 0)
+	{
+		lv_log(LV_LOG_ERROR, "Render thread: can't be created");
+		atomic_store(&lv->scheduler.threaded, 0);
+		lv->render_frame = NULL;
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * Returns 1 while the render thread draws frames, 0 once it stopped,
+ * also if it stopped by itself because a frame failed. The thread
+ * waiting for events is woken up then, see lv_frame_events().
+ */
+int lv_render_thread_running(lv_state_s *lv)
+{
+	return atomic_load(&lv->scheduler.threaded);
+}
+
+/*
+ * Stops the render thread after the frame it is drawing, if any. Returns
+ * 0 if it stopped because a frame failed.
+ */
+int lv_render_thread_stop(lv_state_s *lv)
+{
+	if (lv->render_frame == NULL)
+	{
+		return 1;
+	}
+
+	atomic_store(&lv->scheduler.threaded, 0);
+	lv_invalidate(lv);
+
+	pthread_join(lv->render_thread, NULL);
+	lv->render_frame = NULL;
+	return lv->render_result;
+}
+
+/*
+ * Creates a snapshot of `size` bytes, all three copies initialized from
+ * `initial`, or zeroed if it is NULL. Returns NULL if out of memory.
+ */
+lv_snapshot_s *lv_snapshot_create(size_t size, const void *initial)
+{
+	lv_snapshot_s *snap = calloc(1, sizeof(lv_snapshot_s));
+	if (snap == NULL)
+	{
+		return NULL;
+	}
+
+	// the copies are written and read by different threads
+	snap->size   = size;
+	snap->stride = (size + LV_CACHE_LINE - 1) & ~(size_t) (LV_CACHE_LINE - 1);
+	snap->data   = aligned_alloc(LV_CACHE_LINE, snap->stride * 3);
+
+	if (snap->data == NULL)
+	{
+		free(snap);
+		return NULL;
+	}
+
+	for (int i = 0; i < 3; ++i)
+	{
+		if (initial != NULL)
+		{
+			memcpy(snap->data + snap->stride * i, initial, size);
+		}
+		else
+		{
+			memset(snap->data + snap->stride * i, 0, size);
+		}
+	}
+
+	snap->back  = 0;
+	snap->front = 1;
+	atomic_init(&snap->middle, 2);
+	return snap;
+}
+
+/*
+ * Hands a new copy of the state to the reader. Only to be called by the
+ * one writing thread.
+ */
+void lv_snapshot_publish(lv_snapshot_s *snap, const void *data)
+{
+	memcpy(snap->data + snap->stride * snap->back, data, snap->size);
+	snap->back = atomic_exchange_explicit(&snap->middle, snap->back | LV_SNAPSHOT_FRESH,
+			memory_order_acq_rel) & ~LV_SNAPSHOT_FRESH;
+}
+
+/*
+ * Returns the latest published copy of the state, which stays as it is
+ * until the next call. Sets `fresh`, if given, to 1 if it is a new one.
+ * Only to be called by the one reading thread.
+ */
+const void *lv_snapshot_read(lv_snapshot_s *snap, int *fresh)
+{
+	int changed = (atomic_load_explicit(&snap->middle, memory_order_relaxed) & LV_SNAPSHOT_FRESH) != 0;
+	if (changed)
+	{
+		snap->front = atomic_exchange_explicit(&snap->middle, snap->front,
+				memory_order_acq_rel) & ~LV_SNAPSHOT_FRESH;
+	}
+
+	if (fresh != NULL)
+	{
+		*fresh = changed;
+	}
+
+	return snap->data + snap->stride * snap->front;
+}
+
+void lv_snapshot_free(lv_snapshot_s *snap)
+{
+	if (snap != NULL)
+	{
+		free(snap->data);
+		free(snap);
+	}
+}
@@ -0,0 +1,669 @@
+#if defined(__AVX2__)
+#include <immintrin.h>         // _mm256_i32gather_ps(), ...
+#elif defined(__SSE2__)
+#include <emmintrin.h>         // _mm_mul_ps(), ...
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>          // vmulq_f32(), ...
+#endif
+
+#include "internal.h"
+
+//
+// Transform hierarchies: every node has a translation, rotation and scale
+// relative to its parent, and the world matrix that follows from them.
+// All of it is stored as a structure of arrays, one array per component,
+// with the nodes sorted by depth. Nodes of the same depth only depend on
+// the ones above them, so each level is computed in batches on the job
+// system, and every batch does as many nodes at once as there are SIMD
+// lanes: 8 with AVX2, 4 with SSE2 or NEON.
+//
+// Only what moved is computed: setting a node marks it dirty, and so are
+// its children when their level comes. lv_scene_update() writes the world
+// matrices straight into a slice of an upload buffer, but only those that
+// changed since the slice was last written, see lv_upload_next().
+//
+// Nodes are known by the id lv_scene_add() returns, which stays the same
+// as the nodes are sorted and is where their matrix goes in the output.
+//
+
+#define LV_SCENE_BATCH  1024	// nodes per job
+#define LV_SCENE_LOCALS 10	// translation xyz, rotation xyzw, scale xyz
+#define LV_SCENE_WORLDS 12	// 3x4, row by row, the last row is always 0 0 0 1
+
+#if defined(__AVX2__)
+
+#define LV_SCENE_LANES 8
+typedef __m256 lv_lanes;
+
+static inline lv_lanes lv_lanes_load(const float *p) { return _mm256_loadu_ps(p); }
+static inline void lv_lanes_store(float *p, lv_lanes v) { _mm256_storeu_ps(p, v); }
+static inline lv_lanes lv_lanes_set(float f) { return _mm256_set1_ps(f); }
+static inline lv_lanes lv_lanes_add(lv_lanes a, lv_lanes b) { return _mm256_add_ps(a, b); }
+static inline lv_lanes lv_lanes_sub(lv_lanes a, lv_lanes b) { return _mm256_sub_ps(a, b); }
+static inline lv_lanes lv_lanes_mul(lv_lanes a, lv_lanes b) { return _mm256_mul_ps(a, b); }
+
+static inline lv_lanes
+lv_lanes_gather(const float *base, const uint32_t *index)
+{
+	return _mm256_i32gather_ps(base, _mm256_loadu_si256((const __m256i *) index), 4);
+}
+
+#elif defined(__SSE2__)
+
+#define LV_SCENE_LANES 4
+typedef __m128 lv_lanes;
+
+static inline lv_lanes lv_lanes_load(const float *p) { return _mm_loadu_ps(p); }
+static inline void lv_lanes_store(float *p, lv_lanes v) { _mm_storeu_ps(p, v); }
+static inline lv_lanes lv_lanes_set(float f) { return _mm_set1_ps(f); }
+static inline lv_lanes lv_lanes_add(lv_lanes a, lv_lanes b) { return _mm_add_ps(a, b); }
+static inline lv_lanes lv_lanes_sub(lv_lanes a, lv_lanes b) { return _mm_sub_ps(a, b); }
+static inline lv_lanes lv_lanes_mul(lv_lanes a, lv_lanes b) { return _mm_mul_ps(a, b); }
+
+static inline lv_lanes
+lv_lanes_gather(const float *base, const uint32_t *index)
+{
+	return _mm_setr_ps(base[index[0]], base[index[1]], base[index[2]], base[index[3]]);
+}
+
+#elif defined(__ARM_NEON)
+
+#define LV_SCENE_LANES 4
+typedef float32x4_t lv_lanes;
+
+static inline lv_lanes lv_lanes_load(const float *p) { return vld1q_f32(p); }
+static inline void lv_lanes_store(float *p, lv_lanes v) { vst1q_f32(p, v); }
+static inline lv_lanes lv_lanes_set(float f) { return vdupq_n_f32(f); }
+static inline lv_lanes lv_lanes_add(lv_lanes a, lv_lanes b) { return vaddq_f32(a, b); }
+static inline lv_lanes lv_lanes_sub(lv_lanes a, lv_lanes b) { return vsubq_f32(a, b); }
+static inline lv_lanes lv_lanes_mul(lv_lanes a, lv_lanes b) { return vmulq_f32(a, b); }
+
+static inline lv_lanes
+lv_lanes_gather(const float *base, const uint32_t *index)
+{
+	const float gathered[4] = { base[index[0]], base[index[1]], base[index[2]], base[index[3]] };
+	return vld1q_f32(gathered);
+}
+
+#else
+
+#define LV_SCENE_LANES 1
+typedef float lv_lanes;
+
+static inline lv_lanes lv_lanes_load(const float *p) { return *p; }
+static inline void lv_lanes_store(float *p, lv_lanes v) { *p = v; }
+static inline lv_lanes lv_lanes_set(float f) { return f; }
+static inline lv_lanes lv_lanes_add(lv_lanes a, lv_lanes b) { return a + b; }
+static inline lv_lanes lv_lanes_sub(lv_lanes a, lv_lanes b) { return a - b; }
+static inline lv_lanes lv_lanes_mul(lv_lanes a, lv_lanes b) { return a * b; }
+
+static inline lv_lanes
+lv_lanes_gather(const float *base, const uint32_t *index)
+{
+	return base[index[0]];
+}
+
+#endif
+
+struct lv_scene
+{
+	uint32_t   count;
+	uint32_t   capacity;
+	uint32_t  *parents;	// by id, LV_SCENE_NONE for roots, always a lower id
+	uint32_t  *depths;	// by id
+	uint32_t  *slots;	// by id, where its node is in the arrays below
+	uint32_t  *ids;		// by slot
+	uint32_t  *parent_slots;	// by slot
+	float     *local[LV_SCENE_LOCALS];	// by slot
+	float     *world[LV_SCENE_WORLDS];	// by slot
+	float     *spare;	// for sorting the arrays above
+	uint8_t   *dirty;	// by slot, set since the last update
+	uint64_t  *changed;	// by slot, generation its world matrix was last computed in
+	uint32_t  *levels;	// first slot of every depth, and the count after the last
+	uint32_t   level_count;
+	int        sorted;	// no nodes added since the last sort
+	uint64_t   generation;	// of updates
+};
+
+/*
+ * A level of the hierarchy being updated, see lv_scene_job().
+ */
+struct lv_scene_level
+{
+	lv_scene_s  *scene;
+	uint32_t     begin;	// slots
+	uint32_t     end;
+	int          root;	// the nodes have no parents
+	float       *out;
+	uint64_t     written;	// generation `out` was last written with
+	atomic_uint  computed;
+};
+
+typedef struct lv_scene_level lv_scene_level_s;
+
+/*
+ * Computes the world matrices of a group of LV_SCENE_LANES nodes from
+ * their local transforms, at `offset` in `local` and `world`, and the
+ * world matrices of their parents in `parent_world`.
+ */
+static inline void
+lv_scene_group(float *const *local, float *const *world, uint32_t offset,
+		float *const *parent_world, const uint32_t *parents, int root)
+{
+	lv_lanes t[3], q[4], s[3];
+	for (int k = 0; k < 3; ++k)
+	{
+		t[k] = lv_lanes_load(local[k] + offset);
+		s[k] = lv_lanes_load(local[7 + k] + offset);
+	}
+	for (int k = 0; k < 4; ++k)
+	{
+		q[k] = lv_lanes_load(local[3 + k] + offset);
+	}
+
+	// the rotation of a unit quaternion, then scaled along the local axes
+	lv_lanes two = lv_lanes_set(2.0f), one = lv_lanes_set(1.0f);
+	lv_lanes xx = lv_lanes_mul(q[0], q[0]), yy = lv_lanes_mul(q[1], q[1]), zz = lv_lanes_mul(q[2], q[2]);
+	lv_lanes xy = lv_lanes_mul(q[0], q[1]), xz = lv_lanes_mul(q[0], q[2]), yz = lv_lanes_mul(q[1], q[2]);
+	lv_lanes wx = lv_lanes_mul(q[3], q[0]), wy = lv_lanes_mul(q[3], q[1]), wz = lv_lanes_mul(q[3], q[2]);
+
+	lv_lanes m[3][3];
+	m[0][0] = lv_lanes_mul(lv_lanes_sub(one, lv_lanes_mul(two, lv_lanes_add(yy, zz))), s[0]);
+	m[0][1] = lv_lanes_mul(lv_lanes_mul(two, lv_lanes_sub(xy, wz)), s[1]);
+	m[0][2] = lv_lanes_mul(lv_lanes_mul(two, lv_lanes_add(xz, wy)), s[2]);
+	m[1][0] = lv_lanes_mul(lv_lanes_mul(two, lv_lanes_add(xy, wz)), s[0]);
+	m[1][1] = lv_lanes_mul(lv_lanes_sub(one, lv_lanes_mul(two, lv_lanes_add(xx, zz))), s[1]);
+	m[1][2] = lv_lanes_mul(lv_lanes_mul(two, lv_lanes_sub(yz, wx)), s[2]);
+	m[2][0] = lv_lanes_mul(lv_lanes_mul(two, lv_lanes_sub(xz, wy)), s[0]);
+	m[2][1] = lv_lanes_mul(lv_lanes_mul(two, lv_lanes_add(yz, wx)), s[1]);
+	m[2][2] = lv_lanes_mul(lv_lanes_sub(one, lv_lanes_mul(two, lv_lanes_add(xx, yy))), s[2]);
+
+	if (root)
+	{
+		for (int r = 0; r < 3; ++r)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				lv_lanes_store(world[r * 4 + c] + offset, m[r][c]);
+			}
+			lv_lanes_store(world[r * 4 + 3] + offset, t[r]);
+		}
+		return;
+	}
+
+	for (int r = 0; r < 3; ++r)
+	{
+		lv_lanes p[4];
+		for (int k = 0; k < 4; ++k)
+		{
+			p[k] = lv_lanes_gather(parent_world[r * 4 + k], parents);
+		}
+
+		for (int c = 0; c < 3; ++c)
+		{
+			lv_lanes w = lv_lanes_mul(p[0], m[0][c]);
+			w = lv_lanes_add(w, lv_lanes_mul(p[1], m[1][c]));
+			w = lv_lanes_add(w, lv_lanes_mul(p[2], m[2][c]));
+			lv_lanes_store(world[r * 4 + c] + offset, w);
+		}
+
+		lv_lanes w = lv_lanes_mul(p[0], t[0]);
+		w = lv_lanes_add(w, lv_lanes_mul(p[1], t[1]));
+		w = lv_lanes_add(w, lv_lanes_mul(p[2], t[2]));
+		lv_lanes_store(world[r * 4 + 3] + offset, lv_lanes_add(w, p[3]));
+	}
+}
+
+/*
+ * Computes the nodes left over at the end of a batch, fewer than
+ * LV_SCENE_LANES, through a group padded with copies of the first.
+ */
+static void
+lv_scene_tail(lv_scene_s *scene, uint32_t first, uint32_t count, int root)
+{
+	float local_lanes[LV_SCENE_LOCALS][LV_SCENE_LANES];
+	float world_lanes[LV_SCENE_WORLDS][LV_SCENE_LANES];
+	uint32_t parents[LV_SCENE_LANES];
+	float *local[LV_SCENE_LOCALS], *world[LV_SCENE_WORLDS];
+
+	for (uint32_t l = 0; l < LV_SCENE_LANES; ++l)
+	{
+		uint32_t slot = first + (l < count ? l : 0);
+		for (int k = 0; k < LV_SCENE_LOCALS; ++k)
+		{
+			local_lanes[k][l] = scene->local[k][slot];
+		}
+		parents[l] = scene->parent_slots[slot];
+	}
+
+	for (int k = 0; k < LV_SCENE_LOCALS; ++k)
+	{
+		local[k] = local_lanes[k];
+	}
+	for (int k = 0; k < LV_SCENE_WORLDS; ++k)
+	{
+		world[k] = world_lanes[k];
+	}
+
+	lv_scene_group(local, world, 0, scene->world, parents, root);
+
+	for (uint32_t l = 0; l < count; ++l)
+	{
+		for (int k = 0; k < LV_SCENE_WORLDS; ++k)
+		{
+			scene->world[k][first + l] = world_lanes[k][l];
+		}
+	}
+}
+
+/*
+ * Writes the world matrix of the node in a slot into `out`, at its id,
+ * as a column major 4x4 matrix the way shaders read it.
+ */
+static inline void
+lv_scene_write(const lv_scene_s *scene, uint32_t slot, float *out)
+{
+	float *matrix = out + (size_t) scene->ids[slot] * 16;
+	for (int c = 0; c < 4; ++c)
+	{
+		for (int r = 0; r < 3; ++r)
+		{
+			matrix[c * 4 + r] = scene->world[r * 4 + c][slot];
+		}
+		matrix[c * 4 + 3] = c == 3 ? 1.0f : 0.0f;
+	}
+}
+
+/*
+ * Updates a range of batches of a level: every group with a dirty node,
+ * its own or its parent's, is computed, then everything changed since
+ * the output was last written is written to it.
+ */
+static void
+lv_scene_job(void *arg, uint32_t begin, uint32_t end)
+{
+	lv_scene_level_s *level = arg;
+	lv_scene_s *scene = level->scene;
+	uint32_t computed = 0;
+
+	for (uint32_t b = begin; b < end; ++b)
+	{
+		uint32_t first = level->begin + b * LV_SCENE_BATCH;
+		uint32_t last  = first + LV_SCENE_BATCH < level->end ? first + LV_SCENE_BATCH : level->end;
+
+		for (uint32_t i = first; i < last; i += LV_SCENE_LANES)
+		{
+			uint32_t count = last - i < LV_SCENE_LANES ? last - i : LV_SCENE_LANES;
+			int dirty = 0;
+
+			for (uint32_t l = 0; l < count; ++l)
+			{
+				if (level->root == 0)
+				{
+					scene->dirty[i + l] |= scene->dirty[scene->parent_slots[i + l]];
+				}
+				dirty |= scene->dirty[i + l];
+			}
+
+			if (dirty)
+			{
+				if (count == LV_SCENE_LANES)
+				{
+					lv_scene_group(scene->local, scene->world, i, scene->world, &scene->parent_slots[i], level->root);
+				}
+				else
+				{
+					lv_scene_tail(scene, i, count, level->root);
+				}
+
+				for (uint32_t l = 0; l < count; ++l)
+				{
+					if (scene->dirty[i + l])
+					{
+						scene->changed[i + l] = scene->generation;
+						++computed;
+					}
+				}
+			}
+
+			for (uint32_t l = 0; level->out != NULL && l < count; ++l)
+			{
+				if (scene->changed[i + l] > level->written)
+				{
+					lv_scene_write(scene, i + l, level->out);
+				}
+			}
+		}
+	}
+
+	atomic_fetch_add_explicit(&level->computed, computed, memory_order_relaxed);
+}
+
+/*
+ * Grows all arrays to hold `capacity` nodes.
+ */
+static int
+lv_scene_grow(lv_scene_s *scene, uint32_t capacity)
+{
+	uint32_t **by_node[] = { &scene->parents, &scene->depths, &scene->slots, &scene->ids,
+		&scene->parent_slots, &scene->levels };
+
+	for (size_t i = 0; i < sizeof(by_node) / sizeof(by_node[0]); ++i)
+	{
+		// one more for the end of the last level
+		uint32_t *grown = realloc(*by_node[i], sizeof(uint32_t) * (capacity + 1));
+		if (grown == NULL)
+		{
+			return 0;
+		}
+		*by_node[i] = grown;
+	}
+
+	float **floats[LV_SCENE_LOCALS + LV_SCENE_WORLDS + 1];
+	for (int k = 0; k < LV_SCENE_LOCALS; ++k)
+	{
+		floats[k] = &scene->local[k];
+	}
+	for (int k = 0; k < LV_SCENE_WORLDS; ++k)
+	{
+		floats[LV_SCENE_LOCALS + k] = &scene->world[k];
+	}
+	floats[LV_SCENE_LOCALS + LV_SCENE_WORLDS] = &scene->spare;
+
+	for (int i = 0; i < LV_SCENE_LOCALS + LV_SCENE_WORLDS + 1; ++i)
+	{
+		float *grown = realloc(*floats[i], sizeof(float) * capacity);
+		if (grown == NULL)
+		{
+			return 0;
+		}
+		*floats[i] = grown;
+	}
+
+	uint8_t *dirty = realloc(scene->dirty, capacity);
+	if (dirty == NULL)
+	{
+		return 0;
+	}
+	scene->dirty = dirty;
+
+	uint64_t *changed = realloc(scene->changed, sizeof(uint64_t) * capacity);
+	if (changed == NULL)
+	{
+		return 0;
+	}
+	scene->changed = changed;
+
+	scene->capacity = capacity;
+	return 1;
+}
+
+/*
+ * Sorts the nodes by depth, those of the same depth by id, and moves
+ * everything kept by slot along.
+ */
+static int
+lv_scene_sort(lv_scene_s *scene)
+{
+	uint32_t count = scene->count;
+	uint32_t *moved = lv_scratch_alloc(sizeof(uint32_t) * count);	// new slot by old slot
+	uint8_t *dirty = lv_scratch_alloc(count);
+	uint64_t *changed = lv_scratch_alloc(sizeof(uint64_t) * count);
+
+	if (moved == NULL || dirty == NULL || changed == NULL)
+	{
+		lv_scratch_free(changed);
+		lv_scratch_free(dirty);
+		lv_scratch_free(moved);
+		return 0;
+	}
+
+	// counted by depth, then where each depth starts
+	scene->level_count = 0;
+	memset(scene->levels, 0, sizeof(uint32_t) * (count + 1));
+	for (uint32_t id = 0; id < count; ++id)
+	{
+		++scene->levels[scene->depths[id] + 1];
+		if (scene->depths[id] + 1 > scene->level_count)
+		{
+			scene->level_count = scene->depths[id] + 1;
+		}
+	}
+	for (uint32_t d = 0; d < scene->level_count; ++d)
+	{
+		scene->levels[d + 1] += scene->levels[d];
+	}
+
+	uint32_t *next = lv_scratch_alloc(sizeof(uint32_t) * (scene->level_count + 1));
+	if (next == NULL)
+	{
+		lv_scratch_free(changed);
+		lv_scratch_free(dirty);
+		lv_scratch_free(moved);
+		return 0;
+	}
+	memcpy(next, scene->levels, sizeof(uint32_t) * (scene->level_count + 1));
+
+	for (uint32_t id = 0; id < count; ++id)
+	{
+		uint32_t slot = next[scene->depths[id]]++;
+		moved[scene->slots[id]] = slot;
+		scene->slots[id] = slot;
+	}
+	lv_scratch_free(next);
+
+	float **arrays[LV_SCENE_LOCALS + LV_SCENE_WORLDS];
+	for (int k = 0; k < LV_SCENE_LOCALS; ++k)
+	{
+		arrays[k] = &scene->local[k];
+	}
+	for (int k = 0; k < LV_SCENE_WORLDS; ++k)
+	{
+		arrays[LV_SCENE_LOCALS + k] = &scene->world[k];
+	}
+
+	for (int k = 0; k < LV_SCENE_LOCALS + LV_SCENE_WORLDS; ++k)
+	{
+		float *from = *arrays[k];
+		for (uint32_t slot = 0; slot < count; ++slot)
+		{
+			scene->spare[moved[slot]] = from[slot];
+		}
+		*arrays[k] = scene->spare;
+		scene->spare = from;
+	}
+
+	for (uint32_t slot = 0; slot < count; ++slot)
+	{
+		dirty[moved[slot]]   = scene->dirty[slot];
+		changed[moved[slot]] = scene->changed[slot];
+	}
+	memcpy(scene->dirty, dirty, count);
+	memcpy(scene->changed, changed, sizeof(uint64_t) * count);
+
+	for (uint32_t id = 0; id < count; ++id)
+	{
+		uint32_t slot = scene->slots[id];
+		scene->ids[slot] = id;
+		scene->parent_slots[slot] = scene->parents[id] == LV_SCENE_NONE ? slot : scene->slots[scene->parents[id]];
+	}
+
+	lv_scratch_free(changed);
+	lv_scratch_free(dirty);
+	lv_scratch_free(moved);
+
+	scene->sorted = 1;
+	return 1;
+}
+
+/*
+ * Creates an empty scene with room for `capacity` nodes, more are made
+ * room for as they are added.
+ */
+lv_scene_s *lv_scene_create(uint32_t capacity)
+{
+	lv_scene_s *scene = calloc(1, sizeof(lv_scene_s));
+	if (scene == NULL)
+	{
+		return NULL;
+	}
+
+	if (lv_scene_grow(scene, capacity > 0 ? capacity : 64) == 0)
+	{
+		lv_scene_free(scene);
+		return NULL;
+	}
+
+	scene->sorted = 1;
+	return scene;
+}
+
+void lv_scene_free(lv_scene_s *scene)
+{
+	if (scene == NULL)
+	{
+		return;
+	}
+
+	for (int k = 0; k < LV_SCENE_LOCALS; ++k)
+	{
+		free(scene->local[k]);
+	}
+	for (int k = 0; k < LV_SCENE_WORLDS; ++k)
+	{
+		free(scene->world[k]);
+	}
+	free(scene->spare);
+	free(scene->changed);
+	free(scene->dirty);
+	free(scene->levels);
+	free(scene->parent_slots);
+	free(scene->ids);
+	free(scene->slots);
+	free(scene->depths);
+	free(scene->parents);
+	free(scene);
+}
+
+/*
+ * Adds a node under `parent`, LV_SCENE_NONE for a root, with an identity
+ * transform. Returns its id, which is also the number of nodes added
+ * before it, or LV_SCENE_NONE if out of memory or there is no such parent.
+ */
+uint32_t lv_scene_add(lv_scene_s *scene, uint32_t parent)
+{
+	if (parent != LV_SCENE_NONE && parent >= scene->count)
+	{
+		return LV_SCENE_NONE;
+	}
+
+	if (scene->count == scene->capacity && lv_scene_grow(scene, scene->capacity * 2) == 0)
+	{
+		return LV_SCENE_NONE;
+	}
+
+	uint32_t id = scene->count++;
+	scene->parents[id] = parent;
+	scene->depths[id]  = parent == LV_SCENE_NONE ? 0 : scene->depths[parent] + 1;
+
+	// at the end until the next sort
+	scene->slots[id] = id;
+	scene->ids[id]   = id;
+	scene->parent_slots[id] = parent == LV_SCENE_NONE ? id : scene->slots[parent];
+
+	static const float identity[LV_SCENE_LOCALS] = { 0, 0, 0, 0, 0, 0, 1, 1, 1, 1 };
+	for (int k = 0; k < LV_SCENE_LOCALS; ++k)
+	{
+		scene->local[k][id] = identity[k];
+	}
+	scene->dirty[id]   = 1;
+	scene->changed[id] = 0;
+	scene->sorted = 0;
+
+	return id;
+}
+
+uint32_t lv_scene_count(const lv_scene_s *scene)
+{
+	return scene->count;
+}
+
+/*
+ * Sets the transform of a node relative to its parent; `rotation` is a
+ * unit quaternion, x y z w. Not while the scene is being updated.
+ */
+void lv_scene_set(lv_scene_s *scene, uint32_t node, const float translation[3], const float rotation[4], const float scale[3])
+{
+	uint32_t slot = scene->slots[node];
+	for (int k = 0; k < 3; ++k)
+	{
+		scene->local[k][slot]     = translation[k];
+		scene->local[7 + k][slot] = scale[k];
+	}
+	for (int k = 0; k < 4; ++k)
+	{
+		scene->local[3 + k][slot] = rotation[k];
+	}
+	scene->dirty[slot] = 1;
+}
+
+/*
+ * Returns the world matrix of a node as of the last update, column major.
+ */
+void lv_scene_world(const lv_scene_s *scene, uint32_t node, float matrix[16])
+{
+	uint32_t slot = scene->slots[node];
+	for (int c = 0; c < 4; ++c)
+	{
+		for (int r = 0; r < 3; ++r)
+		{
+			matrix[c * 4 + r] = scene->world[r * 4 + c][slot];
+		}
+		matrix[c * 4 + 3] = c == 3 ? 1.0f : 0.0f;
+	}
+}
+
+/*
+ * Computes the world matrices of all nodes that were set since the last
+ * update, and of everything below them, one level after the other, each
+ * in parallel on `jobs` (may be NULL). If `out` isn't NULL, writes the
+ * matrices that changed since generation `*written` to it, 16 floats at
+ * the id of every node, and sets `*written` to the new generation. With
+ * one `written` per slice of an upload buffer, every slice is brought up
+ * to date with as few writes as it needs. Returns how many nodes were
+ * computed.
+ */
+uint32_t lv_scene_update(lv_scene_s *scene, lv_jobs_s *jobs, float *out, uint64_t *written)
+{
+	if (scene->sorted == 0 && lv_scene_sort(scene) == 0)
+	{
+		lv_log(LV_LOG_ERROR, "Out of memory sorting a scene of %u nodes", scene->count);
+		return 0;
+	}
+
+	++scene->generation;
+
+	lv_scene_level_s level = { 0 };
+	level.scene   = scene;
+	level.out     = out;
+	level.written = out != NULL ? *written : 0;
+	atomic_init(&level.computed, 0);
+
+	for (uint32_t d = 0; d < scene->level_count; ++d)
+	{
+		level.begin = scene->levels[d];
+		level.end   = scene->levels[d + 1];
+		level.root  = d == 0;
+
+		uint32_t batches = (level.end - level.begin + LV_SCENE_BATCH - 1) / LV_SCENE_BATCH;
+		lv_jobs_parallel_for(jobs, batches, 1, lv_scene_job, &level);
+	}
+
+	memset(scene->dirty, 0, scene->count);
+	if (out != NULL)
+	{
+		*written = scene->generation;
+	}
+
+	return atomic_load(&level.computed);
+}
@@ -0,0 +1,613 @@
+#include <sys/stat.h>          // fstat(), struct stat
+#include <sys/mman.h>          // mmap(), munmap()
+#include <fcntl.h>             // open()
+#include <unistd.h>            // close()
+
+#include "internal.h"
+
+/*
+ * 64 bit FNV-1a hash over the given data. Pass `LV_FNV1A_SEED` as seed,
+ * or the result of a previous call to continue hashing.
+ */
+uint64_t lv_hash_fnv1a(const void *data, size_t size, uint64_t seed)
+{
+	const unsigned char *bytes = data;
+	uint64_t hash = seed;
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+/*
+ * Checks if the given data looks like SPIR-V bytecode: its size needs to
+ * be a non-zero multiple of the word size and the first word needs to be
+ * the SPIR-V magic number. Returns 1 if so, 0 otherwise.
+ */
+int lv_spirv_valid(const uint32_t *data, size_t size)
+{
+	if (data == NULL || size < sizeof(uint32_t) * 5 || size % sizeof(uint32_t) != 0)
+	{
+		return 0;
+	}
+
+	return data[0] == LV_SPIRV_MAGIC;
+}
+
+/*
+ * Maps a file containing SPIR-V shader bytecode into memory and stores
+ * a pointer to the data, as well as its size in bytes and its hash, in
+ * the provided lv_shader_s struct. The mapping has to be released with
+ * lv_unload_shader_spv() once it is no longer needed.
+ * TODO we could check the file suffix and set the shader->type
+ *      accordingly (.vert, .tesc, .tese, .frag, .geom, .comp)
+ */
+int lv_load_shader_spv(const char* path, lv_shader_s *shader)
+{
+	// Try to open file for reading
+	int fd = open(path, O_RDONLY);
+	if (fd == -1)
+	{
+		return 0;
+	}
+
+	// Query file information via the descriptor we already have
+	struct stat st;
+	if (fstat(fd, &st) == -1 || st.st_size <= 0)
+	{
+		close(fd);
+		return 0;
+	}
+
+	// Map the file; the mapping stays valid after closing the descriptor
+	void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED)
+	{
+		return 0;
+	}
+
+	// mmap() hands out page aligned memory, so word alignment is a given
+	if (lv_spirv_valid(data, st.st_size) == 0)
+	{
+		munmap(data, st.st_size);
+		return 0;
+	}
+
+	shader->data = data;
+	shader->size = st.st_size;
+	shader->hash = lv_hash_fnv1a(data, st.st_size, LV_FNV1A_SEED);
+	return 1; 
+}
+
+/*
+ * Releases the mapping created by lv_load_shader_spv(). The size and hash
+ * stay in the struct, as they are still needed to identify the module.
+ */
+void lv_unload_shader_spv(lv_shader_s *shader)
+{
+	if (shader->data == NULL)
+	{
+		return;
+	}
+
+	munmap(shader->data, shader->size);
+	shader->data = NULL;
+}
+
+/*
+ * Returns the cache slot for the given hash and size: either the slot
+ * holding a matching module, or the empty slot where it should go.
+ */
+static lv_shader_cache_entry_s*
+lv_shader_cache_slot(lv_shader_cache_s *cache, uint64_t hash, size_t size)
+{
+	uint32_t mask = cache->capacity - 1;
+	uint32_t i = (uint32_t) hash & mask;
+
+	while (cache->entries[i].module != VK_NULL_HANDLE)
+	{
+		if (cache->entries[i].hash == hash && cache->entries[i].size == size)
+		{
+			break;
+		}
+		i = (i + 1) & mask;
+	}
+
+	return &cache->entries[i];
+}
+
+/*
+ * Makes sure the cache has room for at least one more entry, growing
+ * (and rehashing) it if it is more than half full.
+ */
+static int
+lv_shader_cache_reserve(lv_shader_cache_s *cache)
+{
+	if ((cache->count + 1) * 2 <= cache->capacity)
+	{
+		return 1;
+	}
+
+	lv_shader_cache_s grown = { 0 };
+	grown.capacity = cache->capacity ? cache->capacity * 2 : 16;
+	grown.entries  = calloc(grown.capacity, sizeof(lv_shader_cache_entry_s));
+
+	if (grown.entries == NULL)
+	{
+		return 0;
+	}
+
+	for (uint32_t i = 0; i < cache->capacity; ++i)
+	{
+		lv_shader_cache_entry_s *entry = &cache->entries[i];
+		if (entry->module != VK_NULL_HANDLE)
+		{
+			*lv_shader_cache_slot(&grown, entry->hash, entry->size) = *entry;
+			++grown.count;
+		}
+	}
+
+	free(cache->entries);
+	*cache = grown;
+	return 1;
+}
+
+/*
+ * Creates a shader module from the SPIR-V shader byte code give in the
+ * provided lv_shader_s struct. The shader module will be stored in the
+ * struct as well. If a cache is given, a module created earlier from 
+ * identical byte code will be reused instead of creating a new one.
+ */
+int lv_shader_module_create(VkDevice device, lv_shader_cache_s *cache, lv_shader_s *shader)
+{
+	lv_shader_cache_entry_s *entry = NULL;
+
+	if (cache != NULL)
+	{
+		if (lv_shader_cache_reserve(cache) == 0)
+		{
+			return 0;
+		}
+
+		entry = lv_shader_cache_slot(cache, shader->hash, shader->size);
+		if (entry->module != VK_NULL_HANDLE)
+		{
+			++entry->refs;
+			shader->module = entry->module;
+			return 1;
+		}
+	}
+
+	if (shader->data == NULL)
+	{
+		return 0;
+	}
+
+	VkShaderModuleCreateInfo info = { 0 };
+	info.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	info.codeSize = shader->size;
+	info.pCode    = shader->data;
+
+	if (vkCreateShaderModule(device, &info, lv_allocator(), &shader->module) != VK_SUCCESS)
+	{
+		return 0;
+	}
+
+	if (entry != NULL)
+	{
+		entry->hash   = shader->hash;
+		entry->size   = shader->size;
+		entry->module = shader->module;
+		entry->refs   = 1;
+		++cache->count;
+	}
+
+	return 1;
+}
+
+/*
+ * Drops the shader's reference to its module. Modules that came from 
+ * the cache are only destroyed once the last reference is gone. Without
+ * a cache, the module is destroyed right away.
+ */
+void lv_shader_module_release(VkDevice device, lv_shader_cache_s *cache, lv_shader_s *shader)
+{
+	if (shader->module == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	if (cache != NULL && cache->capacity > 0)
+	{
+		lv_shader_cache_entry_s *entry = lv_shader_cache_slot(cache, shader->hash, shader->size);
+		if (entry->module == shader->module)
+		{
+			shader->module = VK_NULL_HANDLE;
+			if (--entry->refs > 0)
+			{
+				return;
+			}
+
+			vkDestroyShaderModule(device, entry->module, lv_allocator());
+
+			// re-insert the rest of the cluster so lookups don't stop
+			// early at the slot we are about to empty
+			uint32_t mask = cache->capacity - 1;
+			uint32_t i = (uint32_t) (entry - cache->entries);
+			entry->module = VK_NULL_HANDLE;
+			--cache->count;
+
+			for (i = (i + 1) & mask; ; i = (i + 1) & mask)
+			{
+				lv_shader_cache_entry_s moved = cache->entries[i];
+				if (moved.module == VK_NULL_HANDLE)
+				{
+					break;
+				}
+				cache->entries[i].module = VK_NULL_HANDLE;
+				*lv_shader_cache_slot(cache, moved.hash, moved.size) = moved;
+			}
+			return;
+		}
+	}
+
+	vkDestroyShaderModule(device, shader->module, lv_allocator());
+	shader->module = VK_NULL_HANDLE;
+}
+
+/*
+ * Destroys all modules still held by the cache and frees the cache.
+ */
+void lv_shader_cache_free(VkDevice device, lv_shader_cache_s *cache)
+{
+	for (uint32_t i = 0; i < cache->capacity; ++i)
+	{
+		if (cache->entries[i].module != VK_NULL_HANDLE)
+		{
+			vkDestroyShaderModule(device, cache->entries[i].module, lv_allocator());
+		}
+	}
+
+	free(cache->entries);
+	cache->entries  = NULL;
+	cache->capacity = 0;
+	cache->count    = 0;
+}
+
+/*
+ * Sets the specialization constant with the given id to the `size` bytes
+ * at `value`, adding it if it wasn't set before. Returns 0 if the value
+ * doesn't fit or has a different size than the one already set.
+ * Specialization constants are 4 bytes (bool, int, uint, float) or 8 bytes
+ * (double, int64) in size.
+ */
+int lv_specialization_set(lv_specialization_s *spec, uint32_t id, const void *value, size_t size)
+{
+	for (uint32_t i = 0; i < spec->count; ++i)
+	{
+		if (spec->entries[i].constantID == id)
+		{
+			if (spec->entries[i].size != size)
+			{
+				return 0;
+			}
+
+			memcpy(spec->data + spec->entries[i].offset, value, size);
+			return 1;
+		}
+	}
+
+	// keep 8 byte constants naturally aligned
+	size_t offset = (spec->size + size - 1) & ~(size - 1);
+
+	if (spec->count == LV_SPEC_MAX_CONSTANTS || offset + size > LV_SPEC_MAX_DATA)
+	{
+		return 0;
+	}
+
+	VkSpecializationMapEntry *entry = &spec->entries[spec->count++];
+	entry->constantID = id;
+	entry->offset     = (uint32_t) offset;
+	entry->size       = size;
+
+	memcpy(spec->data + offset, value, size);
+	spec->size = offset + size;
+	return 1;
+}
+
+int lv_specialization_set_u32(lv_specialization_s *spec, uint32_t id, uint32_t value)
+{
+	return lv_specialization_set(spec, id, &value, sizeof(value));
+}
+
+int lv_specialization_set_f32(lv_specialization_s *spec, uint32_t id, float value)
+{
+	return lv_specialization_set(spec, id, &value, sizeof(value));
+}
+
+/*
+ * SPIR-V booleans are 32 bit wide as far as specialization is concerned.
+ */
+int lv_specialization_set_bool(lv_specialization_s *spec, uint32_t id, int value)
+{
+	VkBool32 b = value ? VK_TRUE : VK_FALSE;
+	return lv_specialization_set(spec, id, &b, sizeof(b));
+}
+
+/*
+ * Points the specialization info at the constants. Has to be called again
+ * whenever the lv_specialization_s struct has been copied or moved.
+ */
+static const VkSpecializationInfo*
+lv_specialization_info(lv_specialization_s *spec)
+{
+	if (spec->count == 0)
+	{
+		return NULL;
+	}
+
+	spec->info.mapEntryCount = spec->count;
+	spec->info.pMapEntries   = spec->entries;
+	spec->info.dataSize      = spec->size;
+	spec->info.pData         = spec->data;
+	return &spec->info;
+}
+
+/*
+ * Fills in the shader stage infos. As they point to the specialization 
+ * constants stored in the shader structs, this has to be called again
+ * after copying a shader struct, or changing its constants.
+ */
+int lv_shader_stage_create(VkPhysicalDevice gpu, VkDevice device, VkSurfaceKHR surface, lv_shader_s *vert_shader, lv_shader_s *frag_shader)
+{
+	VkPipelineShaderStageCreateInfo vert_info = { 0 };
+	vert_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	vert_info.stage = VK_SHADER_STAGE_VERTEX_BIT;
+	vert_info.module = vert_shader->module;
+	vert_info.pName = "main";
+	vert_info.pSpecializationInfo = lv_specialization_info(&vert_shader->spec);
+
+	VkPipelineShaderStageCreateInfo frag_info = { 0 };
+	frag_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	frag_info.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	frag_info.module = frag_shader->module;
+	frag_info.pName = "main";
+	frag_info.pSpecializationInfo = lv_specialization_info(&frag_shader->spec);
+
+	vert_shader->info = vert_info;
+	frag_shader->info = frag_info;
+
+	return 1;
+}
+
+/*
+ * Loads the SPIR-V file at `path` and turns it into a shader module, 
+ * reusing a cached module for identical byte code if `cache` is given.
+ * The file mapping is released as soon as the module exists, as Vulkan
+ * does not need the byte code after vkCreateShaderModule() returns.
+ */
+int lv_shader_from_file_spv(VkDevice device, lv_shader_cache_s *cache, const char *path, lv_shader_s *shader, lv_shader_type_e type)
+{
+	if (lv_load_shader_spv(path, shader) == 0)
+	{
+		return 0;
+	}
+
+	shader->type = type;
+
+	int created = lv_shader_module_create(device, cache, shader);
+	lv_unload_shader_spv(shader);
+
+	return created;
+}
+
+/*
+ * Maps a shader archive created by lvpack into memory and checks that 
+ * its table of contents is sane. Everything is read from the mapping,
+ * so this is one open(), fstat() and mmap() no matter the shader count.
+ */
+int lv_shader_archive_open(const char *path, lv_shader_archive_s *archive)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd == -1)
+	{
+		return 0;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) == -1 || st.st_size < (off_t) sizeof(lv_archive_header_s))
+	{
+		close(fd);
+		return 0;
+	}
+
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (map == MAP_FAILED)
+	{
+		return 0;
+	}
+
+	const lv_archive_header_s *header = map;
+	size_t size = st.st_size;
+
+	size_t toc_size = (size_t) header->count * sizeof(lv_archive_entry_s)
+			+ (size_t) header->bucket_count * sizeof(uint32_t) * 2;
+
+	if (memcmp(header->magic, LV_ARCHIVE_MAGIC, 4) != 0 ||
+			header->version != LV_ARCHIVE_VERSION ||
+			header->size != size ||
+			header->bucket_count < header->count * 2 ||
+			(header->bucket_count & (header->bucket_count - 1)) != 0 ||
+			toc_size > size - sizeof(lv_archive_header_s))
+	{
+		munmap(map, size);
+		return 0;
+	}
+
+	archive->map     = map;
+	archive->size    = size;
+	archive->header  = header;
+	archive->entries = (const lv_archive_entry_s *) (header + 1);
+	archive->name_buckets = (const uint32_t *) (archive->entries + header->count);
+	archive->hash_buckets = archive->name_buckets + header->bucket_count;
+
+	for (uint32_t i = 0; i < header->count; ++i)
+	{
+		const lv_archive_entry_s *entry = &archive->entries[i];
+		if (entry->offset % sizeof(uint32_t) != 0 || entry->offset > size || 
+				entry->size > size - entry->offset)
+		{
+			munmap(map, size);
+			memset(archive, 0, sizeof(lv_shader_archive_s));
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+void lv_shader_archive_close(lv_shader_archive_s *archive)
+{
+	if (archive->map != NULL)
+	{
+		munmap(archive->map, archive->size);
+	}
+	memset(archive, 0, sizeof(lv_shader_archive_s));
+}
+
+/*
+ * Finds the archive entry with the given name, NULL if there is none.
+ */
+const lv_archive_entry_s *lv_shader_archive_find(const lv_shader_archive_s *archive, const char *name)
+{
+	if (archive->header == NULL || archive->header->bucket_count == 0)
+	{
+		return NULL;
+	}
+
+	uint64_t hash = lv_hash_fnv1a(name, strlen(name), LV_FNV1A_SEED);
+	uint32_t mask = archive->header->bucket_count - 1;
+
+	for (uint32_t i = (uint32_t) hash & mask; archive->name_buckets[i] != 0; i = (i + 1) & mask)
+	{
+		uint32_t index = archive->name_buckets[i] - 1;
+		if (index < archive->header->count && archive->entries[index].name_hash == hash &&
+				strncmp(archive->entries[index].name, name, LV_ARCHIVE_NAME_SIZE) == 0)
+		{
+			return &archive->entries[index];
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Finds the archive entry with the given bytecode hash, NULL if none.
+ */
+const lv_archive_entry_s *lv_shader_archive_find_hash(const lv_shader_archive_s *archive, uint64_t hash)
+{
+	if (archive->header == NULL || archive->header->bucket_count == 0)
+	{
+		return NULL;
+	}
+
+	uint32_t mask = archive->header->bucket_count - 1;
+
+	for (uint32_t i = (uint32_t) hash & mask; archive->hash_buckets[i] != 0; i = (i + 1) & mask)
+	{
+		uint32_t index = archive->hash_buckets[i] - 1;
+		if (index < archive->header->count && archive->entries[index].hash == hash)
+		{
+			return &archive->entries[index];
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Creates a shader module from the archive entry with the given name. 
+ * The bytecode is handed to Vulkan straight from the mapping and the
+ * hash stored in the archive is used for the module cache, so the code
+ * is neither copied nor hashed again.
+ */
+int lv_shader_from_archive(VkDevice device, lv_shader_cache_s *cache, const lv_shader_archive_s *archive, const char *name, lv_shader_s *shader, lv_shader_type_e type)
+{
+	const lv_archive_entry_s *entry = lv_shader_archive_find(archive, name);
+	if (entry == NULL)
+	{
+		return 0;
+	}
+
+	uint32_t *data = (uint32_t *) ((char *) archive->map + entry->offset);
+	if (lv_spirv_valid(data, entry->size) == 0)
+	{
+		return 0;
+	}
+
+	shader->data = data;
+	shader->size = entry->size;
+	shader->hash = entry->hash;
+	shader->type = type;
+
+	int created = lv_shader_module_create(device, cache, shader);
+
+	// the data belongs to the archive mapping
+	shader->data = NULL;
+	return created;
+}
+
+/*
+ * Creates the state's vertex and fragment shader from the given archive
+ * and sets up their stages.
+ */
+int lv_shaders_from_archive(lv_state_s *lv, const lv_shader_archive_s *archive, const char *vert_name, const char *frag_name)
+{
+	if (lv_shader_from_archive(lv->device, &lv->shader_cache, archive, vert_name, &lv->vert_shader, LV_SHADER_VERT) == 0)
+	{
+		return 0;
+	}
+
+	if (lv_shader_from_archive(lv->device, &lv->shader_cache, archive, frag_name, &lv->frag_shader, LV_SHADER_FRAG) == 0)
+	{
+		return 0;
+	}
+
+	return lv_shader_stage_create(lv->gpu, lv->device, lv_primary_surface(lv), &lv->vert_shader, &lv->frag_shader);
+}
+
+/*
+ * Creates the state's vertex and fragment shader from SPIR-V that has
+ * already been loaded with lv_load_shader_spv(), and sets up their stages.
+ * The bytecode is unloaded either way.
+ */
+int lv_shaders_from_spv(lv_state_s *lv, lv_shader_s *vert_shader, lv_shader_s *frag_shader)
+{
+	lv->vert_shader = *vert_shader;
+	lv->vert_shader.type = LV_SHADER_VERT;
+	lv->frag_shader = *frag_shader;
+	lv->frag_shader.type = LV_SHADER_FRAG;
+
+	int created = lv_shader_module_create(lv->device, &lv->shader_cache, &lv->vert_shader) &&
+		lv_shader_module_create(lv->device, &lv->shader_cache, &lv->frag_shader);
+
+	lv_unload_shader_spv(&lv->vert_shader);
+	lv_unload_shader_spv(&lv->frag_shader);
+	vert_shader->data = NULL;
+	frag_shader->data = NULL;
+
+	if (created == 0)
+	{
+		return 0;
+	}
+
+	return lv_shader_stage_create(lv->gpu, lv->device, lv_primary_surface(lv), &lv->vert_shader, &lv->frag_shader);
+}
@@ -0,0 +1,713 @@
+
+#include "internal.h"
+
+/*
+ * Creates a swapchain for the surface at its current extent. If `old` is
+ * given, the new one replaces it, the caller still has to destroy it.
+ */
+int lv_create_swapchain(VkPhysicalDevice gpu, VkSurfaceKHR surface, VkDevice device,
+		lv_queue_s *gqueue, lv_queue_s *pqueue, VkSurfaceFormatKHR format, VkSwapchainKHR old, VkSwapchainKHR *swapchain)
+{
+	VkSurfaceCapabilitiesKHR caps = lv_device_surface_get_capabilities(gpu, surface);
+
+	VkSwapchainCreateInfoKHR info = { 0 };
+	info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+	info.surface = surface;
+
+	info.minImageCount = caps.minImageCount + 1;
+	info.imageFormat = format.format;
+	info.imageColorSpace = format.colorSpace;
+	info.imageExtent = caps.currentExtent; // TODO
+	info.imageArrayLayers = 1;
+	info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+	uint32_t queue_indices[] = { gqueue->index, pqueue->index };
+	
+	if (gqueue->index == pqueue->index)
+	{
+		info.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	}
+	else
+       	{
+		info.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+		info.queueFamilyIndexCount = 2;
+		info.pQueueFamilyIndices = queue_indices;
+	}
+	
+	info.preTransform = caps.currentTransform;
+	info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+	info.presentMode = VK_PRESENT_MODE_FIFO_KHR; // TODO
+	info.clipped = VK_TRUE;
+	info.oldSwapchain = old;
+
+	return (vkCreateSwapchainKHR(device, &info, lv_allocator(), swapchain) == VK_SUCCESS);
+}
+
+int lv_get_swapchain_images(VkDevice device, VkSwapchainKHR swapchain, lv_image_set_s *images)
+{
+	vkGetSwapchainImagesKHR(device, swapchain, &images->count, NULL);
+
+	images->images = malloc(sizeof(VkImage) * images->count);
+	return (vkGetSwapchainImagesKHR(device, swapchain, &images->count, images->images) == VK_SUCCESS);
+}
+
+static VkResult
+lv_create_imageview(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspect, VkImageView *imageview)
+{
+	VkImageViewCreateInfo info = { 0 };
+	info.sType    = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	info.image    = image;
+	info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	info.format   = format;
+	info.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+	info.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+	info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+	info.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+	info.subresourceRange.aspectMask     = aspect;
+	info.subresourceRange.baseMipLevel   = 0;
+	info.subresourceRange.levelCount     = 1;
+	info.subresourceRange.baseArrayLayer = 0;
+	info.subresourceRange.layerCount     = 1;
+		
+	return vkCreateImageView(device, &info, lv_allocator(), imageview);
+}
+
+static int
+lv_output_create_imageviews(lv_state_s *lv, lv_output_s *out)
+{
+	out->images.views = calloc(out->images.count, sizeof(VkImageView));
+	if (out->images.views == NULL)
+	{
+		return 0;
+	}
+
+	for (uint32_t i = 0; i < out->images.count; ++i)
+	{
+		if (lv_create_imageview(lv->device, out->images.images[i], lv->format.format, 
+					VK_IMAGE_ASPECT_COLOR_BIT, &out->images.views[i]) != VK_SUCCESS)
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static int
+lv_output_create_swapchain(lv_state_s *lv, lv_output_s *out, VkSwapchainKHR old)
+{
+	// the device was picked for the first surface, the others need to be
+	// presentable from the same queue and take the same format
+	VkBool32 supported = VK_FALSE;
+	vkGetPhysicalDeviceSurfaceSupportKHR(lv->gpu, lv->pqueue.index, out->surface, &supported);
+
+	if (supported == VK_FALSE)
+	{
+		lv_log(LV_LOG_ERROR, "Output can't be presented from queue family %u", lv->pqueue.index);
+		return 0;
+	}
+
+	if (lv_device_surface_has_format(lv->gpu, out->surface, lv->format.format, lv->format.colorSpace, NULL) == 0)
+	{
+		lv_log(LV_LOG_ERROR, "Output doesn't support the format of the other outputs");
+		return 0;
+	}
+
+	out->extent = lv_device_surface_get_capabilities(lv->gpu, out->surface).currentExtent;
+
+	if (lv_create_swapchain(lv->gpu, out->surface, lv->device, &lv->gqueue, &lv->pqueue, lv->format, old, &out->swapchain) == 0)
+	{
+		return 0;
+	}
+
+	if (lv_get_swapchain_images(lv->device, out->swapchain, &out->images) == 0)
+	{
+		return 0;
+	}
+
+	return lv_output_create_imageviews(lv, out) && lv_damage_create(out);
+}
+
+/*
+ * Creates an attachment of the output's size that only lives within the 
+ * render pass, with the sample count of the state.
+ */
+static int
+lv_output_create_attachment(lv_state_s *lv, lv_output_s *out, VkFormat format, 
+		VkImageUsageFlags usage, VkImageAspectFlags aspect, lv_attachment_s *att)
+{
+	VkImageCreateInfo info = { 0 };
+	info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	info.imageType     = VK_IMAGE_TYPE_2D;
+	info.format        = format;
+	info.extent.width  = out->extent.width;
+	info.extent.height = out->extent.height;
+	info.extent.depth  = 1;
+	info.mipLevels     = 1;
+	info.arrayLayers   = 1;
+	info.samples       = lv->samples;
+	info.tiling        = VK_IMAGE_TILING_OPTIMAL;
+	info.usage         = usage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+	info.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+	info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	if (vkCreateImage(lv->device, &info, lv_allocator(), &att->image) != VK_SUCCESS)
+	{
+		return 0;
+	}
+
+	VkMemoryRequirements req;
+	vkGetImageMemoryRequirements(lv->device, att->image, &req);
+
+	// lazily allocated memory is mostly found on tilers, elsewhere the
+	// attachment takes regular device memory
+	uint32_t type = 0;
+	att->lazy = lv_device_memory_type(lv->gpu, req.memoryTypeBits, 
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, &type);
+
+	if (att->lazy == 0 && lv_device_memory_type(lv->gpu, req.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &type) == 0)
+	{
+		return 0;
+	}
+
+	VkMemoryAllocateInfo alloc = { 0 };
+	alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	alloc.allocationSize  = req.size;
+	alloc.memoryTypeIndex = type;
+
+	if (vkAllocateMemory(lv->device, &alloc, lv_allocator(), &att->memory) != VK_SUCCESS)
+	{
+		return 0;
+	}
+
+	if (vkBindImageMemory(lv->device, att->image, att->memory, 0) != VK_SUCCESS)
+	{
+		return 0;
+	}
+
+	return lv_create_imageview(lv->device, att->image, format, aspect, &att->view) == VK_SUCCESS;
+}
+
+static void
+lv_attachment_retire(lv_state_s *lv, lv_attachment_s *att)
+{
+	lv_retire(lv, VK_OBJECT_TYPE_IMAGE_VIEW, (uint64_t) att->view);
+	lv_retire(lv, VK_OBJECT_TYPE_IMAGE, (uint64_t) att->image);
+	lv_retire(lv, VK_OBJECT_TYPE_DEVICE_MEMORY, (uint64_t) att->memory);
+	memset(att, 0, sizeof(lv_attachment_s));
+}
+
+static int
+lv_output_create_attachments(lv_state_s *lv, lv_output_s *out)
+{
+	if (out->depth.image == VK_NULL_HANDLE && lv->depth_format != VK_FORMAT_UNDEFINED)
+	{
+		VkImageAspectFlags aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+		if (lv_format_has_stencil(lv->depth_format))
+		{
+			aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+		}
+
+		if (lv_output_create_attachment(lv, out, lv->depth_format, 
+					VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, aspect, &out->depth) == 0)
+		{
+			return 0;
+		}
+	}
+
+	if (out->msaa.image == VK_NULL_HANDLE && lv->samples > VK_SAMPLE_COUNT_1_BIT)
+	{
+		if (lv_output_create_attachment(lv, out, lv->format.format, 
+					VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT, &out->msaa) == 0)
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * The attachments are in the order of lv_renderpass_create(): color
+ * (multisampled, if so), depth, then the swapchain image to resolve to.
+ */
+static VkResult
+lv_create_framebuffer(lv_state_s *lv, lv_output_s *out, VkImageView view, VkFramebuffer *buffer)
+{
+	VkImageView attachments[3];
+	uint32_t count = 0;
+
+	attachments[count++] = out->msaa.view != VK_NULL_HANDLE ? out->msaa.view : view;
+	if (out->depth.view != VK_NULL_HANDLE)
+	{
+		attachments[count++] = out->depth.view;
+	}
+	if (out->msaa.view != VK_NULL_HANDLE)
+	{
+		attachments[count++] = view;
+	}
+
+	VkFramebufferCreateInfo info = { 0 };
+	info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	info.renderPass      = lv->render_pass;
+	info.attachmentCount = count;
+	info.pAttachments    = attachments;
+	info.width           = out->extent.width;
+	info.height          = out->extent.height;
+	info.layers          = 1;
+
+	return vkCreateFramebuffer(lv->device, &info, lv_allocator(), buffer);
+}
+
+static int
+lv_output_create_framebuffers(lv_state_s *lv, lv_output_s *out)
+{
+	out->framebuffers.count = out->images.count;
+	out->framebuffers.fbs   = calloc(out->framebuffers.count, sizeof(VkFramebuffer));
+	if (out->framebuffers.fbs == NULL)
+	{
+		return 0;
+	}
+
+	for (uint32_t i = 0; i < out->framebuffers.count; ++i)
+	{
+		VkImageView view = out->images.views[i];
+
+		if (lv_create_framebuffer(lv, out, view, &out->framebuffers.fbs[i]) != VK_SUCCESS)
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static int
+lv_output_create_commandbuffers(lv_state_s *lv, lv_output_s *out)
+{
+	out->commandbuffers.count = out->images.count;
+	out->commandbuffers.cbs   = calloc(out->commandbuffers.count, sizeof(VkCommandBuffer));
+	if (out->commandbuffers.cbs == NULL)
+	{
+		return 0;
+	}
+
+	// the render graphs they are recorded with, see lv_record_scene_graph()
+	out->graphs = calloc(LV_FRAMES_IN_FLIGHT + out->commandbuffers.count, sizeof(lv_graph_s));
+	if (out->graphs == NULL)
+	{
+		return 0;
+	}
+
+	VkCommandBufferAllocateInfo info = { 0 };
+	info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	info.commandPool        = lv->commandpool;
+	info.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	info.commandBufferCount = out->commandbuffers.count;
+
+	if (vkAllocateCommandBuffers(lv->device, &info, out->commandbuffers.cbs) != VK_SUCCESS)
+	{
+		return 0;
+	}
+
+	// outputs that track damage record one per frame instead, these
+	// outlive the swapchain
+	info.commandBufferCount = LV_FRAMES_IN_FLIGHT;
+	if (out->frame_cbs[0] == VK_NULL_HANDLE && vkAllocateCommandBuffers(lv->device, &info, out->frame_cbs) != VK_SUCCESS)
+	{
+		return 0;
+	}
+
+	return lv_output_record(lv, out);
+}
+
+static int
+lv_output_create_semaphores(lv_state_s *lv, lv_output_s *out)
+{
+	VkSemaphoreCreateInfo info = { 0 };
+	info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	for (uint32_t i = 0; i < LV_FRAMES_IN_FLIGHT; ++i)
+	{
+		if (vkCreateSemaphore(lv->device, &info, lv_allocator(), &out->image_available[i]) != VK_SUCCESS)
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * Returns the surface of the first output that has one, which is what the
+ * device is selected for and what picks the format of all outputs.
+ */
+VkSurfaceKHR lv_primary_surface(lv_state_s *lv)
+{
+	for (uint32_t i = 0; i < lv->output_count; ++i)
+	{
+		if (lv->outputs[i].used && lv->outputs[i].surface != VK_NULL_HANDLE)
+		{
+			return lv->outputs[i].surface;
+		}
+	}
+
+	return VK_NULL_HANDLE;
+}
+
+/*
+ * Creates whatever the output is missing and the state is ready for: the
+ * swapchain and depth and multisample attachments once there is a 
+ * device, framebuffers once there is a render pass (none with dynamic 
+ * rendering), command buffers once there is a pipeline, and so on. This
+ * way an output can be added at any point, before or after the 
+ * initialization.
+ */
+int lv_output_build(lv_state_s *lv, lv_output_s *out)
+{
+	if (out->surface == VK_NULL_HANDLE || lv->device == VK_NULL_HANDLE)
+	{
+		return 1;
+	}
+
+	if (lv->format.format == VK_FORMAT_UNDEFINED)
+	{
+		lv->format = lv_device_surface_get_format_by_index(lv->gpu, lv_primary_surface(lv), 0);
+	}
+
+	if (out->swapchain == VK_NULL_HANDLE && lv_output_create_swapchain(lv, out, VK_NULL_HANDLE) == 0)
+	{
+		return 0;
+	}
+
+	if (lv_output_create_attachments(lv, out) == 0)
+	{
+		return 0;
+	}
+
+	// dynamic rendering draws straight into the image views
+	if (lv->dynamic_rendering == 0)
+	{
+		if (lv->render_pass == VK_NULL_HANDLE)
+		{
+			return 1;
+		}
+
+		if (out->framebuffers.fbs == NULL && lv_output_create_framebuffers(lv, out) == 0)
+		{
+			return 0;
+		}
+	}
+
+	if (lv->commandpool == VK_NULL_HANDLE || lv->pipeline == VK_NULL_HANDLE)
+	{
+		return 1;
+	}
+
+	if (out->commandbuffers.cbs == NULL && lv_output_create_commandbuffers(lv, out) == 0)
+	{
+		return 0;
+	}
+
+	if (lv->frames[0].render_finished == VK_NULL_HANDLE)
+	{
+		return 1;
+	}
+
+	if (out->image_available[0] == VK_NULL_HANDLE && lv_output_create_semaphores(lv, out) == 0)
+	{
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * Retires what was made for the images of the swapchain and for its
+ * extent: framebuffers, their command buffers and render graphs, the
+ * views and the attachments. Dependents go first.
+ */
+static void
+lv_output_retire_images(lv_state_s *lv, lv_output_s *out)
+{
+	for (uint32_t i = 0; out->framebuffers.fbs != NULL && i < out->framebuffers.count; ++i)
+	{
+		lv_retire(lv, VK_OBJECT_TYPE_FRAMEBUFFER, (uint64_t) out->framebuffers.fbs[i]);
+	}
+
+	for (uint32_t i = 0; out->commandbuffers.cbs != NULL && i < out->commandbuffers.count; ++i)
+	{
+		lv_retire(lv, VK_OBJECT_TYPE_COMMAND_BUFFER, (uint64_t) (uintptr_t) out->commandbuffers.cbs[i]);
+	}
+
+	for (uint32_t i = 0; out->images.views != NULL && i < out->images.count; ++i)
+	{
+		lv_retire(lv, VK_OBJECT_TYPE_IMAGE_VIEW, (uint64_t) out->images.views[i]);
+	}
+
+	// the frame command buffers are recorded again before they are used
+	for (uint32_t i = 0; out->graphs != NULL && i < LV_FRAMES_IN_FLIGHT + out->commandbuffers.count; ++i)
+	{
+		lv_graph_free(lv, &out->graphs[i]);
+	}
+
+	lv_attachment_retire(lv, &out->depth);
+	lv_attachment_retire(lv, &out->msaa);
+
+	free(out->graphs);
+	out->graphs = NULL;
+	free(out->framebuffers.fbs);
+	free(out->commandbuffers.cbs);
+	free(out->images.images);
+	free(out->images.views);
+	memset(&out->framebuffers, 0, sizeof(lv_buffer_set_s));
+	memset(&out->commandbuffers, 0, sizeof(lv_buffer_set_s));
+	memset(&out->images, 0, sizeof(lv_image_set_s));
+}
+
+/*
+ * Replaces the swapchain of an output whose surface has changed, e.g.
+ * after a resize, along with everything made for its images. The old
+ * swapchain is handed to the new one as oldSwapchain and retired with
+ * the rest. Returns 0 if the output has no swapchain for now, like while
+ * its window is minimized; it is rebuilt again with the next frame.
+ */
+int lv_output_rebuild(lv_state_s *lv, lv_output_s *out)
+{
+	// the cached capabilities still have the old extent
+	lv_caps_invalidate_surface(out->surface);
+
+	VkExtent2D extent = lv_device_surface_get_capabilities(lv->gpu, out->surface).currentExtent;
+	if (extent.width == 0 || extent.height == 0)
+	{
+		return 0;
+	}
+
+	lv_output_retire_images(lv, out);
+
+	int enabled = out->damage.enabled;
+	lv_damage_free(out);
+	out->damage.enabled = enabled;
+
+	VkSwapchainKHR old = out->swapchain;
+	out->swapchain = VK_NULL_HANDLE;
+
+	int created = lv_output_create_swapchain(lv, out, old);
+	lv_retire(lv, VK_OBJECT_TYPE_SWAPCHAIN_KHR, (uint64_t) old);
+
+	lv_log(LV_LOG_DEBUG, "Output rebuilt at %ux%u", out->extent.width, out->extent.height);
+	return created && lv_output_build(lv, out);
+}
+
+/*
+ * Retires everything that belongs to the output, including its surface,
+ * and frees its slot. The objects are destroyed by lv_retire_collect()
+ * once the frames in flight are done with them, dependents first.
+ */
+void lv_output_destroy(lv_state_s *lv, lv_output_s *out)
+{
+	lv_output_retire_images(lv, out);
+
+	for (uint32_t i = 0; i < LV_FRAMES_IN_FLIGHT; ++i)
+	{
+		lv_retire(lv, VK_OBJECT_TYPE_COMMAND_BUFFER, (uint64_t) (uintptr_t) out->frame_cbs[i]);
+		lv_retire(lv, VK_OBJECT_TYPE_SEMAPHORE, (uint64_t) out->image_available[i]);
+	}
+
+	lv_retire(lv, VK_OBJECT_TYPE_SWAPCHAIN_KHR, (uint64_t) out->swapchain);
+	lv_retire(lv, VK_OBJECT_TYPE_SURFACE_KHR, (uint64_t) out->surface);
+
+	lv_damage_free(out);
+	memset(out, 0, sizeof(lv_output_s));
+}
+
+/*
+ * Builds every output for which the state is ready, see lv_output_build().
+ */
+int lv_outputs_build(lv_state_s *lv)
+{
+	int built = 1;
+
+	pthread_mutex_lock(&lv->outputs_lock);
+	for (uint32_t i = 0; i < lv->output_count; ++i)
+	{
+		if (lv->outputs[i].used && lv_output_build(lv, &lv->outputs[i]) == 0)
+		{
+			built = 0;
+		}
+	}
+	pthread_mutex_unlock(&lv->outputs_lock);
+
+	return built;
+}
+
+/*
+ * Creates the swapchains of all outputs, along with a view for each of
+ * their images. The first output decides the format of all of them.
+ */
+int lv_swapchain_create(lv_state_s *lv)
+{
+	return lv_outputs_build(lv);
+}
+
+int lv_create_framebuffers(lv_state_s *lv)
+{
+	return lv_outputs_build(lv);
+}
+
+/*
+ * Adds an output for `window` (which liblava only keeps for the caller)
+ * and returns its index, or -1 if all LV_MAX_OUTPUTS are taken. It is 
+ * drawn to once it has a surface, see lv_output_set_surface(). Safe to 
+ * call from any thread, also while frames are being drawn.
+ */
+int lv_output_add(lv_state_s *lv, void *window)
+{
+	int index = -1;
+
+	pthread_mutex_lock(&lv->outputs_lock);
+	for (uint32_t i = 0; i < LV_MAX_OUTPUTS; ++i)
+	{
+		if (lv->outputs[i].used == 0)
+		{
+			lv->outputs[i].used   = 1;
+			lv->outputs[i].window = window;
+			lv->output_count = i + 1 > lv->output_count ? i + 1 : lv->output_count;
+			index = i;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&lv->outputs_lock);
+
+	return index;
+}
+
+/*
+ * Hands the surface for an output to liblava, which destroys it along
+ * with the output. If the initialization is already done, the swapchain 
+ * and everything else is created right away.
+ */
+int lv_output_set_surface(lv_state_s *lv, int index, VkSurfaceKHR surface)
+{
+	if (index < 0 || index >= LV_MAX_OUTPUTS)
+	{
+		return 0;
+	}
+
+	pthread_mutex_lock(&lv->outputs_lock);
+	lv_output_s *out = &lv->outputs[index];
+	out->surface = surface;
+	int built = out->used && lv_output_build(lv, out);
+	pthread_mutex_unlock(&lv->outputs_lock);
+
+	return built;
+}
+
+/*
+ * Destroys the output and frees its slot for good.
+ */
+void lv_output_release(lv_state_s *lv, lv_output_s *out)
+{
+	VkSurfaceKHR surface = out->surface;
+	lv_output_destroy(lv, out);
+
+	while (lv->output_count > 0 && lv->outputs[lv->output_count - 1].used == 0)
+	{
+		--lv->output_count;
+	}
+
+	// the handle may be reused for a different surface
+	lv_caps_invalidate_surface(surface);
+}
+
+/*
+ * Destroys an output and its surface; the caller still owns the window.
+ * Nothing waits for the frame in flight, the output's objects are 
+ * retired and go once the GPU is done with them.
+ */
+int lv_output_remove(lv_state_s *lv, int index)
+{
+	if (index < 0 || index >= LV_MAX_OUTPUTS)
+	{
+		return 0;
+	}
+
+	pthread_mutex_lock(&lv->outputs_lock);
+	lv_output_s *out = &lv->outputs[index];
+	if (out->used == 0 || out->removed)
+	{
+		pthread_mutex_unlock(&lv->outputs_lock);
+		return 0;
+	}
+
+	// the frame being drawn holds an image of it, and removes it once it
+	// is done, see lv_draw_frame()
+	if (out->drawing)
+	{
+		out->removed = 1;
+	}
+	else
+	{
+		lv_output_release(lv, out);
+	}
+	pthread_mutex_unlock(&lv->outputs_lock);
+
+	return 1;
+}
+
+/*
+ * Tells liblava that the output's window has been resized: its swapchain
+ * is rebuilt before the next frame is drawn to it, which is asked for.
+ * Meant for the window system's framebuffer size callback.
+ */
+int lv_output_resize(lv_state_s *lv, int index)
+{
+	if (index < 0 || index >= LV_MAX_OUTPUTS)
+	{
+		return 0;
+	}
+
+	atomic_store(&lv->outputs[index].stale, 1);
+	return lv_output_damage(lv, index, NULL);
+}
+
+/*
+ * The getters below take outputs_lock, outputs may be added and removed
+ * by other threads. An index without an output gives NULL.
+ */
+uint32_t lv_output_count(lv_state_s *lv)
+{
+	pthread_mutex_lock(&lv->outputs_lock);
+	uint32_t count = lv->output_count;
+	pthread_mutex_unlock(&lv->outputs_lock);
+
+	return count;
+}
+
+void *lv_output_window(lv_state_s *lv, int index)
+{
+	if (index < 0 || index >= LV_MAX_OUTPUTS)
+	{
+		return NULL;
+	}
+
+	pthread_mutex_lock(&lv->outputs_lock);
+	void *window = lv->outputs[index].window;
+	pthread_mutex_unlock(&lv->outputs_lock);
+
+	return window;
+}
+
+VkSurfaceKHR lv_output_surface(lv_state_s *lv, int index)
+{
+	if (index < 0 || index >= LV_MAX_OUTPUTS)
+	{
+		return VK_NULL_HANDLE;
+	}
+
+	pthread_mutex_lock(&lv->outputs_lock);
+	VkSurfaceKHR surface = lv->outputs[index].surface;
+	pthread_mutex_unlock(&lv->outputs_lock);
+
+	return surface;
+}
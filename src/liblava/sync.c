@@ -0,0 +1,378 @@
+#include "internal.h"
+
+//
+// Synchronization on timeline semaphores: every queue owns one semaphore
+// whose value goes up by one with each submit. Waiting for a submit on
+// the CPU is a wait for its value, one queue waiting for another is a
+// semaphore wait on the other queue's value, and telling whether a
+// resource is still in use is an integer compare against the last value
+// known to be reached. No fences, no idle waits.
+//
+// Without timeline semaphores the values are still counted, but waits
+// fall back to idling the queue.
+//
+
+// semaphores a single submit can wait for or signal, besides the timeline
+#define LV_SYNC_MAX_SEMAPHORES (LV_MAX_OUTPUTS + 1)
+
+/*
+ * Creates the timeline semaphore of the given queue, starting at 0.
+ * Does nothing and returns 1 if the device has no timeline semaphores.
+ */
+int lv_timeline_create(lv_state_s *lv, lv_queue_s *queue)
+{
+	queue->submitted = 0;
+	queue->completed = 0;
+
+	if (lv->timeline_semaphores == 0)
+	{
+		return 1;
+	}
+
+	VkSemaphoreTypeCreateInfo type_info = { 0 };
+	type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	type_info.initialValue = 0;
+
+	VkSemaphoreCreateInfo info = { 0 };
+	info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	info.pNext = &type_info;
+
+	return vkCreateSemaphore(lv->device, &info, lv_allocator(), &queue->timeline) == VK_SUCCESS;
+}
+
+void lv_timeline_destroy(lv_state_s *lv, lv_queue_s *queue)
+{
+	vkDestroySemaphore(lv->device, queue->timeline, lv_allocator());
+	queue->timeline = VK_NULL_HANDLE;
+}
+
+/*
+ * Raises the value known to be reached, which other threads may be
+ * raising at the same time.
+ */
+static void
+lv_timeline_advance(lv_queue_s *queue, uint64_t value)
+{
+	uint64_t completed = atomic_load(&queue->completed);
+	while (value > completed && atomic_compare_exchange_weak(&queue->completed, &completed, value) == 0)
+	{
+		// completed has been reloaded, try again
+	}
+}
+
+static uint64_t
+lv_queue_submit_locked(lv_state_s *lv, lv_queue_s *queue, const VkSubmitInfo *submit,
+		const lv_queue_s *after, uint64_t after_value)
+{
+	if (lv->timeline_semaphores == 0)
+	{
+		if (vkQueueSubmit(queue->queue, 1, submit, VK_NULL_HANDLE) != VK_SUCCESS)
+		{
+			return 0;
+		}
+
+		return ++queue->submitted;
+	}
+
+	VkSemaphore          waits[LV_SYNC_MAX_SEMAPHORES + 1];
+	VkPipelineStageFlags wait_stages[LV_SYNC_MAX_SEMAPHORES + 1];
+	uint64_t             wait_values[LV_SYNC_MAX_SEMAPHORES + 1] = { 0 };
+	VkSemaphore          signals[LV_SYNC_MAX_SEMAPHORES + 1];
+	uint64_t             signal_values[LV_SYNC_MAX_SEMAPHORES + 1] = { 0 };
+
+	if (submit->waitSemaphoreCount > LV_SYNC_MAX_SEMAPHORES
+			|| submit->signalSemaphoreCount > LV_SYNC_MAX_SEMAPHORES)
+	{
+		lv_log(LV_LOG_ERROR, "Too many semaphores for one submit");
+		return 0;
+	}
+
+	// binary semaphores ignore their values, they only need to be there
+	uint32_t wait_count = submit->waitSemaphoreCount;
+	memcpy(waits, submit->pWaitSemaphores, sizeof(VkSemaphore) * wait_count);
+	memcpy(wait_stages, submit->pWaitDstStageMask, sizeof(VkPipelineStageFlags) * wait_count);
+
+	if (after != NULL && after->timeline != VK_NULL_HANDLE)
+	{
+		waits[wait_count]       = after->timeline;
+		wait_stages[wait_count] = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		wait_values[wait_count] = after_value;
+		++wait_count;
+	}
+
+	uint32_t signal_count = submit->signalSemaphoreCount;
+	memcpy(signals, submit->pSignalSemaphores, sizeof(VkSemaphore) * signal_count);
+
+	uint64_t value = queue->submitted + 1;
+	signals[signal_count]       = queue->timeline;
+	signal_values[signal_count] = value;
+	++signal_count;
+
+	VkTimelineSemaphoreSubmitInfo timeline_info = { 0 };
+	timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timeline_info.pNext = submit->pNext;
+	timeline_info.waitSemaphoreValueCount   = wait_count;
+	timeline_info.pWaitSemaphoreValues      = wait_values;
+	timeline_info.signalSemaphoreValueCount = signal_count;
+	timeline_info.pSignalSemaphoreValues    = signal_values;
+
+	VkSubmitInfo info = *submit;
+	info.pNext = &timeline_info;
+	info.waitSemaphoreCount   = wait_count;
+	info.pWaitSemaphores      = waits;
+	info.pWaitDstStageMask    = wait_stages;
+	info.signalSemaphoreCount = signal_count;
+	info.pSignalSemaphores    = signals;
+
+	if (vkQueueSubmit(queue->queue, 1, &info, VK_NULL_HANDLE) != VK_SUCCESS)
+	{
+		return 0;
+	}
+
+	queue->submitted = value;
+	return value;
+}
+
+/*
+ * Submits to the queue and signals its timeline with the next value. If
+ * after is given, the submit also waits for that queue's timeline to
+ * reach after_value before any of its commands run. Returns the value
+ * the submit signals, or 0 if it failed. Safe to call from any thread.
+ */
+uint64_t lv_queue_submit(lv_state_s *lv, lv_queue_s *queue, const VkSubmitInfo *submit,
+		const lv_queue_s *after, uint64_t after_value)
+{
+	pthread_mutex_lock(&lv->submit_lock);
+	uint64_t value = lv_queue_submit_locked(lv, queue, submit, after, after_value);
+	pthread_mutex_unlock(&lv->submit_lock);
+
+	return value;
+}
+
+/*
+ * Presents on the present queue, which may be the graphics queue that
+ * uploads submit to from other threads.
+ */
+VkResult lv_queue_present(lv_state_s *lv, const VkPresentInfoKHR *info)
+{
+	pthread_mutex_lock(&lv->submit_lock);
+	VkResult result = vkQueuePresentKHR(lv->pqueue.queue, info);
+	pthread_mutex_unlock(&lv->submit_lock);
+
+	return result;
+}
+
+/*
+ * Returns the highest value the queue's timeline has reached, asking the
+ * device. Also updates queue->completed.
+ */
+uint64_t lv_timeline_completed(lv_state_s *lv, lv_queue_s *queue)
+{
+	uint64_t value = 0;
+
+	if (lv->timeline_semaphores
+			&& lv->get_semaphore_counter(lv->device, queue->timeline, &value) == VK_SUCCESS)
+	{
+		lv_timeline_advance(queue, value);
+	}
+
+	return queue->completed;
+}
+
+/*
+ * Returns 1 if the submit that signalled the given value has finished.
+ * Only asks the device if the last known value is not high enough yet.
+ */
+int lv_timeline_reached(lv_state_s *lv, lv_queue_s *queue, uint64_t value)
+{
+	if (value <= queue->completed)
+	{
+		return 1;
+	}
+
+	return value <= lv_timeline_completed(lv, queue);
+}
+
+/*
+ * Blocks until the queue's timeline reaches the given value or the
+ * timeout (in nanoseconds) runs out. Returns 1 if the value was reached.
+ * Without timeline semaphores, waits for the queue to go idle instead.
+ */
+int lv_timeline_wait(lv_state_s *lv, lv_queue_s *queue, uint64_t value, uint64_t timeout)
+{
+	if (value <= queue->completed)
+	{
+		return 1;
+	}
+
+	if (lv->timeline_semaphores == 0)
+	{
+		// the queue has to be kept from submits while it is waited for
+		pthread_mutex_lock(&lv->submit_lock);
+		VkResult idle = vkQueueWaitIdle(queue->queue);
+		uint64_t submitted = queue->submitted;
+		pthread_mutex_unlock(&lv->submit_lock);
+
+		if (idle != VK_SUCCESS)
+		{
+			return 0;
+		}
+
+		lv_timeline_advance(queue, submitted);
+		return 1;
+	}
+
+	VkSemaphoreWaitInfo info = { 0 };
+	info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	info.semaphoreCount = 1;
+	info.pSemaphores = &queue->timeline;
+	info.pValues = &value;
+
+	if (lv->wait_semaphores(lv->device, &info, timeout) != VK_SUCCESS)
+	{
+		return 0;
+	}
+
+	lv_timeline_advance(queue, value);
+	return 1;
+}
+
+/*
+ * Destroys a single retired object.
+ */
+static void
+lv_retired_destroy(lv_state_s *lv, const lv_retired_s *obj)
+{
+	switch (obj->type)
+	{
+		case VK_OBJECT_TYPE_PIPELINE:
+			vkDestroyPipeline(lv->device, (VkPipeline) obj->handle, lv_allocator());
+			break;
+		case VK_OBJECT_TYPE_FRAMEBUFFER:
+			vkDestroyFramebuffer(lv->device, (VkFramebuffer) obj->handle, lv_allocator());
+			break;
+		case VK_OBJECT_TYPE_IMAGE_VIEW:
+			vkDestroyImageView(lv->device, (VkImageView) obj->handle, lv_allocator());
+			break;
+		case VK_OBJECT_TYPE_IMAGE:
+			vkDestroyImage(lv->device, (VkImage) obj->handle, lv_allocator());
+			break;
+		case VK_OBJECT_TYPE_BUFFER:
+			vkDestroyBuffer(lv->device, (VkBuffer) obj->handle, lv_allocator());
+			break;
+		case VK_OBJECT_TYPE_DEVICE_MEMORY:
+			vkFreeMemory(lv->device, (VkDeviceMemory) obj->handle, lv_allocator());
+			break;
+		case VK_OBJECT_TYPE_SEMAPHORE:
+			vkDestroySemaphore(lv->device, (VkSemaphore) obj->handle, lv_allocator());
+			break;
+		case VK_OBJECT_TYPE_COMMAND_BUFFER:
+		{
+			// all of them come from the outputs' command pool
+			VkCommandBuffer cb = (VkCommandBuffer) (uintptr_t) obj->handle;
+			vkFreeCommandBuffers(lv->device, lv->commandpool, 1, &cb);
+			break;
+		}
+		case VK_OBJECT_TYPE_COMMAND_POOL:
+			// along with the command buffers allocated from it
+			vkDestroyCommandPool(lv->device, (VkCommandPool) obj->handle, lv_allocator());
+			break;
+		case VK_OBJECT_TYPE_SWAPCHAIN_KHR:
+			vkDestroySwapchainKHR(lv->device, (VkSwapchainKHR) obj->handle, lv_allocator());
+			break;
+		case VK_OBJECT_TYPE_SURFACE_KHR:
+			vkDestroySurfaceKHR(lv->instance, (VkSurfaceKHR) obj->handle, lv_allocator());
+			break;
+		default:
+			lv_log(LV_LOG_ERROR, "Can not destroy retired object of type %d", obj->type);
+			break;
+	}
+}
+
+/*
+ * Hands an object that is no longer used for new work to the retire 
+ * queue. It is destroyed by lv_retire_collect() once everything that 
+ * has been submitted so far is done with it. Objects retired together 
+ * are destroyed in the order they were retired. Returns 0 if out of 
+ * memory, in which case the object has been destroyed after waiting for
+ * the device to go idle.
+ */
+int lv_retire(lv_state_s *lv, VkObjectType type, uint64_t handle)
+{
+	if (handle == 0)
+	{
+		return 1;
+	}
+
+	lv_retired_s obj = { type, handle, lv->gqueue.submitted };
+
+	pthread_mutex_lock(&lv->retired_lock);
+	if (lv->retired_count == lv->retired_capacity)
+	{
+		uint32_t capacity = lv->retired_capacity ? lv->retired_capacity * 2 : 64;
+		lv_retired_s *grown = realloc(lv->retired, sizeof(lv_retired_s) * capacity);
+
+		if (grown == NULL)
+		{
+			pthread_mutex_unlock(&lv->retired_lock);
+			vkDeviceWaitIdle(lv->device);
+			lv_retired_destroy(lv, &obj);
+			return 0;
+		}
+
+		lv->retired = grown;
+		lv->retired_capacity = capacity;
+	}
+
+	lv->retired[lv->retired_count++] = obj;
+	pthread_mutex_unlock(&lv->retired_lock);
+
+	return 1;
+}
+
+/*
+ * Destroys the retired objects the graphics queue is done with, meant to
+ * be called once per frame. Returns how many were destroyed.
+ */
+uint32_t lv_retire_collect(lv_state_s *lv)
+{
+	pthread_mutex_lock(&lv->retired_lock);
+
+	// values only go up, so the ones that can go are at the front
+	uint32_t count = 0;
+	while (count < lv->retired_count && lv_timeline_reached(lv, &lv->gqueue, lv->retired[count].value))
+	{
+		lv_retired_destroy(lv, &lv->retired[count]);
+		++count;
+	}
+
+	lv->retired_count -= count;
+	memmove(lv->retired, lv->retired + count, sizeof(lv_retired_s) * lv->retired_count);
+	pthread_mutex_unlock(&lv->retired_lock);
+
+	return count;
+}
+
+/*
+ * Waits for the device to go idle and destroys every retired object.
+ */
+void lv_retire_flush(lv_state_s *lv)
+{
+	if (lv->device != VK_NULL_HANDLE)
+	{
+		vkDeviceWaitIdle(lv->device);
+	}
+
+	pthread_mutex_lock(&lv->retired_lock);
+	for (uint32_t i = 0; i < lv->retired_count; ++i)
+	{
+		lv_retired_destroy(lv, &lv->retired[i]);
+	}
+
+	free(lv->retired);
+	lv->retired = NULL;
+	lv->retired_count = 0;
+	lv->retired_capacity = 0;
+	pthread_mutex_unlock(&lv->retired_lock);
+}
@@ -0,0 +1,126 @@
+#include "internal.h"
+
+//
+// Buffers the CPU fills every frame, like the world matrices of a scene,
+// in host visible memory that stays mapped. Each has LV_UPLOAD_FRAMES
+// slices, so the CPU writes one while the GPU still reads the others;
+// lv_upload_next() waits on the graphics queue's timeline until the next
+// one is free again. Memory that is device local as well is preferred,
+// as on integrated GPUs or with resizable BAR, so the GPU reads it where
+// it is instead of across the bus.
+//
+
+/*
+ * Creates a buffer with memory of its own that has all of `props`.
+ */
+int lv_buffer_create(lv_state_s *lv, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags props,
+		VkBuffer *buffer, VkDeviceMemory *memory)
+{
+	VkBufferCreateInfo info = { 0 };
+	info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	info.size  = size;
+	info.usage = usage;
+	info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(lv->device, &info, lv_allocator(), buffer) != VK_SUCCESS)
+	{
+		return 0;
+	}
+
+	VkMemoryRequirements req;
+	vkGetBufferMemoryRequirements(lv->device, *buffer, &req);
+
+	VkMemoryAllocateInfo alloc = { 0 };
+	alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	alloc.allocationSize = req.size;
+
+	if (lv_device_memory_type(lv->gpu, req.memoryTypeBits, props, &alloc.memoryTypeIndex) == 0 ||
+			vkAllocateMemory(lv->device, &alloc, lv_allocator(), memory) != VK_SUCCESS)
+	{
+		vkDestroyBuffer(lv->device, *buffer, lv_allocator());
+		*buffer = VK_NULL_HANDLE;
+		return 0;
+	}
+
+	if (vkBindBufferMemory(lv->device, *buffer, *memory, 0) != VK_SUCCESS)
+	{
+		vkFreeMemory(lv->device, *memory, lv_allocator());
+		vkDestroyBuffer(lv->device, *buffer, lv_allocator());
+		*buffer = VK_NULL_HANDLE;
+		*memory = VK_NULL_HANDLE;
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * Creates an upload buffer with slices of at least `size` bytes, aligned
+ * so each can be bound as a uniform or storage buffer of its own.
+ */
+int lv_upload_create(lv_state_s *lv, VkDeviceSize size, VkBufferUsageFlags usage, lv_upload_s *upload)
+{
+	memset(upload, 0, sizeof(lv_upload_s));
+
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(lv->gpu, &props);
+
+	VkDeviceSize align = props.limits.minUniformBufferOffsetAlignment;
+	if (props.limits.minStorageBufferOffsetAlignment > align)
+	{
+		align = props.limits.minStorageBufferOffsetAlignment;
+	}
+	upload->slice_size = (size + align - 1) / align * align;
+
+	const VkMemoryPropertyFlags host = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	VkDeviceSize total = upload->slice_size * LV_UPLOAD_FRAMES;
+
+	if (lv_buffer_create(lv, total, usage, host | VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &upload->buffer, &upload->memory) == 0 &&
+			lv_buffer_create(lv, total, usage, host, &upload->buffer, &upload->memory) == 0)
+	{
+		return 0;
+	}
+
+	void *map = NULL;
+	if (vkMapMemory(lv->device, upload->memory, 0, VK_WHOLE_SIZE, 0, &map) != VK_SUCCESS)
+	{
+		lv_upload_destroy(lv, upload);
+		return 0;
+	}
+
+	upload->map = map;
+	return 1;
+}
+
+/*
+ * Moves on to the next slice and returns it, once the GPU is done with
+ * it. The one written before is taken to be read by the last submit, so
+ * this is called once per frame, on the thread that draws it, before
+ * anything is written for it.
+ */
+void *lv_upload_next(lv_state_s *lv, lv_upload_s *upload)
+{
+	upload->used[upload->frame] = lv->gqueue.submitted;
+	upload->frame = (upload->frame + 1) % LV_UPLOAD_FRAMES;
+
+	lv_timeline_wait(lv, &lv->gqueue, upload->used[upload->frame], UINT64_MAX);
+	return upload->map + upload->slice_size * upload->frame;
+}
+
+/*
+ * Returns the offset of the current slice in the buffer.
+ */
+VkDeviceSize lv_upload_offset(const lv_upload_s *upload)
+{
+	return upload->slice_size * upload->frame;
+}
+
+/*
+ * Retires the buffer and its memory, which is unmapped when it is freed.
+ */
+void lv_upload_destroy(lv_state_s *lv, lv_upload_s *upload)
+{
+	lv_retire(lv, VK_OBJECT_TYPE_BUFFER, (uint64_t) upload->buffer);
+	lv_retire(lv, VK_OBJECT_TYPE_DEVICE_MEMORY, (uint64_t) upload->memory);
+	memset(upload, 0, sizeof(lv_upload_s));
+}
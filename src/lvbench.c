@@ -0,0 +1,518 @@
+#include <math.h>		// sinf(), cosf()
+#include <stdio.h>		// printf(), ...
+#include <stdlib.h>		// atoi(), ...
+#include <string.h>		// strcmp(), ...
+
+#include <vulkan/vulkan.h>
+#include "liblava/liblava.h"
+
+//
+// Measures what the job system costs per job: empty jobs submitted in
+// batches from the main thread, a tree of jobs that fork and join on the
+// workers, and a parallel for over small ranges. Compared to calling the
+// same function directly.
+//
+// With "vertices", compares the float vertex layout of a mesh written by
+// lvmesh to the quantized one: how big both are, how fast the vertices
+// quantize, and how fast all cores gather them through the index buffer
+// the way vertex fetch does, which is bound by memory bandwidth just the
+// same on an integrated GPU.
+//
+// With "scene", updates the world matrices of a forest of nodes, four
+// children each, into rotating output slices the way a frame would: all
+// of them moved, a few moved and none moved.
+//
+// With "draws", sorts a frame's worth of draws with random pipelines,
+// materials, meshes and depths by their keys, and counts the binds
+// recording them would take in that order and in the order added.
+//
+// Usage: lvbench [WORKERS] [JOBS]
+//        lvbench vertices MESH
+//        lvbench scene [NODES]
+//        lvbench draws [DRAWS]
+//
+
+#define BENCH_BATCH 1024	// jobs per lv_jobs_run(), well within a deque
+#define BENCH_DEPTH 16		// of the fork/join tree, 2^16 - 1 jobs
+
+#define FETCH_BATCH   65536	// indices per job
+#define FETCH_REPEATS 10
+
+#define SCENE_ROOTS    64
+#define SCENE_CHILDREN 4
+#define SCENE_FRAMES   30	// per case, one slice each in turn
+#define SCENE_MOVED    64	// nodes moved per frame in the partial case
+
+#define DRAW_PIPELINES 16
+#define DRAW_MATERIALS 512
+#define DRAW_MESHES    256
+#define DRAW_REPEATS   20
+
+/*
+ * A vertex layout as the GPU would read it, see fetch_job().
+ */
+struct fetch
+{
+	const void  *indices;
+	uint32_t     index_count;
+	int          short_indices;
+	const void  *streams[LV_MESH_MAX_STREAMS];
+	uint32_t     formats[LV_MESH_MAX_STREAMS];	// VkFormat
+	uint32_t     stream_count;
+	uint32_t     vertex_size;	// of all streams
+	float       *sums;		// per batch
+};
+
+typedef struct fetch fetch_s;
+
+struct tree_node
+{
+	lv_jobs_s *jobs;
+	int        depth;
+};
+
+typedef struct tree_node tree_node_s;
+
+static void
+empty_job(void *arg)
+{
+	// keep the call from being optimized away
+	__asm__ volatile("" : : "r" (arg) : "memory");
+}
+
+static void
+tree_job(void *arg)
+{
+	tree_node_s *node = arg;
+	if (node->depth == 1)
+	{
+		return;
+	}
+
+	tree_node_s children[2] = { { node->jobs, node->depth - 1 }, { node->jobs, node->depth - 1 } };
+	lv_job_s    list[2]     = { { tree_job, &children[0], NULL }, { tree_job, &children[1], NULL } };
+
+	lv_job_counter_s counter = { 0 };
+	lv_jobs_run(node->jobs, list, 2, &counter);
+	lv_jobs_wait(node->jobs, &counter);
+}
+
+static void
+range_job(void *arg, uint32_t begin, uint32_t end)
+{
+	for (uint32_t i = begin; i < end; ++i)
+	{
+		empty_job(arg);
+	}
+}
+
+static void
+report(const char *name, double ms, uint32_t count)
+{
+	printf("%-24s %9u jobs %10.3f ms %9.1f ns/job\n", name, count, ms, ms * 1000000.0 / count);
+}
+
+static uint32_t
+fetch_index(const fetch_s *f, uint32_t i)
+{
+	return f->short_indices ? ((const uint16_t *) f->indices)[i] : ((const uint32_t *) f->indices)[i];
+}
+
+/*
+ * Reads the vertices of a range of batches, every stream through the
+ * indices, and adds up their components. Quantized ones are added up as
+ * integers: turning them into floats is done by the vertex input, for
+ * free, and costs more than the read on a CPU.
+ */
+static void
+fetch_job(void *arg, uint32_t begin, uint32_t end)
+{
+	fetch_s *f = arg;
+
+	for (uint32_t b = begin; b < end; ++b)
+	{
+		uint32_t first = b * FETCH_BATCH;
+		uint32_t last  = first + FETCH_BATCH < f->index_count ? first + FETCH_BATCH : f->index_count;
+		float sum = 0.0f;
+		int64_t raw = 0;
+
+		for (uint32_t s = 0; s < f->stream_count; ++s)
+		{
+			switch (f->formats[s])
+			{
+				case VK_FORMAT_R32G32B32_SFLOAT:
+					for (uint32_t i = first; i < last; ++i)
+					{
+						const float *v = (const float *) f->streams[s] + fetch_index(f, i) * 3;
+						sum += v[0] + v[1] + v[2];
+					}
+					break;
+				case VK_FORMAT_R32G32_SFLOAT:
+					for (uint32_t i = first; i < last; ++i)
+					{
+						const float *v = (const float *) f->streams[s] + fetch_index(f, i) * 2;
+						sum += v[0] + v[1];
+					}
+					break;
+				case VK_FORMAT_R16G16B16A16_UNORM:
+					for (uint32_t i = first; i < last; ++i)
+					{
+						const uint16_t *v = (const uint16_t *) f->streams[s] + fetch_index(f, i) * 4;
+						raw += v[0] + v[1] + v[2];
+					}
+					break;
+				case VK_FORMAT_R8G8_SNORM:
+					for (uint32_t i = first; i < last; ++i)
+					{
+						const int8_t *v = (const int8_t *) f->streams[s] + fetch_index(f, i) * 2;
+						raw += v[0] + v[1];
+					}
+					break;
+				case VK_FORMAT_R16G16_SFLOAT:
+					for (uint32_t i = first; i < last; ++i)
+					{
+						const uint16_t *v = (const uint16_t *) f->streams[s] + fetch_index(f, i) * 2;
+						raw += v[0] + v[1];
+					}
+					break;
+			}
+		}
+
+		f->sums[b] = sum + (float) raw;
+	}
+}
+
+/*
+ * Gathers all vertices of the layout a few times on all cores and prints
+ * the best time.
+ */
+static void
+fetch_report(const char *name, lv_jobs_s *jobs, fetch_s *f, uint32_t vertex_count)
+{
+	uint32_t batches = (f->index_count + FETCH_BATCH - 1) / FETCH_BATCH;
+	double best = 0.0;
+
+	for (int r = 0; r < FETCH_REPEATS; ++r)
+	{
+		double start = lv_time_ms();
+		lv_jobs_parallel_for(jobs, batches, 1, fetch_job, f);
+		double ms = lv_time_ms() - start;
+		best = r == 0 || ms < best ? ms : best;
+	}
+
+	double sum = 0.0;
+	for (uint32_t b = 0; b < batches; ++b)
+	{
+		sum += f->sums[b];
+	}
+
+	printf("%-10s %3u bytes/vertex %8.2f MB %9.3f ms %8.1f Mvertices/s %7.2f GB/s (sum %g)\n", name,
+			f->vertex_size, (double) f->vertex_size * vertex_count / (1024.0 * 1024.0), best,
+			f->index_count / best / 1000.0, (double) f->vertex_size * f->index_count / best / 1000000.0, sum);
+}
+
+/*
+ * Quantizes the float streams of a mesh file and compares both layouts.
+ */
+static int
+bench_vertices(const char *path)
+{
+	lv_mesh_file_s file;
+	if (lv_mesh_open(path, &file) == 0)
+	{
+		fprintf(stderr, "Not a mesh file: %s\n", path);
+		return EXIT_FAILURE;
+	}
+
+	const lv_mesh_header_s *header = file.header;
+	uint32_t count = header->vertex_count;
+	uint32_t batches = (header->index_count + FETCH_BATCH - 1) / FETCH_BATCH;
+
+	fetch_s floats = { 0 };
+	floats.indices       = (const char *) file.map + header->index_offset;
+	floats.index_count   = header->index_count;
+	floats.short_indices = header->index_type == VK_INDEX_TYPE_UINT16;
+	floats.stream_count  = header->stream_count;
+	floats.sums          = calloc(batches, sizeof(float));
+
+	fetch_s quantized = floats;
+	quantized.sums = calloc(batches, sizeof(float));
+
+	void *encoded[LV_MESH_MAX_STREAMS] = { 0 };
+	double encode_ms = 0.0;
+
+	for (uint32_t s = 0; s < header->stream_count; ++s)
+	{
+		const lv_mesh_stream_s *stream = &header->streams[s];
+		const float *data = (const float *) ((const char *) file.map + stream->offset);
+
+		floats.streams[s] = data;
+		floats.formats[s] = stream->format;
+		floats.vertex_size += stream->stride;
+
+		if (stream->format != (stream->attribute == LV_MESH_UV ? VK_FORMAT_R32G32_SFLOAT : VK_FORMAT_R32G32B32_SFLOAT))
+		{
+			fprintf(stderr, "Already quantized, convert without -q: %s\n", path);
+			return EXIT_FAILURE;
+		}
+
+		uint32_t size = stream->attribute == LV_MESH_POSITION ? 8 : (stream->attribute == LV_MESH_NORMAL ? 2 : 4);
+		encoded[s] = malloc((size_t) count * size);
+		if (encoded[s] == NULL || floats.sums == NULL || quantized.sums == NULL)
+		{
+			fprintf(stderr, "Out of memory\n");
+			return EXIT_FAILURE;
+		}
+
+		// touched first, so the encoder isn't timed on page faults
+		memset(encoded[s], 0xff, (size_t) count * size);
+
+		double start = lv_time_ms();
+		switch (stream->attribute)
+		{
+			case LV_MESH_POSITION:
+				lv_quantize_positions(data, count, header->min, header->max, encoded[s]);
+				quantized.formats[s] = VK_FORMAT_R16G16B16A16_UNORM;
+				break;
+			case LV_MESH_NORMAL:
+				lv_quantize_normals(data, count, encoded[s]);
+				quantized.formats[s] = VK_FORMAT_R8G8_SNORM;
+				break;
+			default:
+				lv_quantize_uvs(data, count, encoded[s]);
+				quantized.formats[s] = VK_FORMAT_R16G16_SFLOAT;
+				break;
+		}
+		encode_ms += lv_time_ms() - start;
+
+		quantized.streams[s] = encoded[s];
+		quantized.vertex_size += size;
+	}
+
+	printf("%u vertices, %u indices, %u streams\n", count, header->index_count, header->stream_count);
+	printf("%-10s %9.3f ms %8.1f Mvertices/s\n", "quantize", encode_ms, count / encode_ms / 1000.0);
+
+	lv_jobs_s *jobs = lv_jobs_create(0);
+	fetch_report("float", jobs, &floats, count);
+	fetch_report("quantized", jobs, &quantized, count);
+	lv_jobs_free(jobs);
+
+	for (uint32_t s = 0; s < header->stream_count; ++s)
+	{
+		free(encoded[s]);
+	}
+	free(quantized.sums);
+	free(floats.sums);
+	lv_mesh_close(&file);
+
+	return EXIT_SUCCESS;
+}
+
+/*
+ * Moves `moved` nodes, at random unless it is all of them, and updates
+ * the scene, for a number of frames.
+ */
+static void
+scene_report(const char *name, lv_scene_s *scene, lv_jobs_s *jobs, uint32_t moved, float **slices, uint64_t *written)
+{
+	uint32_t count = lv_scene_count(scene);
+	const float scale[3] = { 1.0f, 1.0f, 1.0f };
+	double best = 1e30;
+	uint32_t computed = 0;
+
+	for (uint32_t frame = 0; frame < SCENE_FRAMES; ++frame)
+	{
+		float angle = (float) frame * 0.01f;
+		float translation[3] = { angle, 0.0f, 1.0f };
+		float rotation[4] = { 0.0f, sinf(angle), 0.0f, cosf(angle) };
+
+		for (uint32_t i = 0; i < moved; ++i)
+		{
+			uint32_t node = moved < count ? (uint32_t) rand() % count : i;
+			lv_scene_set(scene, node, translation, rotation, scale);
+		}
+
+		uint32_t slice = frame % LV_UPLOAD_FRAMES;
+		double start = lv_time_ms();
+		computed = lv_scene_update(scene, jobs, slices[slice], &written[slice]);
+		double ms = lv_time_ms() - start;
+		best = ms < best ? ms : best;
+	}
+
+	printf("%-12s %9u computed %10.3f ms %10.1f transforms/ms\n", name, computed, best, count / best);
+}
+
+/*
+ * Times lv_scene_update() on a forest of `count` nodes.
+ */
+static int
+bench_scene(uint32_t count)
+{
+	lv_scene_s *scene = lv_scene_create(count);
+	float *slices[LV_UPLOAD_FRAMES] = { 0 };
+	uint64_t written[LV_UPLOAD_FRAMES] = { 0 };
+
+	for (int k = 0; k < LV_UPLOAD_FRAMES; ++k)
+	{
+		slices[k] = malloc(sizeof(float) * 16 * count);
+		if (slices[k] == NULL)
+		{
+			fprintf(stderr, "Out of memory\n");
+			return EXIT_FAILURE;
+		}
+
+		// touched first, so the update isn't timed on page faults
+		memset(slices[k], 0, sizeof(float) * 16 * count);
+	}
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		uint32_t parent = i < SCENE_ROOTS ? LV_SCENE_NONE : (i - SCENE_ROOTS) / SCENE_CHILDREN;
+		if (scene == NULL || lv_scene_add(scene, parent) == LV_SCENE_NONE)
+		{
+			fprintf(stderr, "Could not create the scene\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	lv_jobs_s *jobs = lv_jobs_create(0);
+	printf("%u nodes, %u threads\n", count, lv_jobs_threads(jobs));
+
+	scene_report("all moved", scene, jobs, count, slices, written);
+	scene_report("few moved", scene, jobs, SCENE_MOVED, slices, written);
+	scene_report("none moved", scene, jobs, 0, slices, written);
+
+	lv_jobs_free(jobs);
+	lv_scene_free(scene);
+	for (int k = 0; k < LV_UPLOAD_FRAMES; ++k)
+	{
+		free(slices[k]);
+	}
+
+	return EXIT_SUCCESS;
+}
+
+/*
+ * Times lv_draws_sort() on `count` random draws.
+ */
+static int
+bench_draws(uint32_t count)
+{
+	static lv_mesh_s meshes[DRAW_MESHES];
+	lv_draw_list_s list;
+	lv_draws_init(&list);
+
+	srand(1);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		uint32_t pipeline = (uint32_t) rand() % DRAW_PIPELINES;
+		uint32_t material = (uint32_t) rand() % DRAW_MATERIALS;
+
+		// only compared, never bound
+		lv_draw_s draw = { 0 };
+		draw.pipeline = (VkPipeline) (uintptr_t) (pipeline + 1);
+		draw.material = (VkDescriptorSet) (uintptr_t) (material + 1);
+		draw.mesh     = &meshes[rand() % DRAW_MESHES];
+		draw.key      = lv_draw_key(0, pipeline, material, (float) rand() / (float) RAND_MAX);
+
+		if (lv_draws_add(&list, &draw) == 0)
+		{
+			fprintf(stderr, "Out of memory\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	double best = 1e30;
+	for (int r = 0; r < DRAW_REPEATS; ++r)
+	{
+		lv_draws_sort(&list);
+		best = list.stats.sort_ms < best ? list.stats.sort_ms : best;
+	}
+
+	printf("%u draws, %d pipelines, %d materials, %d meshes\n", count, DRAW_PIPELINES, DRAW_MATERIALS, DRAW_MESHES);
+	printf("%-10s %9.3f ms %10.1f Mdraws/s\n", "sort", best, count / best / 1000.0);
+	printf("%-10s %9u binds\n", "sorted", list.stats.binds);
+	printf("%-10s %9u binds\n", "unsorted", list.stats.binds_unsorted);
+
+	lv_draws_free(&list);
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc == 3 && strcmp(argv[1], "vertices") == 0)
+	{
+		return bench_vertices(argv[2]);
+	}
+
+	if (argc >= 2 && strcmp(argv[1], "scene") == 0)
+	{
+		return bench_scene(argc > 2 ? (uint32_t) atoi(argv[2]) : 1 << 17);
+	}
+
+	if (argc >= 2 && strcmp(argv[1], "draws") == 0)
+	{
+		return bench_draws(argc > 2 ? (uint32_t) atoi(argv[2]) : 50000);
+	}
+
+	uint32_t workers = argc > 1 ? (uint32_t) atoi(argv[1]) : 0;
+	uint32_t count   = argc > 2 ? (uint32_t) atoi(argv[2]) : 1 << 20;
+	count = (count + BENCH_BATCH - 1) / BENCH_BATCH * BENCH_BATCH;
+
+	lv_jobs_s *jobs = lv_jobs_create(workers);
+	if (jobs == NULL)
+	{
+		fprintf(stderr, "Could not create the job system\n");
+		return EXIT_FAILURE;
+	}
+
+	lv_job_s *list = calloc(count, sizeof(lv_job_s));
+	if (list == NULL)
+	{
+		fprintf(stderr, "Out of memory\n");
+		return EXIT_FAILURE;
+	}
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		list[i].fn  = empty_job;
+		list[i].arg = &list[i];
+	}
+
+	printf("%u threads\n", lv_jobs_threads(jobs));
+
+	double start = lv_time_ms();
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		list[i].fn(list[i].arg);
+	}
+	report("direct call", lv_time_ms() - start, count);
+
+	// one batch at a time, waited for before the next
+	start = lv_time_ms();
+	for (uint32_t i = 0; i < count; i += BENCH_BATCH)
+	{
+		lv_job_counter_s counter = { 0 };
+		lv_jobs_run(jobs, &list[i], BENCH_BATCH, &counter);
+		lv_jobs_wait(jobs, &counter);
+	}
+	report("batches of empty jobs", lv_time_ms() - start, count);
+
+	// every job but the leaves forks two and joins them
+	tree_node_s root = { jobs, BENCH_DEPTH };
+	lv_job_s root_job = { tree_job, &root, NULL };
+	start = lv_time_ms();
+	lv_job_counter_s counter = { 0 };
+	lv_jobs_run(jobs, &root_job, 1, &counter);
+	lv_jobs_wait(jobs, &counter);
+	report("nested fork/join", lv_time_ms() - start, (1u << BENCH_DEPTH) - 1);
+
+	start = lv_time_ms();
+	lv_jobs_parallel_for(jobs, count, 64, range_job, list);
+	report("parallel for, 64 a job", lv_time_ms() - start, count / 64);
+
+	free(list);
+	lv_jobs_free(jobs);
+
+	return EXIT_SUCCESS;
+}
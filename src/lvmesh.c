@@ -0,0 +1,717 @@
+#include <stdio.h>		// fopen(), fwrite(), ...
+#include <stdlib.h>		// malloc(), strtof(), ...
+#include <string.h>		// memcmp(), memset(), ...
+#include <float.h>		// FLT_MAX
+#include <sys/stat.h>		// fstat(), struct stat
+
+#include <vulkan/vulkan.h>
+#include "liblava/liblava.h"
+
+//
+// Converts a Wavefront OBJ file into a mesh file that can be loaded by
+// lv_mesh_open(). Faces are triangulated as fans, every object, group
+// and material change starts a submesh of its own. Vertices are shared
+// within a submesh wherever position, normal and texture coordinate all
+// match. Normals and texture coordinates are only stored if the file has
+// any.
+//
+// Every submesh gets up to LEVELS detail levels, the full one included,
+// each with about a quarter of the triangles of the one before, and every
+// level is split into meshlets, see cluster.c. Both run on all cores.
+//
+// With -q the vertices are quantized, see lv_mesh_attribute_e, which
+// takes them from up to 32 bytes down to 14.
+//
+// Usage: lvmesh [-q] [-l LEVELS] MESH FILE.obj
+//
+
+// a level has to lose this much of the one before to be kept
+#define LOD_REDUCTION 0.8f
+#define LOD_ATTEMPTS  4
+
+struct growable
+{
+	void   *data;
+	size_t  count;
+	size_t  capacity;
+	size_t  size;		// of one element
+};
+
+typedef struct growable growable_s;
+
+/*
+ * A vertex of a face, indices into the position, normal and texture
+ * coordinate lists, each 0 if it has none.
+ */
+struct corner
+{
+	uint32_t v;
+	uint32_t vt;
+	uint32_t vn;
+};
+
+typedef struct corner corner_s;
+
+struct mesh
+{
+	growable_s positions;	// float[3], as read from the file
+	growable_s normals;
+	growable_s uvs;		// float[2]
+	growable_s corners;	// corner_s, one per output vertex
+	growable_s indices;	// uint32_t
+	growable_s submeshes;	// lv_mesh_submesh_s
+	growable_s lods;	// lv_mesh_lod_s
+	growable_s meshlets;	// lv_meshlet_s
+	uint32_t  *buckets;	// corner hash -> output vertex + 1, per submesh
+	uint32_t   bucket_count;
+};
+
+typedef struct mesh mesh_s;
+
+static size_t align_up(size_t value, size_t align)
+{
+	return (value + align - 1) & ~(align - 1);
+}
+
+/*
+ * Makes room for at least count more elements.
+ */
+static void reserve(growable_s *g, size_t count)
+{
+	if (g->count + count > g->capacity)
+	{
+		g->capacity = g->capacity ? g->capacity : 1024;
+		while (g->count + count > g->capacity)
+		{
+			g->capacity *= 2;
+		}
+
+		g->data = realloc(g->data, g->capacity * g->size);
+		if (g->data == NULL)
+		{
+			fprintf(stderr, "Out of memory\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+static void *push(growable_s *g)
+{
+	reserve(g, 1);
+	return (char *) g->data + g->size * g->count++;
+}
+
+static uint32_t hash_corner(const corner_s *c)
+{
+	uint64_t h = lv_hash_fnv1a(c, sizeof(corner_s), LV_FNV1A_SEED);
+	return (uint32_t) (h ^ (h >> 32));
+}
+
+/*
+ * Resizes the vertex lookup to fit at least `count` vertices, empty.
+ */
+static void reset_buckets(mesh_s *mesh, uint32_t count)
+{
+	uint32_t bucket_count = mesh->bucket_count ? mesh->bucket_count : 4096;
+	while (bucket_count < count * 2)
+	{
+		bucket_count *= 2;
+	}
+
+	if (bucket_count != mesh->bucket_count)
+	{
+		free(mesh->buckets);
+		mesh->buckets = malloc(sizeof(uint32_t) * bucket_count);
+		mesh->bucket_count = bucket_count;
+		if (mesh->buckets == NULL)
+		{
+			fprintf(stderr, "Out of memory\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	memset(mesh->buckets, 0, sizeof(uint32_t) * bucket_count);
+}
+
+static lv_mesh_submesh_s *current_submesh(mesh_s *mesh)
+{
+	return (lv_mesh_submesh_s *) mesh->submeshes.data + mesh->submeshes.count - 1;
+}
+
+/*
+ * Starts a new submesh, unless the current one is still empty.
+ */
+static void begin_submesh(mesh_s *mesh)
+{
+	if (mesh->submeshes.count > 0 && current_submesh(mesh)->index_count == 0)
+	{
+		return;
+	}
+
+	lv_mesh_submesh_s *sub = push(&mesh->submeshes);
+	memset(sub, 0, sizeof(lv_mesh_submesh_s));
+	sub->first_index  = mesh->indices.count;
+	sub->first_vertex = mesh->corners.count;
+	reset_buckets(mesh, 0);
+}
+
+/*
+ * Returns the output vertex of a corner, adding it if it is new to the
+ * current submesh.
+ */
+static uint32_t add_corner(mesh_s *mesh, const corner_s *c)
+{
+	lv_mesh_submesh_s *sub = current_submesh(mesh);
+	if (sub->vertex_count * 2 >= mesh->bucket_count)
+	{
+		// rehash the submesh's vertices into a lookup twice the size
+		reset_buckets(mesh, mesh->bucket_count);
+		for (uint32_t i = 0; i < sub->vertex_count; ++i)
+		{
+			const corner_s *old = (const corner_s *) mesh->corners.data + sub->first_vertex + i;
+			uint32_t b = hash_corner(old) & (mesh->bucket_count - 1);
+			while (mesh->buckets[b] != 0)
+			{
+				b = (b + 1) & (mesh->bucket_count - 1);
+			}
+			mesh->buckets[b] = sub->first_vertex + i + 1;
+		}
+	}
+
+	uint32_t b = hash_corner(c) & (mesh->bucket_count - 1);
+	while (mesh->buckets[b] != 0)
+	{
+		const corner_s *other = (const corner_s *) mesh->corners.data + mesh->buckets[b] - 1;
+		if (memcmp(other, c, sizeof(corner_s)) == 0)
+		{
+			return mesh->buckets[b] - 1;
+		}
+		b = (b + 1) & (mesh->bucket_count - 1);
+	}
+
+	*(corner_s *) push(&mesh->corners) = *c;
+	mesh->buckets[b] = mesh->corners.count;
+	++sub->vertex_count;
+	return mesh->corners.count - 1;
+}
+
+/*
+ * Turns an OBJ index, 1-based or negative from the end, into a 1-based
+ * one, 0 if it is out of range.
+ */
+static uint32_t resolve(long index, size_t count)
+{
+	if (index < 0)
+	{
+		index += (long) count + 1;
+	}
+	return index > 0 && (size_t) index <= count ? (uint32_t) index : 0;
+}
+
+static const char *parse_floats(const char *p, float *out, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		char *end;
+		out[i] = strtof(p, &end);
+		p = end;
+	}
+	return p;
+}
+
+/*
+ * Parses a face, "v", "v/vt", "v//vn" or "v/vt/vn" per corner, into fan
+ * triangles. Returns 0 on a bad index.
+ */
+static int parse_face(mesh_s *mesh, const char *p, const char *line_end)
+{
+	uint32_t first = 0, prev = 0, count = 0;
+
+	while (p < line_end)
+	{
+		while (p < line_end && (*p == ' ' || *p == '\t'))
+		{
+			++p;
+		}
+		if (p >= line_end || *p == '\r' || *p == '#')
+		{
+			break;
+		}
+
+		char *end;
+		corner_s c = { 0 };
+		c.v = resolve(strtol(p, &end, 10), mesh->positions.count);
+		p = end;
+
+		if (*p == '/')
+		{
+			if (p[1] != '/')
+			{
+				c.vt = resolve(strtol(p + 1, &end, 10), mesh->uvs.count);
+				p = end;
+			}
+			else
+			{
+				++p;
+			}
+
+			if (*p == '/')
+			{
+				c.vn = resolve(strtol(p + 1, &end, 10), mesh->normals.count);
+				p = end;
+			}
+		}
+
+		if (c.v == 0)
+		{
+			return 0;
+		}
+
+		uint32_t vertex = add_corner(mesh, &c);
+		if (count >= 2)
+		{
+			*(uint32_t *) push(&mesh->indices) = first;
+			*(uint32_t *) push(&mesh->indices) = prev;
+			*(uint32_t *) push(&mesh->indices) = vertex;
+			current_submesh(mesh)->index_count += 3;
+		}
+
+		first = count == 0 ? vertex : first;
+		prev  = vertex;
+		++count;
+	}
+
+	return 1;
+}
+
+static int parse_obj(mesh_s *mesh, const char *data, size_t size)
+{
+	const char *end = data + size;
+	uint32_t line = 0;
+
+	begin_submesh(mesh);
+
+	for (const char *p = data; p < end; )
+	{
+		const char *line_end = memchr(p, '\n', end - p);
+		line_end = line_end ? line_end : end;
+		++line;
+
+		while (p < line_end && (*p == ' ' || *p == '\t'))
+		{
+			++p;
+		}
+
+		if (line_end - p > 2 && p[0] == 'v' && p[1] == ' ')
+		{
+			parse_floats(p + 2, push(&mesh->positions), 3);
+		}
+		else if (line_end - p > 3 && p[0] == 'v' && p[1] == 'n' && p[2] == ' ')
+		{
+			parse_floats(p + 3, push(&mesh->normals), 3);
+		}
+		else if (line_end - p > 3 && p[0] == 'v' && p[1] == 't' && p[2] == ' ')
+		{
+			parse_floats(p + 3, push(&mesh->uvs), 2);
+		}
+		else if (line_end - p > 2 && p[0] == 'f' && p[1] == ' ')
+		{
+			if (parse_face(mesh, p + 2, line_end) == 0)
+			{
+				fprintf(stderr, "Bad face on line %u\n", line);
+				return 0;
+			}
+		}
+		else if ((line_end - p > 2 && (p[0] == 'o' || p[0] == 'g') && p[1] == ' ') ||
+				(line_end - p > 7 && memcmp(p, "usemtl ", 7) == 0))
+		{
+			begin_submesh(mesh);
+		}
+
+		p = line_end + 1;
+	}
+
+	// a trailing group without faces
+	if (mesh->submeshes.count > 1 && current_submesh(mesh)->index_count == 0)
+	{
+		--mesh->submeshes.count;
+	}
+
+	return mesh->indices.count > 0;
+}
+
+/*
+ * Adds the meshlets of a detail level.
+ */
+static void add_meshlets(mesh_s *mesh, lv_jobs_s *jobs, const float *vertices, lv_mesh_lod_s *lod)
+{
+	reserve(&mesh->meshlets, lv_meshlets_max(lod->index_count));
+
+	lod->first_meshlet = mesh->meshlets.count;
+	lod->meshlet_count = lv_meshlets_build(jobs, vertices, mesh->indices.data, lod->first_index,
+			lod->index_count, (lv_meshlet_s *) mesh->meshlets.data + mesh->meshlets.count);
+	mesh->meshlets.count += lod->meshlet_count;
+}
+
+/*
+ * Makes the detail levels of a submesh, each simplified from the one
+ * before with cells twice the size, and splits them into meshlets. The
+ * indices of the levels go after all of the submeshes'.
+ */
+static void bake_lods(mesh_s *mesh, lv_jobs_s *jobs, const float *vertices, uint32_t submesh, uint32_t levels)
+{
+	lv_mesh_submesh_s *sub = (lv_mesh_submesh_s *) mesh->submeshes.data + submesh;
+	sub->first_lod = mesh->lods.count;
+	sub->lod_count = 1;
+
+	lv_mesh_lod_s *lod = push(&mesh->lods);
+	memset(lod, 0, sizeof(lv_mesh_lod_s));
+	lod->first_index = sub->first_index;
+	lod->index_count = sub->index_count;
+
+	float cell = lv_edge_length(vertices, (uint32_t *) mesh->indices.data + sub->first_index, sub->index_count) * 2.0f;
+	uint32_t *simplified = malloc(sizeof(uint32_t) * sub->index_count);
+	if (simplified == NULL)
+	{
+		fprintf(stderr, "Out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (uint32_t attempt = 0; sub->lod_count < levels && attempt < LOD_ATTEMPTS; ++attempt, cell *= 2.0f)
+	{
+		lv_mesh_lod_s prev = ((lv_mesh_lod_s *) mesh->lods.data)[mesh->lods.count - 1];
+		if (prev.index_count / 3 <= LV_MESHLET_MAX_TRIANGLES)
+		{
+			break;
+		}
+
+		float error = 0.0f;
+		uint32_t count = lv_simplify(jobs, vertices, sub->first_vertex, sub->vertex_count,
+				(uint32_t *) mesh->indices.data + prev.first_index, prev.index_count, cell, simplified, &error);
+
+		if (count == 0 || count > prev.index_count * LOD_REDUCTION)
+		{
+			continue;
+		}
+
+		lod = push(&mesh->lods);
+		memset(lod, 0, sizeof(lv_mesh_lod_s));
+		lod->first_index = mesh->indices.count;
+		lod->index_count = count;
+		lod->error       = error;
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			*(uint32_t *) push(&mesh->indices) = simplified[i];
+		}
+
+		++sub->lod_count;
+		attempt = 0;
+	}
+	free(simplified);
+
+	for (uint32_t i = 0; i < sub->lod_count; ++i)
+	{
+		add_meshlets(mesh, jobs, vertices, (lv_mesh_lod_s *) mesh->lods.data + sub->first_lod + i);
+	}
+}
+
+static void grow_bounds(float *min, float *max, const float *p)
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		min[i] = p[i] < min[i] ? p[i] : min[i];
+		max[i] = p[i] > max[i] ? p[i] : max[i];
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const char *name = argv[0];
+	uint32_t levels = LV_MESH_MAX_LODS;
+	int quantize = 0;
+
+	for (; argc > 1 && argv[1][0] == '-'; --argc, ++argv)
+	{
+		if (strcmp(argv[1], "-q") == 0)
+		{
+			quantize = 1;
+		}
+		else if (strcmp(argv[1], "-l") == 0 && argc > 2)
+		{
+			levels = (uint32_t) atoi(argv[2]);
+			--argc;
+			++argv;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	if (argc != 3 || levels < 1 || levels > LV_MESH_MAX_LODS)
+	{
+		fprintf(stderr, "Usage: %s [-q] [-l LEVELS] MESH FILE.obj\n", name);
+		return EXIT_FAILURE;
+	}
+
+	// null terminated, strtof() and strtol() may run up to the end
+	FILE *in = fopen(argv[2], "rb");
+	struct stat st;
+	char *obj = NULL;
+
+	if (in == NULL || fstat(fileno(in), &st) == -1 || (obj = malloc(st.st_size + 1)) == NULL ||
+			fread(obj, 1, st.st_size, in) != (size_t) st.st_size)
+	{
+		fprintf(stderr, "Not a readable file: %s\n", argv[2]);
+		return EXIT_FAILURE;
+	}
+	obj[st.st_size] = '\0';
+	fclose(in);
+
+	mesh_s mesh = { 0 };
+	mesh.positions.size = sizeof(float) * 3;
+	mesh.normals.size   = sizeof(float) * 3;
+	mesh.uvs.size       = sizeof(float) * 2;
+	mesh.corners.size   = sizeof(corner_s);
+	mesh.indices.size   = sizeof(uint32_t);
+	mesh.submeshes.size = sizeof(lv_mesh_submesh_s);
+	mesh.lods.size      = sizeof(lv_mesh_lod_s);
+	mesh.meshlets.size  = sizeof(lv_meshlet_s);
+
+	if (parse_obj(&mesh, obj, st.st_size) == 0)
+	{
+		fprintf(stderr, "No faces in %s\n", argv[2]);
+		return EXIT_FAILURE;
+	}
+	free(obj);
+
+	uint32_t vertex_count = mesh.corners.count;
+	const corner_s *corners = mesh.corners.data;
+	const float *positions  = mesh.positions.data;
+	float *vertices = malloc(sizeof(float) * 3 * vertex_count);
+	if (vertices == NULL)
+	{
+		fprintf(stderr, "Out of memory\n");
+		return EXIT_FAILURE;
+	}
+
+	for (uint32_t v = 0; v < vertex_count; ++v)
+	{
+		memcpy(&vertices[v * 3], &positions[(corners[v].v - 1) * 3], sizeof(float) * 3);
+	}
+
+	lv_jobs_s *jobs = lv_jobs_create(0);
+	double start = lv_time_ms();
+
+	for (uint32_t s = 0; s < mesh.submeshes.count; ++s)
+	{
+		bake_lods(&mesh, jobs, vertices, s, levels);
+	}
+
+	double baked = lv_time_ms() - start;
+	lv_jobs_free(jobs);
+
+	uint32_t index_count = mesh.indices.count;
+	int has_normals = mesh.normals.count > 0;
+	int has_uvs     = mesh.uvs.count > 0;
+	int short_indices = vertex_count <= UINT16_MAX;
+
+	lv_mesh_header_s header = { 0 };
+	memcpy(header.magic, LV_MESH_MAGIC, 4);
+	header.version       = LV_MESH_VERSION;
+	header.vertex_count  = vertex_count;
+	header.index_count   = index_count;
+	header.index_type    = short_indices ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	header.submesh_count = mesh.submeshes.count;
+	header.lod_count     = mesh.lods.count;
+	header.meshlet_count = mesh.meshlets.count;
+
+	size_t table_size = sizeof(lv_mesh_submesh_s) * header.submesh_count
+		+ sizeof(lv_mesh_lod_s) * header.lod_count + sizeof(lv_meshlet_s) * header.meshlet_count;
+	size_t offset = align_up(sizeof(header) + table_size, LV_MESH_ALIGN);
+	header.data_offset = offset;
+
+	lv_mesh_stream_s *stream = &header.streams[header.stream_count++];
+	stream->attribute = LV_MESH_POSITION;
+	stream->format    = quantize ? VK_FORMAT_R16G16B16A16_UNORM : VK_FORMAT_R32G32B32_SFLOAT;
+	stream->stride    = quantize ? sizeof(uint16_t) * 4 : sizeof(float) * 3;
+
+	if (has_normals)
+	{
+		stream = &header.streams[header.stream_count++];
+		stream->attribute = LV_MESH_NORMAL;
+		stream->format    = quantize ? VK_FORMAT_R8G8_SNORM : VK_FORMAT_R32G32B32_SFLOAT;
+		stream->stride    = quantize ? sizeof(int8_t) * 2 : sizeof(float) * 3;
+	}
+
+	if (has_uvs)
+	{
+		stream = &header.streams[header.stream_count++];
+		stream->attribute = LV_MESH_UV;
+		stream->format    = quantize ? VK_FORMAT_R16G16_SFLOAT : VK_FORMAT_R32G32_SFLOAT;
+		stream->stride    = quantize ? sizeof(uint16_t) * 2 : sizeof(float) * 2;
+	}
+
+	for (uint32_t i = 0; i < header.stream_count; ++i)
+	{
+		header.streams[i].offset = offset;
+		offset = align_up(offset + (size_t) header.streams[i].stride * vertex_count, LV_MESH_ALIGN);
+	}
+
+	header.index_offset = offset;
+	offset += (size_t) index_count * (short_indices ? 2 : 4);
+	header.data_size = offset - header.data_offset;
+	header.size = align_up(offset, LV_MESH_FILE_ALIGN);
+
+	// the streams are written out in full, one after the other
+	char *data = calloc(1, header.size - header.data_offset);
+	if (data == NULL)
+	{
+		fprintf(stderr, "Out of memory\n");
+		return EXIT_FAILURE;
+	}
+
+	const float *normals    = mesh.normals.data;
+	const float *uvs        = mesh.uvs.data;
+	lv_mesh_submesh_s *submeshes = mesh.submeshes.data;
+
+	for (int i = 0; i < 3; ++i)
+	{
+		header.min[i] = FLT_MAX;
+		header.max[i] = -FLT_MAX;
+	}
+
+	for (uint32_t s = 0; s < header.submesh_count; ++s)
+	{
+		lv_mesh_submesh_s *sub = &submeshes[s];
+		for (int i = 0; i < 3; ++i)
+		{
+			sub->min[i] = FLT_MAX;
+			sub->max[i] = -FLT_MAX;
+		}
+
+		for (uint32_t v = sub->first_vertex; v < sub->first_vertex + sub->vertex_count; ++v)
+		{
+			const float *p = &vertices[v * 3];
+			grow_bounds(sub->min, sub->max, p);
+			grow_bounds(header.min, header.max, p);
+		}
+	}
+
+	// in vertex order first, corners without any stay zero
+	float *vertex_normals = calloc(has_normals ? vertex_count : 0, sizeof(float) * 3);
+	float *vertex_uvs     = calloc(has_uvs ? vertex_count : 0, sizeof(float) * 2);
+	if ((has_normals && vertex_normals == NULL) || (has_uvs && vertex_uvs == NULL))
+	{
+		fprintf(stderr, "Out of memory\n");
+		return EXIT_FAILURE;
+	}
+
+	for (uint32_t v = 0; v < vertex_count; ++v)
+	{
+		if (has_normals && corners[v].vn != 0)
+		{
+			memcpy(&vertex_normals[v * 3], &normals[(corners[v].vn - 1) * 3], sizeof(float) * 3);
+		}
+		if (has_uvs && corners[v].vt != 0)
+		{
+			memcpy(&vertex_uvs[v * 2], &uvs[(corners[v].vt - 1) * 2], sizeof(float) * 2);
+		}
+	}
+
+	uint32_t s = 0;
+	void *out_positions = data + header.streams[s++].offset - header.data_offset;
+	void *out_normals   = has_normals ? data + header.streams[s++].offset - header.data_offset : NULL;
+	void *out_uvs       = has_uvs ? data + header.streams[s++].offset - header.data_offset : NULL;
+
+	if (quantize)
+	{
+		lv_quantize_positions(vertices, vertex_count, header.min, header.max, out_positions);
+	}
+	else
+	{
+		memcpy(out_positions, vertices, sizeof(float) * 3 * vertex_count);
+	}
+
+	if (has_normals && quantize)
+	{
+		lv_quantize_normals(vertex_normals, vertex_count, out_normals);
+	}
+	else if (has_normals)
+	{
+		memcpy(out_normals, vertex_normals, sizeof(float) * 3 * vertex_count);
+	}
+
+	if (has_uvs && quantize)
+	{
+		lv_quantize_uvs(vertex_uvs, vertex_count, out_uvs);
+	}
+	else if (has_uvs)
+	{
+		memcpy(out_uvs, vertex_uvs, sizeof(float) * 2 * vertex_count);
+	}
+
+	const uint32_t *indices = mesh.indices.data;
+	char *out_indices = data + header.index_offset - header.data_offset;
+	for (uint32_t i = 0; i < index_count; ++i)
+	{
+		if (short_indices)
+		{
+			((uint16_t *) out_indices)[i] = (uint16_t) indices[i];
+		}
+		else
+		{
+			((uint32_t *) out_indices)[i] = indices[i];
+		}
+	}
+
+	FILE *out = fopen(argv[1], "wb");
+	if (out == NULL)
+	{
+		fprintf(stderr, "Could not open %s for writing\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	static const char zeros[LV_MESH_ALIGN] = { 0 };
+
+	fwrite(&header, sizeof(header), 1, out);
+	fwrite(submeshes, sizeof(lv_mesh_submesh_s), header.submesh_count, out);
+	fwrite(mesh.lods.data, sizeof(lv_mesh_lod_s), header.lod_count, out);
+	fwrite(mesh.meshlets.data, sizeof(lv_meshlet_s), header.meshlet_count, out);
+	fwrite(zeros, 1, header.data_offset - sizeof(header) - table_size, out);
+	fwrite(data, 1, header.size - header.data_offset, out);
+
+	if (fclose(out) != 0)
+	{
+		fprintf(stderr, "Failed writing %s\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	fprintf(stdout, "%u vertices, %u triangles, %u submeshes, %u streams, %zu bytes\n", vertex_count,
+			index_count / 3, header.submesh_count, header.stream_count, (size_t) header.size);
+
+	const lv_mesh_lod_s *lods = mesh.lods.data;
+	for (uint32_t i = 0; i < header.lod_count; ++i)
+	{
+		fprintf(stdout, "  level %u: %u triangles, %u meshlets, error %g\n", i, lods[i].index_count / 3,
+				lods[i].meshlet_count, lods[i].error);
+	}
+	fprintf(stdout, "%u levels and %u meshlets in %.1f ms\n", header.lod_count, header.meshlet_count, baked);
+
+	free(data);
+	free(vertex_uvs);
+	free(vertex_normals);
+	free(vertices);
+	free(mesh.meshlets.data);
+	free(mesh.lods.data);
+	free(mesh.buckets);
+	free(mesh.submeshes.data);
+	free(mesh.indices.data);
+	free(mesh.corners.data);
+	free(mesh.uvs.data);
+	free(mesh.normals.data);
+	free(mesh.positions.data);
+
+	return EXIT_SUCCESS;
+}
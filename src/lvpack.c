@@ -0,0 +1,196 @@
+#include <stdio.h>		// fopen(), fwrite(), ...
+#include <stdlib.h>		// malloc(), ...
+#include <string.h>		// strlen(), strrchr(), ...
+#include <sys/stat.h>		// fstat(), struct stat
+
+#include <vulkan/vulkan.h>
+#include "liblava/liblava.h"
+
+//
+// Packs SPIR-V files into a single shader archive that can be loaded by
+// lv_shader_archive_open(). Every shader is stored under its file name,
+// minus the directory and the ".spv" suffix: "shaders/default.vert.spv"
+// becomes "default.vert".
+//
+// Usage: lvpack ARCHIVE FILE.spv [FILE.spv ...]
+//
+
+struct pack_input
+{
+	const char *path;
+	void       *data;
+	size_t      size;
+};
+
+typedef struct pack_input pack_input_s;
+
+static size_t align_up(size_t value, size_t align)
+{
+	return (value + align - 1) & ~(align - 1);
+}
+
+int read_input(pack_input_s *input)
+{
+	FILE *file = fopen(input->path, "rb");
+	if (file == NULL)
+	{
+		return 0;
+	}
+
+	struct stat st;
+	if (fstat(fileno(file), &st) == -1)
+	{
+		fclose(file);
+		return 0;
+	}
+
+	input->size = st.st_size;
+	input->data = malloc(input->size);
+
+	int ok = input->data && fread(input->data, 1, input->size, file) == input->size;
+	fclose(file);
+
+	return ok && lv_spirv_valid(input->data, input->size);
+}
+
+int make_name(const char *path, char *name)
+{
+	const char *slash = strrchr(path, '/');
+	const char *base  = slash ? slash + 1 : path;
+
+	size_t len = strlen(base);
+	if (len > 4 && strcmp(base + len - 4, ".spv") == 0)
+	{
+		len -= 4;
+	}
+
+	// leave room for the terminating null byte
+	if (len >= LV_ARCHIVE_NAME_SIZE)
+	{
+		return 0;
+	}
+
+	memset(name, 0, LV_ARCHIVE_NAME_SIZE);
+	memcpy(name, base, len);
+	return 1;
+}
+
+void insert_bucket(uint32_t *buckets, uint32_t bucket_count, uint64_t hash, uint32_t index)
+{
+	uint32_t mask = bucket_count - 1;
+	uint32_t i = (uint32_t) hash & mask;
+
+	while (buckets[i] != 0)
+	{
+		i = (i + 1) & mask;
+	}
+
+	buckets[i] = index + 1;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 3)
+	{
+		fprintf(stderr, "Usage: %s ARCHIVE FILE.spv [FILE.spv ...]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	uint32_t count = argc - 2;
+	uint32_t bucket_count = 1;
+	while (bucket_count < count * 2)
+	{
+		bucket_count *= 2;
+	}
+
+	pack_input_s       *inputs  = calloc(count, sizeof(pack_input_s));
+	lv_archive_entry_s *entries = calloc(count, sizeof(lv_archive_entry_s));
+	uint32_t *name_buckets = calloc(bucket_count, sizeof(uint32_t));
+	uint32_t *hash_buckets = calloc(bucket_count, sizeof(uint32_t));
+
+	size_t offset = sizeof(lv_archive_header_s)
+		+ sizeof(lv_archive_entry_s) * count
+		+ sizeof(uint32_t) * bucket_count * 2;
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		inputs[i].path = argv[i + 2];
+
+		if (read_input(&inputs[i]) == 0)
+		{
+			fprintf(stderr, "Not a readable SPIR-V file: %s\n", inputs[i].path);
+			return EXIT_FAILURE;
+		}
+
+		lv_archive_entry_s *entry = &entries[i];
+
+		if (make_name(inputs[i].path, entry->name) == 0)
+		{
+			fprintf(stderr, "Name too long: %s\n", inputs[i].path);
+			return EXIT_FAILURE;
+		}
+
+		for (uint32_t j = 0; j < i; ++j)
+		{
+			if (strcmp(entries[j].name, entry->name) == 0)
+			{
+				fprintf(stderr, "Duplicate name: %s\n", entry->name);
+				return EXIT_FAILURE;
+			}
+		}
+
+		offset = align_up(offset, LV_ARCHIVE_ALIGN);
+
+		entry->name_hash = lv_hash_fnv1a(entry->name, strlen(entry->name), LV_FNV1A_SEED);
+		entry->hash      = lv_hash_fnv1a(inputs[i].data, inputs[i].size, LV_FNV1A_SEED);
+		entry->offset    = offset;
+		entry->size      = inputs[i].size;
+
+		insert_bucket(name_buckets, bucket_count, entry->name_hash, i);
+		insert_bucket(hash_buckets, bucket_count, entry->hash, i);
+
+		offset += inputs[i].size;
+	}
+
+	lv_archive_header_s header = { 0 };
+	memcpy(header.magic, LV_ARCHIVE_MAGIC, 4);
+	header.version      = LV_ARCHIVE_VERSION;
+	header.count        = count;
+	header.bucket_count = bucket_count;
+	header.size         = offset;
+
+	FILE *out = fopen(argv[1], "wb");
+	if (out == NULL)
+	{
+		fprintf(stderr, "Could not open %s for writing\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	fwrite(&header, sizeof(header), 1, out);
+	fwrite(entries, sizeof(lv_archive_entry_s), count, out);
+	fwrite(name_buckets, sizeof(uint32_t), bucket_count, out);
+	fwrite(hash_buckets, sizeof(uint32_t), bucket_count, out);
+
+	static const char zeros[LV_ARCHIVE_ALIGN] = { 0 };
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		long pos = ftell(out);
+		fwrite(zeros, 1, entries[i].offset - pos, out);
+		fwrite(inputs[i].data, 1, inputs[i].size, out);
+		fprintf(stdout, "%*d: %s (%zu bytes)\n", 2, i+1, entries[i].name, inputs[i].size);
+		free(inputs[i].data);
+	}
+
+	if (fclose(out) != 0)
+	{
+		fprintf(stderr, "Failed writing %s\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	free(hash_buckets);
+	free(name_buckets);
+	free(entries);
+	free(inputs);
+
+	return EXIT_SUCCESS;
+}